@@ -34,6 +34,10 @@ blocking_http_server::start()
     std::cout << "Server is listening on "
               << "http://localhost:" << this->__port << std::endl;
 
+    // A client closing its connection in the middle of a `sendfile` must not
+    // terminate the server.
+    signal(SIGPIPE, SIG_IGN);
+
     // The server keeps running and accepting incoming connections until an
     // interrupt signal is received.
     for (;;)
@@ -52,6 +56,18 @@ blocking_http_server::start()
             handle_syscall_error(client_socket, "accept");
         }
 
+        auto accepted = std::chrono::system_clock::now();
+        auto started  = std::chrono::steady_clock::now();
+
+        HFS_TRACE_SPAN("request");
+
+        if (this->__metrics != nullptr)
+        {
+            this->__metrics->count(
+                hfs::http_metrics::counter::CONNECTIONS_ACCEPTED
+            );
+        }
+
         // Retrieve the client IP address and port number
         char client_ip[INET6_ADDRSTRLEN];
         inet_ntop(
@@ -79,18 +95,26 @@ blocking_http_server::start()
             continue;
         }
 
+        this->__res->templates(this->__templates.get());
+        this->__route = hfs::http_metrics::ROUTE_NONE;
+        this->__res->timing().mark(hfs::http_timing::ACCEPT, started);
+
         // Start reading the incoming request
         char buf[HTTP_BUFSZ + 1] = {0};
         ssize_t brecv, bsent;
-        std::size_t total_recv, total_sent;
+        std::size_t total_recv;
         char *body_ptr = nullptr, *endhdr_ptr = nullptr;
 
         // Read everything from the client socket to the buffer.
         for (total_recv = 0; total_recv < HTTP_BUFSZ;)
         {
+            HFS_TRACE_SPAN("recv");
+
             // Read the request in a loop because the request may not be read
             // fully in a single read call.
-            brecv = recv(client_socket, buf + total_recv, HTTP_BUFSZ, 0);
+            brecv = recv(
+                client_socket, buf + total_recv, HTTP_BUFSZ - total_recv, 0
+            );
 
             handle_syscall_error(brecv, "recv");
 
@@ -99,6 +123,9 @@ blocking_http_server::start()
                 break;
             }
 
+            if (total_recv == 0)
+                this->__res->timing().mark(hfs::http_timing::FIRST_BYTE);
+
             total_recv += brecv;
 
             if (total_recv >= HTTP_BUFSZ)
@@ -125,155 +152,231 @@ blocking_http_server::start()
         {
             this->__res->status(hfs::HTTP_STATUS_BAD_REQUEST);
             this->handle_error("No end of header found");
+            this->__res->send(client_socket, true);
+
+            if (this->__metrics != nullptr)
+            {
+                this->__metrics->count(
+                    hfs::http_metrics::counter::PARSE_ERRORS
+                );
+                this->__metrics->count(
+                    hfs::http_metrics::counter::CONNECTIONS_CLOSED
+                );
+            }
+
+            close(client_socket);
             continue;
         }
 
         try
         {
-            this->__req->parse(buf);
+            HFS_TRACE_SPAN("parse");
+            this->__req->parse(std::string_view(buf, body_ptr - buf));
         }
         catch (const std::runtime_error &e)
         {
+            this->__res->status(this->__req->status());
             this->handle_error(e.what());
+
+            if (this->__metrics != nullptr)
+                this->__metrics->count(hfs::http_metrics::counter::PARSE_ERRORS);
         }
 
-        // If the request is a POST or PUT, parse the body
-        if (this->__req->method() == "POST" || this->__req->method() == "PUT")
-        {
-            // Retrieve the content length
-            std::string cl_str;
-            std::size_t content_length = 0;
+        this->__res->timing().mark(hfs::http_timing::HEADERS_PARSED);
 
-            // Check if the Content-Length header is present
-            try
-            {
-                cl_str = this->__req->header("Content-Length");
-            }
-            catch (const std::out_of_range &e)
-            {
-                this->__res->status(hfs::HTTP_STATUS_LENGTH_REQUIRED);
-                this->handle_error("Content-Length header is missing");
-            }
+        // Prepare response header for server. They are set before the handler
+        // runs because a streamed response sends its headers from within it.
+        this->__res
+            ->header(
+                "Server", std::string(hfs::HTTP_SERVER_NAME) + "/" +
+                              std::string(hfs::HTTP_SERVER_VERSION)
+            )
+            .header("Connection", "close")
+            .header("X-Request-ID", this->__req->uuid());
 
-            // Check if the Content-Length header is a valid number
-            try
+        // Responses to `HEAD` requests carry the headers of the equivalent
+        // `GET` request but never a body.
+        this->__res->bind(
+            client_socket, this->__req->method() != "HEAD",
+            [this](hfs::http_response &res)
             {
-                content_length = std::stoul(cl_str);
-            }
-            catch (const std::invalid_argument &e)
-            {
-                this->__res->status(hfs::HTTP_STATUS_BAD_REQUEST);
-                this->handle_error(
-                    "Content-Length header is not a valid number (got " +
-                    cl_str + ")"
-                );
-            }
+                if (this->__compression.has_value())
+                {
+                    hfs::http_compressor::compress_stream(
+                        *this->__compression, *this->__req, res
+                    );
+                }
 
-            // If the range between body_ptr and buf + total_recv is less
-            // than the content length, then there are still data to read
-            // from the client socket.
+                if (this->__server_timing)
+                    res.header("Server-Timing", res.timing().server_timing());
+            }
+        );
 
-            size_t read_body = buf + total_recv - body_ptr;
-            std::string final_body(body_ptr, read_body);
+        bool captured = false;
+        std::string captured_body;
 
-            if (read_body < content_length)
+        // The body is not read here: the handler either asks for it in
+        // memory or reads it incrementally through the body reader.
+        if (this->__req->status() == hfs::HTTP_STATUS_OK &&
+            this->__open_body(
+                client_socket,
+                std::string_view(body_ptr, buf + total_recv - body_ptr)
+            ))
+        {
+            // A copy of the body is kept while it is read, by the handler or
+            // by the final discard.
+            if (this->__capture != nullptr && this->__capture->sample())
             {
-                // Decide how many more data to read
-
-                size_t body_recv;
-                size_t remaining = content_length - read_body;
-
-                // Allocate memory for the body
+                captured = true;
 
-                char *body_buf = new char[remaining + 1];
-
-                for (body_recv = 0; body_recv < remaining;)
+                if (this->__req->has_body_reader())
                 {
-                    brecv =
-                        recv(client_socket, body_buf + body_recv, remaining, 0);
-
-                    handle_syscall_error(brecv, "recv");
-
-                    if (brecv == 0)
-                    {
-                        break;
-                    }
-
-                    body_recv += brecv;
-                    body_buf[body_recv] = '\0';
+                    this->__req->body_reader().tee(
+                        captured_body, this->__capture->max_body() + 1
+                    );
                 }
-
-                final_body.append(body_buf, body_recv);
-                this->__req->set_data(this->__req->data() + body_buf);
-                delete[] body_buf;
             }
 
-            this->__req->set_body(final_body);
+            this->__dispatch();
         }
 
-        auto [router, handler] = hfs::http_router::get_route_handler(
-            this->__router.get(), this->__req.get()
-        );
-
-        if (router == nullptr || handler == nullptr)
+        if (this->__res->streaming())
         {
-            if (this->__server_static(client_socket) == -1)
-                continue;
+            // Terminate the body if the handler has not done it
+            if (!this->__res->ended())
+            {
+                try
+                {
+                    HFS_TRACE_SPAN("send");
+                    this->__res->end();
+                }
+                catch (const std::runtime_error &e)
+                {
+                    std::cerr << e.what() << std::endl;
+                }
+            }
+
+            bsent = 0;
         }
-        else if (router)
+        else
         {
-            if (handler == nullptr)
+            // Compress the body produced by the handler if the client
+            // accepts it
+            if (this->__compression.has_value())
             {
-                this->__res->status(hfs::HTTP_STATUS_NOT_IMPLEMENTED);
-                this->handle_error(
-                    "Request is valid but the handler '" +
-                    std::string(this->__req->method()) + "' at resource '" +
-                    std::string(this->__req->path()) + "' is not implemented"
-                );
+                try
+                {
+                    HFS_TRACE_SPAN("compress");
+                    hfs::http_compressor::compress(
+                        *this->__compression, *this->__req, *this->__res
+                    );
+                }
+                catch (const std::runtime_error &e)
+                {
+                    std::cerr << e.what() << std::endl;
+                }
             }
 
-            // Call the handler
-            try
+            this->__res->timing().mark(hfs::http_timing::SERIALIZED);
+
+            if (this->__server_timing)
             {
-                handler(*this->__req, *this->__res);
+                this->__res->header(
+                    "Server-Timing", this->__res->timing().server_timing()
+                );
             }
-            catch (const std::runtime_error &e)
-            {
-                if (this->__res->status() == hfs::HTTP_STATUS_OK)
-                    this->__res->status(hfs::HTTP_STATUS_INTERNAL_SERVER_ERROR);
 
-                this->handle_error(e.what());
+            HFS_TRACE_SPAN("send");
+
+            bsent = this->__res->send(
+                client_socket, this->__req->method() != "HEAD"
+            );
+
+            if (bsent == -1)
+            {
+                std::cerr << "send: " << std::strerror(errno) << std::endl;
             }
         }
 
-        // Prepare response header for server
-        this->__res
-            ->header(
-                "Server", std::string(hfs::HTTP_SERVER_NAME) + "/" +
-                              std::string(hfs::HTTP_SERVER_VERSION)
-            )
-            .header("Connection", "close")
-            .header("X-Request-ID", this->__req->uuid());
+        this->__res->timing().mark(hfs::http_timing::LAST_BYTE);
 
-        std::string response  = (*this->__res)();
-        const char *resp_buf  = response.c_str();
-        const size_t resp_len = response.length();
+        // Closing the socket while the client is still sending the body
+        // would reset the connection and could discard the response. An
+        // aborted response is meant to be reset.
+        if (this->__req->has_body_reader() && !this->__res->aborted())
+            this->__req->body_reader().discard();
 
-        // Send the response
-        for (bsent = 0, total_sent = 0; total_sent < resp_len;)
+        if (captured)
         {
-            bsent = send(client_socket, resp_buf + bsent, resp_len - bsent, 0);
+            bool complete =
+                !this->__req->has_body_reader() ||
+                (this->__req->body_reader().eof() &&
+                 this->__req->body_reader().status() == hfs::HTTP_STATUS_OK &&
+                 captured_body.size() <= this->__capture->max_body());
 
-            handle_syscall_error(bsent, "send");
+            if (complete)
+            {
+                this->__capture->capture(
+                    *this->__req, this->__route, captured_body, started
+                );
+            }
+            else
+                this->__capture->drop();
+        }
+
+        std::size_t bytes = this->__res->streaming()
+                                ? this->__res->bytes_streamed()
+                                : std::max<ssize_t>(bsent, 0);
 
-            total_sent += (size_t)bsent;
+        if (this->__access_log != nullptr)
+        {
+            this->__access_log->log(hfs::http_access_log::record(
+                *this->__req, *this->__res, client_ip, accepted, bytes
+            ));
+        }
+
+        if (this->__metrics != nullptr)
+        {
+            std::size_t bytes_in =
+                (body_ptr ? body_ptr - buf : total_recv) +
+                (this->__req->has_body_reader()
+                     ? this->__req->body_reader().consumed()
+                     : 0);
+
+            this->__metrics->record(
+                this->__route, this->__res->status(), bytes_in, bytes,
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - started
+                )
+            );
         }
 
 #ifdef DEBUG
         std::cout << *(this->__req);
-        std::cout << "Sent " << total_sent << " bytes" << std::endl;
+        std::cout << "Sent " << bsent << " bytes" << std::endl;
 #endif
+
+        // A zero linger time makes `close` send a reset instead of a normal
+        // end of stream, which tells the client its body is truncated.
+        if (this->__res->aborted())
+        {
+            struct linger lingering = {1, 0};
+
+            setsockopt(
+                client_socket, SOL_SOCKET, SO_LINGER, &lingering,
+                sizeof(lingering)
+            );
+        }
+
         close(client_socket);
+
+        if (this->__metrics != nullptr)
+        {
+            this->__metrics->count(
+                hfs::http_metrics::counter::CONNECTIONS_CLOSED
+            );
+        }
+
         this->__req.reset(nullptr);
         this->__res.reset(nullptr);
     }
@@ -377,87 +480,24 @@ blocking_http_server::listen(int port, int backlog, int optval)
         return;
     }
 
-    // Initialize the environment for the HTTP response
-    hfs::http_response::env.set_include_callback(
-        [this](const std::string &path, const std::string &template_name)
-            -> inja::Template
-        {
-            std::cout << "include_callback(" << path << ", " << template_name
-                      << ")" << std::endl;
-
-            std::string template_path =
-                this->__static_path + "/pages/" + path + template_name;
-
-            int fd;
-            struct stat st;
-            char *buffer;
-
-            if ((fd = open(template_path.c_str(), O_RDONLY)) == -1)
-            {
-                if (errno == ENOENT)
-                {
-                    throw std::runtime_error(
-                        "inja::Template::env::set_include_callback not "
-                        "found: " +
-                        template_name + " (Full path: " + template_path + ")."
-                    );
-                }
-                else
-                {
-                    throw std::runtime_error(
-                        "inja::Template::env::set_include_callback internal "
-                        "error : " +
-                        template_name + " (Reason: " + strerror(errno) + ")."
-                    );
-                }
-            }
-
-            if (fstat(fd, &st) == -1)
-            {
-                close(fd);
-                throw std::runtime_error(
-                    "inja::Template::env::set_include_callback internal "
-                    "error : " +
-                    template_name + " (Reason: " + strerror(errno) + ")."
-                );
-            }
-
-            buffer = (char *)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-
-            if (buffer == MAP_FAILED)
-            {
-                close(fd);
-                throw std::runtime_error(
-                    "inja::Template::env::set_include_callback internal "
-                    "error : " +
-                    template_name + " (Reason: MAP_FAILED)."
-                );
-            }
-
-            if (close(fd) == -1)
-            {
-                munmap(buffer, st.st_size);
-                throw std::runtime_error(
-                    "inja::Template::env::set_include_callback internal "
-                    "error : " +
-                    template_name + " (Reason: " + strerror(errno) + ")."
-                );
-            }
-
-            std::string temp(buffer, st.st_size);
-
-            if (munmap(buffer, st.st_size) == -1)
-            {
-                throw std::runtime_error(
-                    "inja::Template::env::set_include_callback internal "
-                    "error : " +
-                    template_name + " (Reason: " + strerror(errno) + ")."
-                );
-            }
+    // Parse the pages and their includes once, so that rendering them does
+    // not touch the disk nor modify any shared state. A server without pages
+    // still serves its other routes, and renders whatever pages it can like
+    // the registry would, from the pages directory.
+    try
+    {
+        this->__templates = std::make_shared<const hfs::http_templates>(
+            this->__static_path + "/pages"
+        );
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::cerr << "templates: " << e.what() << std::endl;
 
-            return hfs::http_response::env.parse(temp);
-        }
-    );
+        hfs::http_templates::resolve_includes(
+            hfs::http_response::env, this->__static_path + "/pages"
+        );
+    }
 }
 
 void
@@ -466,8 +506,10 @@ blocking_http_server::register_handler(
     hfs::http_router::route_handler_t handler
 )
 {
+#ifdef DEBUG
     std::cout << "blocking_http_server::register_handler(" << path << ", "
               << method << ")" << std::endl;
+#endif
 
     if (path[0] != '/')
     {
@@ -478,25 +520,20 @@ blocking_http_server::register_handler(
 
     if (path == "/")
     {
+        this->__router->pattern          = path;
         this->__router->handlers[method] = handler;
         return;
     }
 
-    UriUriA *uri = hfs::http_uri::parse(path);
-
-    if (uri == nullptr)
-    {
-        throw std::runtime_error("Invalid URI");
-    }
-
     // List all the segments in the URI
-    UriPathSegmentA *segment;
+    hfs::http_uri uri(path);
+    std::string_view rest = uri.path(), segment;
     std::string uri_path;
     hfs::http_router *router = this->__router.get();
 
-    for (segment = uri->pathHead; segment != nullptr; segment = segment->next)
+    while (hfs::http_uri::next_segment(rest, segment))
     {
-        uri_path = std::string(segment->text.first, segment->text.afterLast);
+        uri_path = segment;
 
         // Check if the path is a route parameter
         if (uri_path[0] == ':')
@@ -504,15 +541,12 @@ blocking_http_server::register_handler(
             auto it = router->routes.find("*");
             if (it == router->routes.end())
             {
-                router->routes["*"] =
-                    std::make_unique<hfs::http_param_router>();
-            }
-            else
-            {
-                router = it->second.get();
+                it = router->routes.emplace(
+                    "*", std::make_unique<hfs::http_param_router>()
+                ).first;
             }
 
-            router = router->routes["*"].get();
+            router = it->second.get();
             continue;
         }
 
@@ -527,10 +561,8 @@ blocking_http_server::register_handler(
     if (router->is_param_router)
         ((hfs::http_param_router *)router)->param_name = uri_path.substr(1);
 
+    router->pattern          = path;
     router->handlers[method] = handler;
-
-    uriFreeUriMembersA(uri);
-    delete uri;
 }
 
 void
@@ -607,12 +639,309 @@ blocking_http_server::handle_error(std::string_view reason)
     handler(status_code, reason, *this->__req, *this->__res);
 }
 
-int
-blocking_http_server::__server_static(int client_socket)
+/**
+ * @brief Select the framing of the request body, as defined in RFC 9112
+ * Section 6.3, and attach the matching body reader to the request. Answer
+ * with an error and return `false` if the framing is invalid.
+ */
+bool
+blocking_http_server::__open_body(int socket, std::string_view buffered)
+{
+    std::optional<std::size_t> content_length;
+
+    try
+    {
+        // The final transfer coding must be `chunked`. Any other coding
+        // before it would have to be decoded as well, which is unsupported.
+        std::string_view codings = this->__req->header("Transfer-Encoding");
+        std::size_t comma        = codings.rfind(',');
+        std::string_view last    = hfs::trim(
+            comma == std::string_view::npos ? codings
+                                            : codings.substr(comma + 1)
+        );
+
+        if (!hfs::iequals(last, "chunked"))
+        {
+            this->__res->status(hfs::HTTP_STATUS_BAD_REQUEST);
+            this->handle_error(
+                "Transfer-Encoding must end with chunked (got " +
+                std::string(codings) + ")"
+            );
+
+            return false;
+        }
+
+        if (comma != std::string_view::npos)
+        {
+            this->__res->status(hfs::HTTP_STATUS_NOT_IMPLEMENTED);
+            this->handle_error(
+                "Unsupported Transfer-Encoding: " + std::string(codings)
+            );
+
+            return false;
+        }
+    }
+    catch (const std::out_of_range &e)
+    {
+        // A `Transfer-Encoding` overrides any `Content-Length`
+        try
+        {
+            const std::string &cl_str = this->__req->header("Content-Length");
+            std::size_t length        = 0;
+
+            if (cl_str.empty() ||
+                !std::all_of(cl_str.begin(), cl_str.end(), ::isdigit) ||
+                cl_str.size() > std::to_string(SIZE_MAX).size() - 1)
+            {
+                this->__res->status(hfs::HTTP_STATUS_BAD_REQUEST);
+                this->handle_error(
+                    "Content-Length header is not a valid number (got " +
+                    cl_str + ")"
+                );
+
+                return false;
+            }
+
+            for (char c : cl_str)
+                length = length * 10 + (c - '0');
+
+            content_length = length;
+        }
+        catch (const std::out_of_range &e)
+        {
+            if (this->__req->method() == "POST" ||
+                this->__req->method() == "PUT")
+            {
+                this->__res->status(hfs::HTTP_STATUS_LENGTH_REQUIRED);
+                this->handle_error("Content-Length header is missing");
+
+                return false;
+            }
+
+            content_length = 0;
+        }
+    }
+
+    bool expect_continue = false;
+
+    // `100-continue` is the only expectation defined, see RFC 9110 Section
+    // 10.1.1
+    try
+    {
+        std::string_view expect = this->__req->header("Expect");
+        expect_continue = hfs::iequals(hfs::trim(expect), "100-continue");
+
+        if (!expect_continue)
+        {
+            this->__res->status(hfs::HTTP_STATUS_EXPECTATION_FAILED);
+            this->handle_error("Unsupported Expect: " + std::string(expect));
+
+            return false;
+        }
+    }
+    catch (const std::out_of_range &e)
+    {
+    }
+
+    this->__req->set_body_reader(std::make_unique<hfs::http_body_reader>(
+        socket, buffered, content_length, expect_continue
+    ));
+
+    return true;
+}
+
+/**
+ * @brief Route the request to its handler, or to the static files.
+ */
+void
+blocking_http_server::__dispatch()
 {
+    hfs::http_timing &timing = this->__res->timing();
+    auto [router, handler]   = hfs::http_router::get_route_handler(
+        this->__router.get(), this->__req.get()
+    );
+
+    timing.mark(hfs::http_timing::ROUTE_RESOLVED);
+
+    if (router == nullptr || handler == nullptr)
+    {
+        this->__route = hfs::http_metrics::ROUTE_STATIC;
+
+        timing.mark(hfs::http_timing::HANDLER_START);
+        this->__server_static();
+        timing.mark(hfs::http_timing::HANDLER_END);
+        return;
+    }
+
+    this->__route = router->pattern;
+
+    timing.mark(hfs::http_timing::HANDLER_START);
+
+    try
+    {
+        HFS_TRACE_SPAN("handler", this->__route);
+        handler(*this->__req, *this->__res);
+        timing.mark(hfs::http_timing::HANDLER_END);
+    }
+    catch (const std::runtime_error &e)
+    {
+        timing.mark(hfs::http_timing::HANDLER_END);
+
+        // The headers of a streamed response are gone already, so the only
+        // way to signal the error is to cut the body short, without the last
+        // chunk that would make it look complete.
+        if (this->__res->streaming())
+        {
+            std::cerr << e.what() << std::endl;
+            this->__res->abort();
+            return;
+        }
+
+        // A body that cannot be read is the client's fault
+        if (this->__res->status() == hfs::HTTP_STATUS_OK)
+        {
+            http_status_code_t status = this->__req->body_reader().status();
+
+            this->__res->status(
+                status != hfs::HTTP_STATUS_OK
+                    ? status
+                    : hfs::HTTP_STATUS_INTERNAL_SERVER_ERROR
+            );
+        }
+
+        this->handle_error(e.what());
+    }
+}
+
+/**
+ * @brief Select the ranges of a static file requested by the client.
+ *
+ * @return `std::nullopt` if the whole file must be sent: there is no `Range`
+ * header, it is malformed, or the `If-Range` validator does not match the
+ * current version of the file. An empty vector if no range is satisfiable.
+ */
+static std::optional<std::vector<hfs::http_range::byte_range>>
+__requested_ranges(
+    const hfs::http_request &req, const std::string &etag,
+    const std::string &last_modified, std::size_t size
+)
+{
+    std::string range;
+
+    // A server must ignore `Range` for any other method than `GET`
+    if (req.method() != "GET")
+        return std::nullopt;
+
+    try
+    {
+        range = req.header("Range");
+    }
+    catch (const std::out_of_range &e)
+    {
+        return std::nullopt;
+    }
+
+    // `If-Range` holds either an entity tag, which must match strongly, or the
+    // exact date of the last modification.
+    try
+    {
+        const std::string &if_range = req.header("If-Range");
+
+        if (if_range != etag && if_range != last_modified)
+            return std::nullopt;
+    }
+    catch (const std::out_of_range &e)
+    {
+    }
+
+    return hfs::http_range::parse(range, size);
+}
+
+/**
+ * @brief Replace a static file by a precompressed sibling, such as `app.js.br`
+ * or `app.js.gz`, when the client accepts its content coding. Siblings older
+ * than the file itself are considered stale and ignored.
+ *
+ * @param req - The HTTP request.
+ * @param file_path - The path of the requested file.
+ * @param fd - The descriptor of the requested file, replaced by the descriptor
+ * of the sibling if one is selected.
+ * @param file_stat - The status of the requested file, replaced by the status
+ * of the sibling if one is selected.
+ * @return `std::string_view` - The content coding of the selected sibling, or
+ * an empty view if the file must be sent as is.
+ */
+static std::string_view
+__open_precompressed(
+    const hfs::http_request &req, const std::string &file_path, int &fd,
+    struct stat &file_stat
+)
+{
+    // Ordered by preference when the client weights them equally
+    static const std::pair<std::string_view, std::string_view> siblings[] = {
+        {hfs::http_encoding::BROTLI, ".br"},
+        {hfs::http_encoding::GZIP,   ".gz"},
+    };
+
+    std::string accept_encoding;
+
+    try
+    {
+        accept_encoding = req.header("Accept-Encoding");
+    }
+    catch (const std::out_of_range &e)
+    {
+        return "";
+    }
+
+    std::vector<std::pair<double, std::size_t>> candidates;
+
+    for (std::size_t i = 0; i < std::size(siblings); i++)
+    {
+        double weight =
+            hfs::http_encoding::quality(accept_encoding, siblings[i].first);
+
+        if (weight > 0)
+            candidates.emplace_back(-weight, i);
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+
+    for (const auto &[weight, i] : candidates)
+    {
+        struct stat sibling_stat;
+        std::string sibling_path = file_path + std::string(siblings[i].second);
+        int sibling_fd           = open(sibling_path.c_str(), O_RDONLY);
+
+        if (sibling_fd == -1)
+            continue;
+
+        if (fstat(sibling_fd, &sibling_stat) == -1 ||
+            !S_ISREG(sibling_stat.st_mode) ||
+            sibling_stat.st_mtime < file_stat.st_mtime)
+        {
+            close(sibling_fd);
+            continue;
+        }
+
+        handle_syscall_error(close(fd), "close");
+
+        fd        = sibling_fd;
+        file_stat = sibling_stat;
+
+        return siblings[i].first;
+    }
+
+    return "";
+}
+
+void
+blocking_http_server::__server_static()
+{
+    HFS_TRACE_SPAN("static", this->__req->path());
+
     int fd;
     struct stat file_stat;
-    char *body = nullptr;
     std::string file_path =
         this->__static_path + std::string(this->__req->path());
 
@@ -625,7 +954,7 @@ blocking_http_server::__server_static(int client_socket)
                 "Path not found: " + std::string(this->__req->path())
             );
 
-            return 0;
+            return;
         }
 
         handle_syscall_error(fd, "open");
@@ -633,35 +962,112 @@ blocking_http_server::__server_static(int client_socket)
 
     handle_syscall_error(fstat(fd, &file_stat), "fstat");
 
-    body =
-        (char *)mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-
-    if (body == MAP_FAILED)
+    // Directories and special files are never served
+    if (!S_ISREG(file_stat.st_mode))
     {
-        std::cerr << "mmap: " << std::strerror(errno) << std::endl;
-
         handle_syscall_error(close(fd), "close");
-        handle_syscall_error(close(client_socket), "close");
-        return -1;
-    }
 
-    handle_syscall_error(
-        [&body]() { return body == MAP_FAILED ? -1 : 0; }(), "mmap"
-    );
-    handle_syscall_error(close(fd), "close");
+        this->__res->status(HTTP_STATUS_NOT_FOUND);
+        this->handle_error(
+            "Path not found: " + std::string(this->__req->path())
+        );
+
+        return;
+    }
 
     std::string ext = file_path.substr(file_path.find_last_of(".") + 1);
+    std::string content_type = hfs::http_mime(ext);
 
+    // The type of the representation stays the one of the requested file,
+    // only its encoding changes. Ranges, `ETag` and `Last-Modified` refer to
+    // the encoded bytes that are actually sent.
+    std::string_view coding =
+        __open_precompressed(*this->__req, file_path, fd, file_stat);
+
+    std::size_t size          = file_stat.st_size;
+    std::string etag          = hfs::etag(file_stat.st_mtime, size);
+    std::string last_modified = hfs::format_date(file_stat.st_mtime);
+
+    auto ranges = __requested_ranges(*this->__req, etag, last_modified, size);
+
+    // The error page is plain HTML, so none of the headers describing the
+    // file, its encoding included, may be attached to it.
+    if (ranges.has_value() && ranges->empty())
+    {
+        handle_syscall_error(close(fd), "close");
+
+        this->__res->status(HTTP_STATUS_RANGE_NOT_SATISFIABLE);
+        this->handle_error(
+            "None of the requested ranges overlaps the " +
+            std::to_string(size) + " bytes of " +
+            std::string(this->__req->path())
+        );
+        this->__res->header(
+            "Content-Range", hfs::http_range::unsatisfied_range(size)
+        );
+
+        return;
+    }
+
+    // The response owns the descriptor from now on, and the file content is
+    // transferred with `sendfile` when the response is sent.
     this->__res->status(HTTP_STATUS_OK)
-        .header("Content-Type", hfs::http_mime(ext))
+        .header("Content-Type", content_type)
         .header("Cache-Control", "public, max-age=31536000")
-        .header("Last-Modified", hfs::format_date(file_stat.st_mtime))
-        .header("ETag", hfs::etag(file_stat.st_mtime, file_stat.st_size))
-        .body(body);
+        .header("Last-Modified", last_modified)
+        .header("ETag", etag)
+        .header("Accept-Ranges", "bytes")
+        .header("Vary", "Accept-Encoding")
+        .header("Date", hfs::current_date())
+        .file(fd);
+
+    if (!coding.empty())
+        this->__res->header("Content-Encoding", std::string(coding));
 
-    handle_syscall_error(munmap(body, file_stat.st_size), "munmap");
+    if (!ranges.has_value())
+    {
+        this->__res->file_segment(0, size);
+        return;
+    }
+
+    this->__res->status(HTTP_STATUS_PARTIAL_CONTENT);
+
+    if (ranges->size() == 1)
+    {
+        const auto &range = ranges->front();
+
+        this->__res
+            ->header(
+                "Content-Range", hfs::http_range::content_range(range, size)
+            )
+            .file_segment(range.first, range.length());
+
+        return;
+    }
+
+    // Multiple ranges are sent as a `multipart/byteranges` body, where each
+    // part carries its own `Content-Type` and `Content-Range`.
+    std::string boundary = hfs::http_uuid::generate(this->__res.get());
+
+    this->__res->header(
+        "Content-Type", "multipart/byteranges; boundary=" + boundary
+    );
+
+    for (std::size_t i = 0; i < ranges->size(); i++)
+    {
+        const auto &range = (*ranges)[i];
+
+        std::string prefix = i == 0 ? "" : "\r\n";
+
+        prefix += "--" + boundary + "\r\n";
+        prefix += "Content-Type: " + content_type + "\r\n";
+        prefix += "Content-Range: " +
+                  hfs::http_range::content_range(range, size) + "\r\n\r\n";
+
+        this->__res->file_segment(range.first, range.length(), prefix);
+    }
 
-    return 0;
+    this->__res->file_segment(0, 0, "\r\n--" + boundary + "--\r\n");
 }
 
 } // namespace hfs
@@ -2,6 +2,8 @@
 #define __HFS_BLOCKING_HTTP_SERVER_H__ 1
 
 #include <http_core.h>
+#include <http_encoding.h>
+#include <http_range.h>
 #include <http_request.h>
 #include <http_response.h>
 #include <http_server.h>
@@ -42,8 +44,19 @@ private:
     std::unique_ptr<hfs::http_request> __req;
     std::unique_ptr<hfs::http_response> __res;
 
-    int
-    __server_static(int client_socket);
+    /**
+     * @brief The route pattern of the current request, for its metrics.
+     */
+    std::string_view __route;
+
+    bool
+    __open_body(int socket, std::string_view buffered);
+
+    void
+    __dispatch();
+
+    void
+    __server_static();
 };
 
 } // namespace hfs
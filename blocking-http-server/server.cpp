@@ -1,20 +1,27 @@
 #include <http_core.h>
+#include <http_multipart.h>
 #include <http_server.h>
 
 #include "blocking_http_server.h"
 
 int
-main()
+main(int argc, char *argv[])
 {
+    // The port can be overridden, e.g. to run next to another instance
+    int port = argc > 1 ? std::atoi(argv[1]) : 7000;
+
     hfs::http_server_base *server = new hfs::blocking_http_server();
 
-    server->register_handler(
+    // The landing and about pages are the same for everyone, so a render
+    // per second absorbs any spike of traffic on them.
+    server->register_cached_handler(
         "/", "GET",
         [](const hfs::http_request &req, hfs::http_response &res)
         {
             (void)req;
             res.render("index");
-        }
+        },
+        {.ttl = std::chrono::seconds(1)}
     );
 
     server->register_handler(
@@ -39,11 +46,23 @@ main()
         "/login", "POST",
         [](const hfs::http_request &req, hfs::http_response &res)
         {
-            (void)req;
+            hfs::http_form form                 = req.form();
+            std::optional<std::string> email    = form.get("email");
+            std::optional<std::string> password = form.get("password");
 
             inja::json data;
-            data["title"]   = "Login";
-            data["message"] = "Login successful!";
+            data["title"] = "Login";
+
+            if (!email.has_value() || email->empty() || !password.has_value() ||
+                password->empty())
+            {
+                res.status(hfs::HTTP_STATUS_BAD_REQUEST);
+                data["message"] = "Email and password are required.";
+            }
+            else
+            {
+                data["message"] = "Login successful!";
+            }
 
             res.render("login", data);
         }
@@ -72,7 +91,7 @@ main()
         }
     );
 
-    server->register_handler(
+    server->register_cached_handler(
         "/about", "GET",
         [](const hfs::http_request &req, hfs::http_response &res)
         {
@@ -82,7 +101,8 @@ main()
             data["title"] = "About";
 
             res.render("about", data);
-        }
+        },
+        {.ttl = std::chrono::seconds(1)}
     );
 
     server->register_handler(
@@ -113,7 +133,131 @@ main()
         }
     );
 
-    server->listen(7000);
+    server->register_handler(
+        "/export", "GET",
+        [](const hfs::http_request &req, hfs::http_response &res)
+        {
+            (void)req;
+
+            // Stream a large generated document without buffering it
+            res.header("Content-Type", "text/plain; charset=utf-8");
+
+            for (int i = 0; i < 10000; i++)
+            {
+                res.write("line " + std::to_string(i) + "\n");
+            }
+
+            res.end();
+        }
+    );
+
+    server->register_handler(
+        "/upload", "PUT",
+        [](const hfs::http_request &req, hfs::http_response &res)
+        {
+            // Consume the upload by pieces instead of holding it in memory
+            char buf[hfs::HTTP_BUFSZ];
+            std::size_t n, total = 0;
+
+            while ((n = req.body_reader().read(buf, sizeof(buf))) > 0)
+            {
+                total += n;
+            }
+
+            res.header("Content-Type", "text/plain; charset=utf-8")
+                .body("Received " + std::to_string(total) + " bytes\n");
+        }
+    );
+
+    server->register_handler(
+        "/upload", "POST",
+        [](const hfs::http_request &req, hfs::http_response &res)
+        {
+            std::optional<std::string> boundary;
+
+            try
+            {
+                boundary = hfs::http_multipart::boundary(
+                    req.header("Content-Type")
+                );
+            }
+            catch (const std::out_of_range &e)
+            {
+            }
+
+            if (!boundary.has_value())
+            {
+                res.status(hfs::HTTP_STATUS_BAD_REQUEST);
+                throw std::runtime_error("Expected a multipart/form-data body");
+            }
+
+            // File parts go to disk as they arrive, fields stay in memory
+            hfs::http_multipart multipart(req.body_reader(), *boundary);
+            hfs::http_multipart::part part;
+            std::stringstream summary;
+
+            try
+            {
+                while (multipart.next(part))
+                {
+                    if (part.filename.empty())
+                    {
+                        summary << part.name << " = " << multipart.read_all()
+                                << "\n";
+                        continue;
+                    }
+
+                    std::filesystem::path path = multipart.spill();
+
+                    summary << part.name << " = " << part.filename << " ("
+                            << std::filesystem::file_size(path) << " bytes, "
+                            << part.content_type << ")\n";
+
+                    std::filesystem::remove(path);
+                }
+            }
+            catch (const std::runtime_error &e)
+            {
+                res.status(hfs::HTTP_STATUS_BAD_REQUEST);
+                throw;
+            }
+
+            res.header("Content-Type", "text/plain; charset=utf-8")
+                .body(summary.str());
+        }
+    );
+
+    // The navigation bar is the same on every page
+    server->memoize_fragment("components/_navbar.html");
+
+    server->enable_compression();
+    server->enable_access_log({.timing = true});
+
+    // Capturing traffic is opt-in, into the file named by HFS_CAPTURE, and
+    // leaves out the credentials that the forms carry in their bodies.
+    if (const char *capture = std::getenv("HFS_CAPTURE"))
+    {
+        server->enable_capture({
+            .path            = capture,
+            .excluded_routes = {"/login", "/register"},
+        });
+    }
+
+    // The phase timings of each response are sent only when asked for with
+    // HFS_SERVER_TIMING.
+    if (std::getenv("HFS_SERVER_TIMING") != nullptr)
+        server->enable_server_timing();
+
+    // The admin routes are opt-in, since they tell any client about the
+    // traffic of the server. Spans are only recorded when they can be read.
+    if (std::getenv("HFS_ADMIN") != nullptr)
+    {
+        server->enable_tracing();
+        server->register_trace_handler();
+        server->register_metrics_handler();
+    }
+
+    server->listen(port);
     server->start();
 
     delete server;
@@ -0,0 +1,394 @@
+#include <http_access_log.h>
+
+namespace hfs
+{
+/**
+ * @brief Identifies each log, so that the ring cached by a thread is never
+ * mistaken for the ring of another log allocated at the same address.
+ */
+static std::atomic<std::uint64_t> __next_id{1};
+
+template <std::size_t N>
+static void
+__copy(char (&dst)[N], std::string_view src) noexcept
+{
+    std::size_t len = std::min(src.size(), N - 1);
+
+    std::memcpy(dst, src.data(), len);
+    dst[len] = '\0';
+}
+
+http_access_log::http_access_log() : http_access_log(options())
+{
+}
+
+http_access_log::http_access_log(const options &opts)
+    : __opts(opts), __id(__next_id++), __fd(-1), __size(0), __running(true),
+      __dropped(0)
+{
+    this->__open();
+    this->__writer = std::thread(&http_access_log::__run, this);
+}
+
+http_access_log::~http_access_log()
+{
+    this->__running.store(false, std::memory_order_release);
+
+    if (this->__writer.joinable())
+        this->__writer.join();
+
+    if (this->__fd != -1)
+        close(this->__fd);
+}
+
+http_access_record
+http_access_log::record(
+    const hfs::http_request &req, const hfs::http_response &res,
+    std::string_view client, std::chrono::system_clock::time_point accepted,
+    std::size_t bytes
+) noexcept
+{
+    using namespace std::chrono;
+
+    http_access_record record;
+    auto now = system_clock::now();
+
+    record.timestamp =
+        duration_cast<microseconds>(accepted.time_since_epoch()).count();
+    record.duration = duration_cast<microseconds>(now - accepted).count();
+    record.status   = res.status();
+    record.bytes    = bytes;
+
+    __copy(record.method, req.method());
+    __copy(record.request_id, req.uuid());
+    __copy(record.client, client);
+    __copy(record.path, req.path());
+
+    for (std::size_t i = 0; i < http_timing::SPANS.size(); i++)
+    {
+        const auto &span = http_timing::SPANS[i];
+        std::optional<microseconds> elapsed =
+            res.timing().elapsed(span.from, span.to);
+
+        record.timing[i] =
+            elapsed.has_value()
+                ? std::clamp<std::int64_t>(
+                      elapsed->count(), 0, http_access_record::UNTIMED - 1
+                  )
+                : http_access_record::UNTIMED;
+    }
+
+    return record;
+}
+
+void
+http_access_log::log(const http_access_record &record) noexcept
+{
+    ring_t *ring = this->__ring();
+
+    if (ring == nullptr || !ring->try_push(record))
+        this->__dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::size_t
+http_access_log::dropped() const noexcept
+{
+    return this->__dropped.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Retrieve the ring of the calling thread, creating it on the first
+ * call. The mutex is only taken then.
+ *
+ * A thread keeps the ring it has for each log, so that writing to several
+ * logs in turn does not create a ring on every switch. The last one is
+ * checked first, since a thread mostly writes to a single log.
+ */
+http_access_log::ring_t *
+http_access_log::__ring()
+{
+    thread_local struct
+    {
+        std::uint64_t owner = 0;
+        ring_t *ring        = nullptr;
+        std::unordered_map<std::uint64_t, ring_t *> rings;
+    } cache;
+
+    if (cache.owner == this->__id)
+        return cache.ring;
+
+    try
+    {
+        auto [it, inserted] = cache.rings.try_emplace(this->__id, nullptr);
+
+        if (inserted)
+        {
+            try
+            {
+                auto ring = std::make_unique<ring_t>();
+                std::lock_guard<std::mutex> lock(this->__rings_mutex);
+
+                it->second = ring.get();
+                this->__rings.push_back(std::move(ring));
+            }
+            catch (const std::bad_alloc &e)
+            {
+                cache.rings.erase(it);
+                throw;
+            }
+        }
+
+        cache.owner = this->__id;
+        cache.ring  = it->second;
+    }
+    catch (const std::bad_alloc &e)
+    {
+        return nullptr;
+    }
+
+    return cache.ring;
+}
+
+/**
+ * @brief Format a record as a line of the Common Log Format, followed by the
+ * duration and the request ID:
+ *
+ * ```
+ * ::1 - - [19/Oct/2026:13:08:14 +0000] "GET /about" 200 5120 812us 5f0c...
+ * ```
+ *
+ * With `timing`, the spans of the request that have been reached follow.
+ */
+static void
+__format(const http_access_record &record, bool timing, std::string &out)
+{
+    // Consecutive records mostly fall in the same second
+    thread_local std::int64_t cached_second = -1;
+    thread_local char date[32];
+
+    std::int64_t second = record.timestamp / 1000000;
+
+    if (second != cached_second)
+    {
+        struct tm tm;
+        time_t t = second;
+
+        gmtime_r(&t, &tm);
+        strftime(date, sizeof(date), "%d/%b/%Y:%H:%M:%S +0000", &tm);
+        cached_second = second;
+    }
+
+    char line[192];
+    int len = std::snprintf(
+        line, sizeof(line), "%s - - [%s] \"%s ", record.client, date,
+        record.method
+    );
+
+    out.append(line, std::min<std::size_t>(len, sizeof(line) - 1));
+
+    // The path is decoded, so quotes and control characters are escaped to
+    // keep one request per line.
+    for (const char *c = record.path; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\' || (unsigned char)*c < 0x20 ||
+            (unsigned char)*c == 0x7f)
+        {
+            len = std::snprintf(line, sizeof(line), "\\x%02x", *c);
+            out.append(line, len);
+            continue;
+        }
+
+        out.push_back(*c);
+    }
+
+    len = std::snprintf(
+        line, sizeof(line), "\" %u %llu %uus %s", (unsigned)record.status,
+        (unsigned long long)record.bytes, (unsigned)record.duration,
+        record.request_id
+    );
+
+    out.append(line, std::min<std::size_t>(len, sizeof(line) - 1));
+
+    for (std::size_t i = 0; timing && i < http_timing::SPANS.size(); i++)
+    {
+        if (record.timing[i] == http_access_record::UNTIMED)
+            continue;
+
+        std::string_view name = http_timing::SPANS[i].name;
+        len                   = std::snprintf(
+            line, sizeof(line), " %.*s=%uus", (int)name.size(), name.data(),
+            (unsigned)record.timing[i]
+        );
+
+        out.append(line, std::min<std::size_t>(len, sizeof(line) - 1));
+    }
+
+    out.push_back('\n');
+}
+
+std::size_t
+http_access_log::__drain(std::string &batch)
+{
+    std::lock_guard<std::mutex> lock(this->__rings_mutex);
+    std::size_t count = 0;
+    http_access_record record;
+
+    for (auto &ring : this->__rings)
+    {
+        while (ring->try_pop(record))
+        {
+            if (this->__opts.binary)
+                this->__encoder.encode(record, this->__opts.timing, batch);
+            else
+                __format(record, this->__opts.timing, batch);
+
+            count++;
+        }
+    }
+
+    return count;
+}
+
+void
+http_access_log::__run()
+{
+    using namespace std::chrono;
+
+    std::string batch;
+    auto last_write = steady_clock::now();
+
+    batch.reserve(hfs::HTTP_LOG_BATCHSZ * 2);
+
+    while (this->__running.load(std::memory_order_acquire))
+    {
+        std::size_t count = this->__drain(batch);
+        auto now          = steady_clock::now();
+
+        if (batch.size() >= hfs::HTTP_LOG_BATCHSZ ||
+            (!batch.empty() && now - last_write >= this->__opts.flush_interval))
+        {
+            this->__write(batch);
+            batch.clear();
+            last_write = now;
+        }
+
+        if (count == 0)
+            std::this_thread::sleep_for(milliseconds(10));
+    }
+
+    this->__drain(batch);
+    this->__write(batch);
+}
+
+void
+http_access_log::__write(const std::string &batch)
+{
+    if (batch.empty())
+        return;
+
+    this->__append(batch);
+
+    // Rotating only between batches keeps the paths defined by a binary
+    // batch in the same file as the records that refer to them.
+    if (this->__opts.max_size > 0 && this->__size >= this->__opts.max_size)
+        this->__rotate();
+}
+
+void
+http_access_log::__append(std::string_view data)
+{
+    if (this->__fd == -1)
+        return;
+
+    for (std::size_t written = 0; written < data.size();)
+    {
+        ssize_t ret =
+            ::write(this->__fd, data.data() + written, data.size() - written);
+
+        if (ret == -1 && errno == EINTR)
+            continue;
+
+        if (ret == -1)
+        {
+            std::cerr << "access log: write: " << std::strerror(errno)
+                      << std::endl;
+            return;
+        }
+
+        written += ret;
+        this->__size += ret;
+    }
+}
+
+void
+http_access_log::__open()
+{
+    this->__fd = open(
+        this->__opts.path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+        0644
+    );
+
+    if (this->__fd == -1)
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__,
+            "Failed to open " + this->__opts.path.string() + ": " +
+                std::strerror(errno)
+        ));
+    }
+
+    struct stat st;
+    this->__size = fstat(this->__fd, &st) == 0 ? st.st_size : 0;
+
+    if (this->__opts.binary)
+    {
+        using namespace std::chrono;
+
+        std::string header;
+        this->__encoder.reset(
+            duration_cast<microseconds>(
+                system_clock::now().time_since_epoch()
+            ).count(),
+            header
+        );
+        this->__append(header);
+    }
+}
+
+void
+http_access_log::__rotate()
+{
+    std::error_code ec;
+    std::string base = this->__opts.path.string();
+
+    close(this->__fd);
+    this->__fd = -1;
+
+    // access.log.(n-1) -> access.log.n, ..., access.log -> access.log.1
+    if (this->__opts.max_files == 0)
+    {
+        std::filesystem::remove(base, ec);
+    }
+    else
+    {
+        for (std::size_t i = this->__opts.max_files - 1; i > 0; i--)
+        {
+            std::filesystem::rename(
+                base + "." + std::to_string(i),
+                base + "." + std::to_string(i + 1), ec
+            );
+        }
+
+        std::filesystem::rename(base, base + ".1", ec);
+    }
+
+    try
+    {
+        this->__open();
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::cerr << "access log: " << e.what() << std::endl;
+    }
+}
+} // namespace hfs
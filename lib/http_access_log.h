@@ -0,0 +1,197 @@
+#ifndef __HTTP_ACCESS_LOG_H__
+#define __HTTP_ACCESS_LOG_H__ 1
+
+#include <http_binary_log.h>
+#include <http_core.h>
+#include <http_request.h>
+#include <http_response.h>
+#include <http_ring.h>
+#include <http_timing.h>
+
+namespace hfs
+{
+/**
+ * @brief One line of the access log. The record has a fixed size, so that
+ * it can be copied into a ring buffer without any allocation; longer paths
+ * are truncated.
+ */
+struct http_access_record
+{
+    /**
+     * @brief The time the request was accepted, in microseconds since the
+     * epoch.
+     */
+    std::int64_t timestamp;
+
+    /**
+     * @brief The time spent on the request, in microseconds.
+     */
+    std::uint32_t duration;
+
+    std::uint16_t status;
+    std::uint64_t bytes;
+    char method[8];
+    char request_id[40];
+    char client[INET6_ADDRSTRLEN];
+    char path[hfs::HTTP_LOG_PATHSZ];
+
+    /**
+     * @brief The duration of each span of `http_timing::SPANS`, in
+     * microseconds, or `UNTIMED` if the span has not been reached.
+     */
+    std::uint32_t timing[hfs::http_timing::SPANS.size()];
+
+    static constexpr std::uint32_t UNTIMED = 0xffffffff;
+};
+
+/**
+ * @brief Asynchronous access log.
+ *
+ * Request threads push records into a ring buffer of their own, which is
+ * lock-free and never blocks: when a ring is full, the record is dropped and
+ * counted. A background thread drains the rings, formats the records and
+ * writes them to the log file in large batches, rotating the file when it
+ * grows past a size limit. Records are written either as text lines or,
+ * on the busiest servers, in a binary format that costs no formatting.
+ *
+ * For example:
+ *
+ * @code
+ * ```cpp
+ * server->enable_access_log({.path = "/var/log/hfs/access.log"});
+ * ```
+ * @endcode
+ */
+class http_access_log
+{
+public:
+    struct options
+    {
+        std::filesystem::path path = "access.log";
+
+        /**
+         * @brief The size past which the file is rotated, or 0 to never
+         * rotate it. Batches are not split, so a file may exceed it by one.
+         */
+        std::size_t max_size = 64 * 1024 * 1024;
+
+        /**
+         * @brief The number of rotated files kept, as `access.log.1` (the
+         * most recent) to `access.log.<max_files>`.
+         */
+        std::size_t max_files = 5;
+
+        /**
+         * @brief The longest time a record waits in memory before it is
+         * written, when there is not enough traffic to fill a batch.
+         */
+        std::chrono::milliseconds flush_interval{200};
+
+        /**
+         * @brief Write records in the compact format of `http_binary_log`
+         * instead of text lines. `hfs-logdump` turns such a file into JSON
+         * lines.
+         */
+        bool binary = false;
+
+        /**
+         * @brief Append the duration of each phase of the request, e.g.
+         * `parse=12us handler=810us`, as measured by `http_timing`.
+         */
+        bool timing = false;
+    };
+
+    /**
+     * @brief Open `access.log` in the working directory and start the writer
+     * thread.
+     *
+     * @throw `std::runtime_error` - If the log file cannot be opened.
+     */
+    http_access_log();
+
+    /**
+     * @brief Open the log file and start the writer thread.
+     *
+     * @throw `std::runtime_error` - If the log file cannot be opened.
+     */
+    explicit http_access_log(const options &opts);
+
+    /**
+     * @brief Stop the writer thread once every pending record is written.
+     */
+    ~http_access_log();
+
+    http_access_log(const http_access_log &) = delete;
+
+    http_access_log &
+    operator=(const http_access_log &) = delete;
+
+    /**
+     * @brief Build the record of a request that has been answered.
+     *
+     * @param req - The request.
+     * @param res - The response.
+     * @param client - The address of the client.
+     * @param accepted - The time the connection was accepted.
+     * @param bytes - The number of bytes sent to the client.
+     */
+    static http_access_record
+    record(
+        const hfs::http_request &req, const hfs::http_response &res,
+        std::string_view client,
+        std::chrono::system_clock::time_point accepted, std::size_t bytes
+    ) noexcept;
+
+    /**
+     * @brief Queue a record from the calling thread. This never blocks nor
+     * allocates, except on the first call of each thread.
+     */
+    void
+    log(const http_access_record &record) noexcept;
+
+    /**
+     * @brief Retrieve the number of records dropped because a ring was full.
+     */
+    std::size_t
+    dropped() const noexcept;
+
+private:
+    using ring_t = hfs::http_ring<http_access_record, 1024>;
+
+    options __opts;
+    std::uint64_t __id;
+    int __fd;
+    std::size_t __size;
+    hfs::http_binary_log::encoder __encoder;
+
+    std::mutex __rings_mutex;
+    std::vector<std::unique_ptr<ring_t>> __rings;
+
+    std::atomic<bool> __running;
+    std::atomic<std::size_t> __dropped;
+    std::thread __writer;
+
+    ring_t *
+    __ring();
+
+    void
+    __run();
+
+    std::size_t
+    __drain(std::string &batch);
+
+    void
+    __write(const std::string &batch);
+
+    void
+    __append(std::string_view data);
+
+    void
+    __open();
+
+    void
+    __rotate();
+};
+} // namespace hfs
+
+#endif // __HTTP_ACCESS_LOG_H__
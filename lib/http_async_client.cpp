@@ -0,0 +1,819 @@
+#include <http_async_client.h>
+
+namespace hfs
+{
+/**
+ * @brief The number of events handled by one call to `epoll_wait`.
+ */
+static constexpr int __MAX_EVENTS = 64;
+
+http_async_client::http_async_client() : http_async_client(options())
+{
+}
+
+http_async_client::http_async_client(const options &opts)
+    : __opts(opts), __epoll(-1), __wakeup(-1), __resolver_stopping(false),
+      __running(false)
+{
+    this->__epoll = epoll_create1(EPOLL_CLOEXEC);
+
+    if (this->__epoll == -1)
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__,
+            "epoll_create1: " + std::string(std::strerror(errno))
+        ));
+    }
+
+    this->__wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    struct epoll_event ev;
+    ev.events   = EPOLLIN;
+    ev.data.ptr = nullptr;
+
+    if (this->__wakeup == -1 ||
+        epoll_ctl(this->__epoll, EPOLL_CTL_ADD, this->__wakeup, &ev) == -1)
+    {
+        std::string error = std::strerror(errno);
+
+        if (this->__wakeup != -1)
+            close(this->__wakeup);
+
+        close(this->__epoll);
+
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__, "Failed to create the wakeup event: " + error
+        ));
+    }
+
+    this->__resolver = std::thread(&http_async_client::__run_resolver, this);
+
+    if (opts.thread)
+    {
+        this->__running = true;
+        this->__loop    = std::thread(&http_async_client::__run, this);
+    }
+}
+
+http_async_client::~http_async_client()
+{
+    if (this->__loop.joinable())
+    {
+        this->__running.store(false, std::memory_order_release);
+
+        std::uint64_t one = 1;
+
+        if (write(this->__wakeup, &one, sizeof(one)) == -1)
+        {
+        }
+
+        this->__loop.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->__resolver_mutex);
+        this->__resolver_stopping = true;
+    }
+
+    this->__resolver_cv.notify_one();
+    this->__resolver.join();
+
+    this->__accept_submitted();
+
+    for (auto &[key, pool] : this->__pools)
+    {
+        for (auto &conn : pool->connections)
+        {
+            for (auto &req : conn->inflight)
+                __fail(req, "Client shut down");
+
+            close(conn->fd);
+        }
+
+        for (auto &req : pool->queue)
+            __fail(req, "Client shut down");
+    }
+
+    close(this->__wakeup);
+    close(this->__epoll);
+}
+
+std::future<http_client::response>
+http_async_client::send(request req)
+{
+    auto promise = std::make_shared<std::promise<http_client::response>>();
+    std::future<http_client::response> future = promise->get_future();
+
+    this->send(
+        std::move(req),
+        [promise](std::exception_ptr error, http_client::response res)
+        {
+            if (error)
+                promise->set_exception(error);
+            else
+                promise->set_value(std::move(res));
+        }
+    );
+
+    return future;
+}
+
+void
+http_async_client::send(request req, callback done)
+{
+    __request pending;
+
+    pending.key  = req.host + ":" + req.port;
+    pending.host = req.host;
+    pending.port = req.port;
+    pending.wire = http_client::serialize(
+        req.host, req.port, req.method, req.target, req.headers, req.body
+    );
+    pending.head       = req.method == "HEAD";
+    pending.idempotent = hfs::idempotent(req.method);
+    pending.retried    = false;
+    pending.deadline = std::chrono::steady_clock::now() + this->__opts.timeout;
+    pending.done     = std::move(done);
+
+    {
+        std::lock_guard<std::mutex> lock(this->__mutex);
+        this->__submitted.push_back(std::move(pending));
+    }
+
+    std::uint64_t one = 1;
+
+    if (write(this->__wakeup, &one, sizeof(one)) == -1)
+    {
+    }
+}
+
+int
+http_async_client::fd() const noexcept
+{
+    return this->__epoll;
+}
+
+void
+http_async_client::poll(std::chrono::milliseconds timeout)
+{
+    using namespace std::chrono;
+
+    auto now      = steady_clock::now();
+    auto deadline = std::min(now + timeout, this->__next_deadline());
+    auto wait     = std::max(ceil<milliseconds>(deadline - now).count(), 0L);
+
+    struct epoll_event events[__MAX_EVENTS];
+    int count = epoll_wait(this->__epoll, events, __MAX_EVENTS, wait);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (events[i].data.ptr == nullptr)
+        {
+            std::uint64_t value;
+
+            if (read(this->__wakeup, &value, sizeof(value)) == -1)
+            {
+            }
+
+            continue;
+        }
+
+        this->__on_event(
+            *(__connection *)events[i].data.ptr, events[i].events
+        );
+    }
+
+    this->__accept_submitted();
+    this->__accept_resolved();
+    this->__expire(steady_clock::now());
+
+    for (auto &[key, pool] : this->__pools)
+        this->__dispatch(*pool);
+
+    // Connections closed above may still have had events in the batch
+    this->__closed.clear();
+}
+
+void
+http_async_client::__run()
+{
+    while (this->__running.load(std::memory_order_acquire))
+        this->poll(std::chrono::milliseconds(1000));
+}
+
+/**
+ * @brief Hand the host of a pool over to the resolver thread. Its requests
+ * wait in the queue until the addresses come back.
+ */
+void
+http_async_client::__resolve(__pool &pool)
+{
+    pool.resolving = true;
+
+    {
+        std::lock_guard<std::mutex> lock(this->__resolver_mutex);
+        this->__lookups.push_back(&pool);
+    }
+
+    this->__resolver_cv.notify_one();
+}
+
+void
+http_async_client::__run_resolver()
+{
+    std::unique_lock<std::mutex> lock(this->__resolver_mutex);
+
+    for (;;)
+    {
+        this->__resolver_cv.wait(
+            lock,
+            [this]
+            { return this->__resolver_stopping || !this->__lookups.empty(); }
+        );
+
+        if (this->__resolver_stopping)
+            return;
+
+        const __pool *pool = this->__lookups.front();
+        this->__lookups.pop_front();
+
+        // The event loop keeps queuing lookups while this one blocks
+        lock.unlock();
+
+        __resolution resolution;
+        resolution.key = pool->key;
+
+        try
+        {
+            resolution.addresses = __lookup(pool->host, pool->port);
+        }
+        catch (const std::runtime_error &e)
+        {
+            resolution.error = e.what();
+        }
+
+        lock.lock();
+        this->__resolved.push_back(std::move(resolution));
+
+        std::uint64_t one = 1;
+
+        if (write(this->__wakeup, &one, sizeof(one)) == -1)
+        {
+        }
+    }
+}
+
+http_async_client::__addresses
+http_async_client::__lookup(const std::string &host, const std::string &port)
+{
+    struct addrinfo hints, *info;
+
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    int ret = getaddrinfo(host.c_str(), port.c_str(), &hints, &info);
+
+    if (ret != 0)
+    {
+        throw std::runtime_error(
+            "Failed to resolve " + host + ":" + port + ": " + gai_strerror(ret)
+        );
+    }
+
+    auto addresses = std::make_shared<std::vector<__address>>();
+
+    for (struct addrinfo *ai = info; ai != nullptr; ai = ai->ai_next)
+    {
+        __address address;
+
+        std::memcpy(&address.addr, ai->ai_addr, ai->ai_addrlen);
+        address.addrlen = ai->ai_addrlen;
+
+        addresses->push_back(address);
+    }
+
+    freeaddrinfo(info);
+
+    return addresses;
+}
+
+void
+http_async_client::__accept_submitted()
+{
+    std::vector<__request> submitted;
+
+    {
+        std::lock_guard<std::mutex> lock(this->__mutex);
+        submitted.swap(this->__submitted);
+    }
+
+    for (auto &req : submitted)
+    {
+        std::unique_ptr<__pool> &pool = this->__pools[req.key];
+
+        if (!pool)
+        {
+            pool               = std::make_unique<__pool>();
+            pool->key          = req.key;
+            pool->host         = req.host;
+            pool->port         = req.port;
+            pool->resolving    = false;
+            pool->next_address = 0;
+        }
+
+        pool->queue.push_back(std::move(req));
+    }
+}
+
+/**
+ * @brief Store the addresses resolved since the last iteration, or fail the
+ * requests queued for a host that cannot be resolved.
+ */
+void
+http_async_client::__accept_resolved()
+{
+    std::vector<__resolution> resolved;
+
+    {
+        std::lock_guard<std::mutex> lock(this->__resolver_mutex);
+        resolved.swap(this->__resolved);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto &resolution : resolved)
+    {
+        __pool &pool   = *this->__pools.at(resolution.key);
+        pool.resolving = false;
+
+        if (resolution.addresses != nullptr)
+        {
+            pool.addresses = std::move(resolution.addresses);
+            pool.expires   = now + this->__opts.dns_ttl;
+            continue;
+        }
+
+        for (auto &req : pool.queue)
+            __fail(req, resolution.error);
+
+        pool.queue.clear();
+    }
+}
+
+/**
+ * @brief Assign the queued requests of a host to its connections: an idle
+ * connection first, then a new one, then the least busy persistent
+ * connection that only has idempotent requests in flight.
+ */
+void
+http_async_client::__dispatch(__pool &pool)
+{
+    while (!pool.queue.empty())
+    {
+        __request &req       = pool.queue.front();
+        __connection *conn   = nullptr;
+        __connection *behind = nullptr;
+
+        for (auto &candidate : pool.connections)
+        {
+            std::deque<__request> &inflight = candidate->inflight;
+
+            if (inflight.empty())
+            {
+                conn = candidate.get();
+                break;
+            }
+
+            if (!req.idempotent || !candidate->persistent ||
+                inflight.size() >= this->__opts.pipeline ||
+                (behind != nullptr &&
+                 inflight.size() >= behind->inflight.size()))
+            {
+                continue;
+            }
+
+            // Nothing is pipelined behind a request that cannot be retried
+            if (std::all_of(
+                    inflight.begin(), inflight.end(),
+                    [](const __request &r) { return r.idempotent; }
+                ))
+            {
+                behind = candidate.get();
+            }
+        }
+
+        bool room = conn == nullptr &&
+                    pool.connections.size() < this->__opts.max_connections;
+        bool resolved = pool.addresses != nullptr &&
+                        pool.expires > std::chrono::steady_clock::now();
+
+        // Pipelined connections are still used while the host is resolved
+        if (room && !resolved)
+        {
+            if (!pool.resolving)
+                this->__resolve(pool);
+        }
+        else if (room)
+        {
+            try
+            {
+                conn = this->__open(pool);
+            }
+            catch (const std::runtime_error &e)
+            {
+                __fail(req, e.what());
+                pool.queue.pop_front();
+                continue;
+            }
+        }
+
+        if (conn == nullptr)
+            conn = behind;
+
+        if (conn == nullptr)
+            break;
+
+        conn->out.append(req.wire);
+        conn->inflight.push_back(std::move(req));
+        pool.queue.pop_front();
+
+        if (!conn->connecting)
+            this->__flush(*conn);
+    }
+}
+
+http_async_client::__connection *
+http_async_client::__open(__pool &pool)
+{
+    // Spread the connections over the addresses of the host
+    const std::vector<__address> &addresses = *pool.addresses;
+    const __address &address =
+        addresses[pool.next_address++ % addresses.size()];
+
+    int fd = socket(
+        address.addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+        IPPROTO_TCP
+    );
+
+    if (fd == -1)
+    {
+        throw std::runtime_error(
+            "socket: " + std::string(std::strerror(errno))
+        );
+    }
+
+    if (connect(fd, (struct sockaddr *)&address.addr, address.addrlen) == -1 &&
+        errno != EINPROGRESS)
+    {
+        std::string error = std::strerror(errno);
+
+        close(fd);
+
+        // The next connections resolve the host again
+        pool.addresses = nullptr;
+
+        throw std::runtime_error(
+            "Failed to connect to " + pool.key + ": " + error
+        );
+    }
+
+    // Requests are small and latency matters more than packet count
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+    auto conn        = std::make_unique<__connection>();
+    auto now         = std::chrono::steady_clock::now();
+    conn->fd         = fd;
+    conn->pool       = &pool;
+    conn->connecting = true;
+    conn->writing    = true;
+    conn->persistent = false;
+    conn->idle_since = now;
+    conn->connect_deadline = now + this->__opts.connect_timeout;
+
+    // The connection is established once the socket is writable
+    struct epoll_event ev;
+    ev.events   = EPOLLIN | EPOLLOUT;
+    ev.data.ptr = conn.get();
+
+    if (epoll_ctl(this->__epoll, EPOLL_CTL_ADD, fd, &ev) == -1)
+    {
+        std::string error = std::strerror(errno);
+
+        close(fd);
+
+        throw std::runtime_error("epoll_ctl: " + error);
+    }
+
+    pool.connections.push_back(std::move(conn));
+
+    return pool.connections.back().get();
+}
+
+/**
+ * @brief Watch for writability only while there are bytes to write, or while
+ * the connection is being established.
+ */
+void
+http_async_client::__watch(__connection &conn) noexcept
+{
+    bool writing = conn.connecting || !conn.out.empty();
+
+    if (writing == conn.writing)
+        return;
+
+    struct epoll_event ev;
+    ev.events   = writing ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    ev.data.ptr = &conn;
+
+    epoll_ctl(this->__epoll, EPOLL_CTL_MOD, conn.fd, &ev);
+    conn.writing = writing;
+}
+
+void
+http_async_client::__on_event(__connection &conn, std::uint32_t events)
+{
+    if (conn.fd == -1)
+        return;
+
+    if (conn.connecting)
+    {
+        if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+            return;
+
+        int error       = 0;
+        socklen_t len   = sizeof(error);
+        std::string key = conn.pool->key;
+
+        getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &error, &len);
+
+        if (error != 0)
+        {
+            conn.pool->addresses = nullptr;
+            this->__abort(
+                conn,
+                "Failed to connect to " + key + ": " + std::strerror(error)
+            );
+            return;
+        }
+
+        conn.connecting = false;
+    }
+
+    if (events & EPOLLOUT)
+        this->__flush(conn);
+
+    if (conn.fd != -1 && (events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+        this->__receive(conn);
+}
+
+void
+http_async_client::__flush(__connection &conn)
+{
+    std::size_t sent = 0;
+
+    while (sent < conn.out.size())
+    {
+        ssize_t ret = ::send(
+            conn.fd, conn.out.data() + sent, conn.out.size() - sent,
+            MSG_NOSIGNAL
+        );
+
+        if (ret == -1 && errno == EINTR)
+            continue;
+
+        if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+
+        if (ret == -1)
+        {
+            this->__abort(conn, "send: " + std::string(std::strerror(errno)));
+            return;
+        }
+
+        sent += ret;
+    }
+
+    conn.out.erase(0, sent);
+    this->__watch(conn);
+}
+
+void
+http_async_client::__receive(__connection &conn)
+{
+    char buf[16 * 1024];
+    bool closed = false;
+
+    for (;;)
+    {
+        ssize_t ret = recv(conn.fd, buf, sizeof(buf), 0);
+
+        if (ret == -1 && errno == EINTR)
+            continue;
+
+        if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+
+        if (ret == -1)
+        {
+            this->__abort(conn, "recv: " + std::string(std::strerror(errno)));
+            return;
+        }
+
+        if (ret == 0)
+        {
+            closed = true;
+            break;
+        }
+
+        conn.in.append(buf, ret);
+    }
+
+    // Pipelined responses arrive in the order of the requests
+    while (!conn.inflight.empty())
+    {
+        http_client::response res;
+        std::size_t size;
+
+        try
+        {
+            size = http_client::parse(
+                conn.in, res, conn.inflight.front().head, closed
+            );
+        }
+        catch (const std::runtime_error &e)
+        {
+            this->__abort(conn, e.what(), false);
+            return;
+        }
+
+        if (size == 0)
+            break;
+
+        __request req = std::move(conn.inflight.front());
+        bool keep_alive = res.keep_alive;
+
+        conn.in.erase(0, size);
+        conn.inflight.pop_front();
+
+        __deliver(req, nullptr, std::move(res));
+
+        if (!keep_alive)
+        {
+            this->__abort(conn, "Connection closed by " + conn.pool->key);
+            return;
+        }
+
+        conn.persistent = true;
+    }
+
+    if (closed)
+    {
+        this->__abort(conn, "Connection closed by " + conn.pool->key);
+        return;
+    }
+
+    if (conn.inflight.empty())
+    {
+        if (!conn.in.empty())
+        {
+            this->__abort(conn, "Unsolicited bytes from " + conn.pool->key);
+            return;
+        }
+
+        conn.idle_since = std::chrono::steady_clock::now();
+    }
+}
+
+/**
+ * @brief Close a connection. Its idempotent requests go back to the front of
+ * the queue once, when they still have time, and the others fail.
+ */
+void
+http_async_client::__abort(
+    __connection &conn, const std::string &message, bool retry
+)
+{
+    auto now    = std::chrono::steady_clock::now();
+    __pool &pool = *conn.pool;
+
+    close(conn.fd);
+    conn.fd = -1;
+
+    for (auto it = conn.inflight.rbegin(); it != conn.inflight.rend(); it++)
+    {
+        if (retry && it->idempotent && !it->retried && it->deadline > now)
+        {
+            it->retried = true;
+            pool.queue.push_front(std::move(*it));
+        }
+        else
+        {
+            __fail(*it, message);
+        }
+    }
+
+    conn.inflight.clear();
+
+    auto it = std::find_if(
+        pool.connections.begin(), pool.connections.end(),
+        [&conn](const std::unique_ptr<__connection> &c)
+        { return c.get() == &conn; }
+    );
+
+    this->__closed.push_back(std::move(*it));
+    pool.connections.erase(it);
+}
+
+void
+http_async_client::__expire(std::chrono::steady_clock::time_point now)
+{
+    for (auto &[key, pool] : this->__pools)
+    {
+        for (std::size_t i = 0; i < pool->queue.size();)
+        {
+            if (pool->queue[i].deadline > now)
+            {
+                i++;
+                continue;
+            }
+
+            __fail(pool->queue[i], "Timed out waiting for a connection");
+            pool->queue.erase(pool->queue.begin() + i);
+        }
+
+        std::vector<__connection *> connections;
+
+        for (auto &conn : pool->connections)
+            connections.push_back(conn.get());
+
+        for (__connection *conn : connections)
+        {
+            if (conn->connecting && conn->connect_deadline <= now)
+                this->__abort(*conn, "Timed out connecting to " + key);
+            else if (!conn->inflight.empty() &&
+                     conn->inflight.front().deadline <= now)
+                this->__abort(*conn, "Timed out waiting for " + key);
+            else if (conn->inflight.empty() &&
+                     conn->idle_since + this->__opts.idle_timeout <= now)
+                this->__abort(*conn, "Idle");
+        }
+    }
+}
+
+std::chrono::steady_clock::time_point
+http_async_client::__next_deadline() const noexcept
+{
+    auto deadline = std::chrono::steady_clock::time_point::max();
+
+    for (const auto &[key, pool] : this->__pools)
+    {
+        // Retried requests go to the front, so the front expires first
+        if (!pool->queue.empty())
+            deadline = std::min(deadline, pool->queue.front().deadline);
+
+        for (const auto &conn : pool->connections)
+        {
+            if (conn->connecting)
+                deadline = std::min(deadline, conn->connect_deadline);
+
+            if (!conn->inflight.empty())
+                deadline = std::min(deadline, conn->inflight.front().deadline);
+            else
+                deadline = std::min(
+                    deadline, conn->idle_since + this->__opts.idle_timeout
+                );
+        }
+    }
+
+    return deadline;
+}
+
+void
+http_async_client::__fail(__request &req, const std::string &message) noexcept
+{
+    __deliver(
+        req,
+        std::make_exception_ptr(std::runtime_error(
+            hfs::format_function_error(__FILE__, __LINE__, message)
+        )),
+        {}
+    );
+}
+
+void
+http_async_client::__deliver(
+    __request &req, std::exception_ptr error, http_client::response res
+) noexcept
+{
+    try
+    {
+        if (req.done)
+            req.done(error, std::move(res));
+    }
+    catch (...)
+    {
+    }
+}
+} // namespace hfs
@@ -0,0 +1,327 @@
+#ifndef __HTTP_ASYNC_CLIENT_H__
+#define __HTTP_ASYNC_CLIENT_H__ 1
+
+#include <http_client.h>
+#include <http_core.h>
+
+namespace hfs
+{
+/**
+ * @brief Non-blocking HTTP/1.1 client for calling other services from a
+ * handler without stalling it on the network.
+ *
+ * Requests are multiplexed by an `epoll` event loop over a pool of
+ * keep-alive connections per host. A request waits in the queue of its host
+ * until a connection is idle, or a new one may be opened, or it can be
+ * pipelined behind the requests in flight on a connection. Responses are
+ * parsed with `http_client::parse`, as they arrive.
+ *
+ * The event loop either runs on a thread of its own, or on the event loop
+ * of the owner, which watches `fd` and calls `poll`. Hosts are resolved on
+ * a thread of the client, so that neither `send` nor the event loop waits
+ * on DNS, and their addresses are kept for `dns_ttl`.
+ *
+ * For example:
+ *
+ * @code
+ * ```cpp
+ * hfs::http_async_client client;
+ *
+ * std::future<hfs::http_client::response> about =
+ *     client.send({.host = "localhost", .port = "7000", .target = "/about"});
+ *
+ * client.send(
+ *     {.host = "localhost", .port = "7000", .target = "/blogs"},
+ *     [](std::exception_ptr error, hfs::http_client::response res)
+ *     {
+ *         if (!error)
+ *             std::cout << res.status << std::endl;
+ *     }
+ * );
+ *
+ * std::cout << about.get().body.size() << std::endl;
+ * ```
+ * @endcode
+ */
+class http_async_client
+{
+public:
+    struct options
+    {
+        /**
+         * @brief The number of connections that may be open to a host.
+         */
+        std::size_t max_connections = 8;
+
+        /**
+         * @brief The number of requests that may be in flight on a
+         * connection. Only idempotent requests are pipelined, only on
+         * connections that the server has kept open after a response, and
+         * only when every connection is busy and no other may be opened.
+         */
+        std::size_t pipeline = 4;
+
+        /**
+         * @brief The time a connection may take to be established.
+         */
+        std::chrono::milliseconds connect_timeout{2000};
+
+        /**
+         * @brief The time a request may take from `send` to the end of its
+         * response, queuing included.
+         */
+        std::chrono::milliseconds timeout{10000};
+
+        /**
+         * @brief The time an idle connection is kept open for reuse.
+         */
+        std::chrono::milliseconds idle_timeout{30000};
+
+        /**
+         * @brief The time the addresses of a host are reused before it is
+         * resolved again.
+         */
+        std::chrono::milliseconds dns_ttl{30000};
+
+        /**
+         * @brief Whether the event loop runs on a thread of its own. When it
+         * does not, the owner must call `poll` whenever `fd` is readable, and
+         * at least every few milliseconds to enforce the timeouts.
+         */
+        bool thread = true;
+    };
+
+    struct request
+    {
+        std::string host;
+        std::string port = "80";
+        std::string method = "GET";
+        std::string target = "/";
+
+        /**
+         * @brief Additional header fields. `Host`, `User-Agent` and
+         * `Content-Length` are set by the client.
+         */
+        std::vector<std::pair<std::string, std::string>> headers;
+
+        std::string body;
+    };
+
+    /**
+     * @brief Receives the outcome of a request, on the event loop. Either
+     * `error` is set, or `res` is the response. It must not block and any
+     * exception it throws is ignored.
+     */
+    using callback = std::function<
+        void(std::exception_ptr error, http_client::response res)>;
+
+    /**
+     * @brief Start the event loop on a thread of its own.
+     *
+     * @throw `std::runtime_error` - If the event loop cannot be created.
+     */
+    http_async_client();
+
+    /**
+     * @brief Create the event loop, and start its thread if requested.
+     *
+     * @throw `std::runtime_error` - If the event loop cannot be created.
+     */
+    explicit http_async_client(const options &opts);
+
+    /**
+     * @brief Stop the event loop. Requests that are still pending fail.
+     */
+    ~http_async_client();
+
+    http_async_client(const http_async_client &) = delete;
+
+    http_async_client &
+    operator=(const http_async_client &) = delete;
+
+    /**
+     * @brief Queue a request, from any thread. It never blocks, even when
+     * the host has to be resolved.
+     *
+     * @return `std::future` - The response. It holds a `std::runtime_error`
+     * if the host cannot be resolved, the connection fails, the request
+     * times out or the response is malformed.
+     */
+    std::future<http_client::response>
+    send(request req);
+
+    /**
+     * @brief Queue a request, from any thread, and hand its outcome over to
+     * a callback.
+     */
+    void
+    send(request req, callback done);
+
+    /**
+     * @brief Retrieve the file descriptor of the event loop, which is
+     * readable whenever `poll` has work to do.
+     */
+    int
+    fd() const noexcept;
+
+    /**
+     * @brief Run one iteration of the event loop, from the thread of the
+     * owner when the client has no thread of its own.
+     *
+     * @param timeout - The longest time to wait for an event, bounded by the
+     * closest deadline.
+     */
+    void
+    poll(std::chrono::milliseconds timeout = {});
+
+private:
+    struct __address
+    {
+        struct sockaddr_storage addr;
+        socklen_t addrlen;
+    };
+
+    using __addresses = std::shared_ptr<const std::vector<__address>>;
+
+    struct __request
+    {
+        std::string key;
+        std::string host;
+        std::string port;
+        std::string wire;
+        bool head;
+        bool idempotent;
+        bool retried;
+        std::chrono::steady_clock::time_point deadline;
+        callback done;
+    };
+
+    struct __pool;
+
+    struct __connection
+    {
+        int fd;
+        __pool *pool;
+        bool connecting;
+        bool writing;
+        bool persistent;
+        std::string out;
+        std::string in;
+        std::deque<__request> inflight;
+        std::chrono::steady_clock::time_point connect_deadline;
+        std::chrono::steady_clock::time_point idle_since;
+    };
+
+    struct __pool
+    {
+        std::string key;
+        std::string host;
+        std::string port;
+
+        /**
+         * @brief The addresses of the host, or `nullptr` until it is
+         * resolved, and while a lookup is pending.
+         */
+        __addresses addresses;
+        std::chrono::steady_clock::time_point expires;
+        bool resolving;
+
+        std::size_t next_address;
+        std::deque<__request> queue;
+        std::vector<std::unique_ptr<__connection>> connections;
+    };
+
+    /**
+     * @brief The outcome of a lookup, handed over by the resolver thread.
+     * Either `addresses` or `error` is set.
+     */
+    struct __resolution
+    {
+        std::string key;
+        __addresses addresses;
+        std::string error;
+    };
+
+    options __opts;
+    int __epoll;
+    int __wakeup;
+
+    std::unordered_map<std::string, std::unique_ptr<__pool>> __pools;
+    std::vector<std::unique_ptr<__connection>> __closed;
+
+    std::mutex __mutex;
+    std::vector<__request> __submitted;
+
+    std::mutex __resolver_mutex;
+    std::condition_variable __resolver_cv;
+
+    /**
+     * @brief The pools whose host is to be resolved. Pools live as long as
+     * the client, and their host and port never change.
+     */
+    std::deque<const __pool *> __lookups;
+    std::vector<__resolution> __resolved;
+    bool __resolver_stopping;
+    std::thread __resolver;
+
+    std::atomic<bool> __running;
+    std::thread __loop;
+
+    void
+    __resolve(__pool &pool);
+
+    void
+    __run_resolver();
+
+    static __addresses
+    __lookup(const std::string &host, const std::string &port);
+
+    void
+    __run();
+
+    void
+    __accept_submitted();
+
+    void
+    __accept_resolved();
+
+    void
+    __dispatch(__pool &pool);
+
+    __connection *
+    __open(__pool &pool);
+
+    void
+    __watch(__connection &conn) noexcept;
+
+    void
+    __on_event(__connection &conn, std::uint32_t events);
+
+    void
+    __flush(__connection &conn);
+
+    void
+    __receive(__connection &conn);
+
+    void
+    __abort(
+        __connection &conn, const std::string &message, bool retry = true
+    );
+
+    void
+    __expire(std::chrono::steady_clock::time_point now);
+
+    std::chrono::steady_clock::time_point
+    __next_deadline() const noexcept;
+
+    static void
+    __fail(__request &req, const std::string &message) noexcept;
+
+    static void
+    __deliver(
+        __request &req, std::exception_ptr error, http_client::response res
+    ) noexcept;
+};
+} // namespace hfs
+
+#endif // __HTTP_ASYNC_CLIENT_H__
@@ -0,0 +1,444 @@
+#include <http_access_log.h>
+#include <http_binary_log.h>
+
+namespace hfs
+{
+/**
+ * @brief Methods that take a single byte. Code 0 is followed by the method
+ * itself.
+ */
+static constexpr std::array<std::string_view, 9> __methods = {
+    "GET",     "HEAD",    "POST",  "PUT",   "DELETE",
+    "CONNECT", "OPTIONS", "TRACE", "PATCH",
+};
+
+enum : std::uint8_t
+{
+    __FAMILY_TEXT  = 0,
+    __FAMILY_INET  = 4,
+    __FAMILY_INET6 = 6,
+};
+
+static void
+__put_varint(std::uint64_t value, std::string &out)
+{
+    while (value >= 0x80)
+    {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+
+    out.push_back((char)value);
+}
+
+static void
+__put_string(std::string_view value, std::string &out)
+{
+    __put_varint(value.size(), out);
+    out.append(value);
+}
+
+static int
+__hex(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+
+    return -1;
+}
+
+/**
+ * @brief Parse the 36 characters of a UUID into its 16 bytes.
+ */
+static bool
+__parse_uuid(std::string_view text, unsigned char (&uuid)[16])
+{
+    if (text.size() != 36)
+        return false;
+
+    for (std::size_t i = 0, j = 0; i < 16; i++, j += 2)
+    {
+        if (j == 8 || j == 13 || j == 18 || j == 23)
+        {
+            if (text[j] != '-')
+                return false;
+            j++;
+        }
+
+        int high = __hex(text[j]), low = __hex(text[j + 1]);
+
+        if (high < 0 || low < 0)
+            return false;
+
+        uuid[i] = (unsigned char)(high << 4 | low);
+    }
+
+    return true;
+}
+
+static void
+__format_uuid(const unsigned char (&uuid)[16], char (&text)[40])
+{
+    static constexpr char digits[] = "0123456789abcdef";
+    std::size_t j = 0;
+
+    for (std::size_t i = 0; i < 16; i++)
+    {
+        if (i == 4 || i == 6 || i == 8 || i == 10)
+            text[j++] = '-';
+
+        text[j++] = digits[uuid[i] >> 4];
+        text[j++] = digits[uuid[i] & 0x0f];
+    }
+
+    text[j] = '\0';
+}
+
+http_binary_log::encoder::encoder() : __last_timestamp(0)
+{
+}
+
+void
+http_binary_log::encoder::reset(std::int64_t base, std::string &out)
+{
+    this->__paths.clear();
+    this->__last_timestamp = base;
+
+    out.append(MAGIC);
+    out.push_back((char)VERSION);
+    out.push_back('\0');
+
+    for (int shift = 0; shift < 64; shift += 8)
+        out.push_back((char)((std::uint64_t)base >> shift));
+}
+
+void
+http_binary_log::encoder::encode(
+    const http_access_record &record, bool timing, std::string &out
+)
+{
+    std::string_view path = record.path;
+    auto it               = this->__paths.find(path);
+
+    if (it == this->__paths.end())
+    {
+        // A crawler can make up paths forever, so the table is bounded
+        if (this->__paths.size() >= MAX_PATHS)
+        {
+            out.push_back((char)TAG_RESET);
+            this->__paths.clear();
+        }
+
+        out.push_back((char)TAG_PATH);
+        __put_string(path, out);
+
+        it = this->__paths.emplace(path, this->__paths.size()).first;
+    }
+
+    // Records are drained from several rings, so time may go backwards
+    std::int64_t delta     = record.timestamp - this->__last_timestamp;
+    this->__last_timestamp = record.timestamp;
+
+    out.push_back((char)TAG_RECORD);
+    __put_varint(
+        ((std::uint64_t)delta << 1) ^ (std::uint64_t)(delta >> 63), out
+    );
+    __put_varint(record.duration, out);
+    __put_varint(record.status, out);
+    __put_varint(record.bytes, out);
+    __put_varint(it->second, out);
+
+    std::string_view method = record.method;
+    auto known = std::find(__methods.begin(), __methods.end(), method);
+
+    if (known != __methods.end())
+    {
+        out.push_back((char)(known - __methods.begin() + 1));
+    }
+    else
+    {
+        out.push_back('\0');
+        __put_string(method, out);
+    }
+
+    unsigned char uuid[16] = {0};
+    __parse_uuid(record.request_id, uuid);
+    out.append((const char *)uuid, sizeof(uuid));
+
+    unsigned char addr[16];
+
+    if (inet_pton(AF_INET, record.client, addr) == 1)
+    {
+        out.push_back((char)__FAMILY_INET);
+        out.append((const char *)addr, 4);
+    }
+    else if (inet_pton(AF_INET6, record.client, addr) == 1)
+    {
+        out.push_back((char)__FAMILY_INET6);
+        out.append((const char *)addr, 16);
+    }
+    else
+    {
+        out.push_back((char)__FAMILY_TEXT);
+        __put_string(record.client, out);
+    }
+
+    std::size_t spans = timing ? std::size(record.timing) : 0;
+    out.push_back((char)spans);
+
+    for (std::size_t i = 0; i < spans; i++)
+    {
+        std::uint32_t span = record.timing[i];
+        __put_varint(
+            span == http_access_record::UNTIMED ? 0 : (std::uint64_t)span + 1,
+            out
+        );
+    }
+}
+
+http_binary_log::decoder::decoder(std::istream &in)
+    : __in(in), __base(0), __last_timestamp(0), __version(VERSION)
+{
+    this->__header();
+}
+
+void
+http_binary_log::decoder::__header()
+{
+    char header[HEADER_SIZE];
+
+    if (!this->__in.read(header, sizeof(header)) ||
+        std::string_view(header, MAGIC.size()) != MAGIC)
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__, "Not a binary access log"
+        ));
+    }
+
+    std::uint8_t version = header[MAGIC.size()];
+
+    if (version == 0 || version > VERSION)
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__,
+            "Unsupported binary access log version " +
+                std::to_string(version)
+        ));
+    }
+
+    this->__version = version;
+
+    std::uint64_t base = 0;
+
+    for (int i = 7; i >= 0; i--)
+        base = base << 8 | (unsigned char)header[MAGIC.size() + 2 + i];
+
+    this->__paths.clear();
+    this->__base = this->__last_timestamp = (std::int64_t)base;
+}
+
+std::int64_t
+http_binary_log::decoder::base() const noexcept
+{
+    return this->__base;
+}
+
+void
+http_binary_log::decoder::__bytes(char *buf, std::size_t size)
+{
+    if (!this->__in.read(buf, size))
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__, "Truncated binary access log"
+        ));
+    }
+}
+
+std::uint64_t
+http_binary_log::decoder::__varint()
+{
+    std::uint64_t value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        char c;
+        this->__bytes(&c, 1);
+
+        value |= (std::uint64_t)(c & 0x7f) << shift;
+
+        if ((c & 0x80) == 0)
+            return value;
+    }
+
+    throw std::runtime_error(hfs::format_function_error(
+        __FILE__, __LINE__, "Malformed varint in binary access log"
+    ));
+}
+
+/**
+ * @brief Copy a string into a fixed-size record field, truncating it if
+ * needed.
+ */
+template <std::size_t N>
+static void
+__copy(char (&field)[N], std::string_view value) noexcept
+{
+    std::size_t len = std::min(value.size(), N - 1);
+
+    std::memcpy(field, value.data(), len);
+    field[len] = '\0';
+}
+
+/**
+ * @brief Read a string. Every string of a record, the path included, fits in
+ * a field of `http_access_record`, so a longer length can only come from a
+ * corrupt log and is rejected before anything is allocated.
+ */
+std::string
+http_binary_log::decoder::__string()
+{
+    std::uint64_t length = this->__varint();
+
+    if (length >= hfs::HTTP_LOG_PATHSZ)
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__, "Malformed string in binary access log"
+        ));
+    }
+
+    std::string value(length, '\0');
+    this->__bytes(value.data(), value.size());
+
+    return value;
+}
+
+bool
+http_binary_log::decoder::next(http_access_record &record)
+{
+    for (;;)
+    {
+        int tag = this->__in.get();
+
+        if (tag == std::char_traits<char>::eof())
+            return false;
+
+        // Every time the server opens the file, it appends a new header
+        if (tag == MAGIC[0])
+        {
+            this->__in.unget();
+            this->__header();
+            continue;
+        }
+
+        if (tag == TAG_RESET)
+        {
+            this->__paths.clear();
+            continue;
+        }
+
+        if (tag == TAG_PATH)
+        {
+            this->__paths.push_back(this->__string());
+            continue;
+        }
+
+        if (tag != TAG_RECORD)
+        {
+            throw std::runtime_error(hfs::format_function_error(
+                __FILE__, __LINE__,
+                "Unknown entry " + std::to_string(tag) +
+                    " in binary access log"
+            ));
+        }
+
+        break;
+    }
+
+    std::uint64_t zigzag = this->__varint();
+    this->__last_timestamp +=
+        (std::int64_t)(zigzag >> 1) ^ -(std::int64_t)(zigzag & 1);
+
+    record.timestamp = this->__last_timestamp;
+    record.duration  = this->__varint();
+    record.status    = this->__varint();
+    record.bytes     = this->__varint();
+
+    std::uint64_t path = this->__varint();
+
+    if (path >= this->__paths.size())
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__, "Undefined path in binary access log"
+        ));
+    }
+
+    __copy(record.path, this->__paths[path]);
+
+    unsigned char method;
+    this->__bytes((char *)&method, 1);
+
+    if (method == 0)
+        __copy(record.method, this->__string());
+    else if (method <= __methods.size())
+        __copy(record.method, __methods[method - 1]);
+    else
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__, "Unknown method in binary access log"
+        ));
+    }
+
+    unsigned char uuid[16];
+    this->__bytes((char *)uuid, sizeof(uuid));
+    __format_uuid(uuid, record.request_id);
+
+    char family;
+    unsigned char addr[16];
+    this->__bytes(&family, 1);
+
+    switch (family)
+    {
+    case __FAMILY_INET:
+        this->__bytes((char *)addr, 4);
+        inet_ntop(AF_INET, addr, record.client, sizeof(record.client));
+        break;
+    case __FAMILY_INET6:
+        this->__bytes((char *)addr, 16);
+        inet_ntop(AF_INET6, addr, record.client, sizeof(record.client));
+        break;
+    case __FAMILY_TEXT:
+        __copy(record.client, this->__string());
+        break;
+    default:
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__, "Unknown address family in binary access log"
+        ));
+    }
+
+    std::fill(
+        std::begin(record.timing), std::end(record.timing),
+        http_access_record::UNTIMED
+    );
+
+    if (this->__version < 2)
+        return true;
+
+    // Spans unknown to this build are skipped
+    unsigned char spans;
+    this->__bytes((char *)&spans, 1);
+
+    for (std::size_t i = 0; i < spans; i++)
+    {
+        std::uint64_t value = this->__varint();
+
+        if (i < std::size(record.timing) && value > 0)
+            record.timing[i] = value - 1;
+    }
+
+    return true;
+}
+} // namespace hfs
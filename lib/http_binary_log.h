@@ -0,0 +1,137 @@
+#ifndef __HTTP_BINARY_LOG_H__
+#define __HTTP_BINARY_LOG_H__ 1
+
+#include <http_core.h>
+
+namespace hfs
+{
+struct http_access_record;
+
+/**
+ * @brief Compact binary encoding of access log records.
+ *
+ * A file starts with a 16-byte header: the magic `HFSLOG`, the format
+ * version, a reserved byte and the base timestamp as a little-endian 64-bit
+ * count of microseconds since the epoch. Then comes a sequence of entries,
+ * each introduced by a tag byte:
+ *
+ * - `PATH`: a path seen for the first time, as a varint length and the
+ *   bytes. Paths are numbered in order of appearance.
+ * - `RECORD`: the timestamp as a zigzag varint delta from the previous
+ *   record, the duration, status, byte count and path number as varints, the
+ *   method as a 1-byte code, the request ID as 16 raw bytes, the client
+ *   address as a family byte followed by 4 or 16 raw bytes, and the number
+ *   of phase spans followed by each duration plus one as a varint, 0 meaning
+ *   that the span has not been reached. Version 1 has no spans.
+ * - `RESET`: the path table is full and starts over.
+ *
+ * A file that is opened again is appended a new header, which resets the
+ * path table and the base timestamp.
+ *
+ * A typical record takes about 30 bytes instead of more than 100 as text,
+ * and costs no formatting at all.
+ */
+class http_binary_log
+{
+public:
+    static constexpr std::string_view MAGIC     = "HFSLOG";
+    static constexpr std::uint8_t VERSION       = 2;
+    static constexpr std::size_t HEADER_SIZE    = 16;
+    static constexpr std::size_t MAX_PATHS      = 65536;
+
+    static constexpr std::uint8_t TAG_PATH   = 0x01;
+    static constexpr std::uint8_t TAG_RECORD = 0x02;
+    static constexpr std::uint8_t TAG_RESET  = 0x03;
+
+    /**
+     * @brief Stateful writer of one file: it remembers the paths it has
+     * defined and the timestamp of the last record.
+     */
+    class encoder
+    {
+    public:
+        encoder();
+
+        /**
+         * @brief Start a new file.
+         *
+         * @param base - The base timestamp of the file, in microseconds.
+         * @param out - The buffer the file header is appended to.
+         */
+        void
+        reset(std::int64_t base, std::string &out);
+
+        /**
+         * @brief Append a record, preceded by the definition of its path if
+         * the path is new to the file.
+         *
+         * @param record - The record.
+         * @param timing - Whether to write the phase spans of the record.
+         * @param out - The buffer the entries are appended to.
+         */
+        void
+        encode(
+            const http_access_record &record, bool timing, std::string &out
+        );
+
+    private:
+        std::unordered_map<
+            std::string, std::uint32_t, hfs::string_hash, std::equal_to<>>
+            __paths;
+        std::int64_t __last_timestamp;
+    };
+
+    /**
+     * @brief Reader of one file.
+     */
+    class decoder
+    {
+    public:
+        /**
+         * @brief Read the header of the file.
+         *
+         * @throw `std::runtime_error` - If the stream is not a binary access
+         * log or uses a version newer than `VERSION`.
+         */
+        explicit decoder(std::istream &in);
+
+        /**
+         * @brief Read the next record.
+         *
+         * @return `false` at the end of the stream.
+         * @throw `std::runtime_error` - If the stream is corrupted or ends in
+         * the middle of an entry.
+         */
+        bool
+        next(http_access_record &record);
+
+        /**
+         * @brief Retrieve the base timestamp of the last header read, in
+         * microseconds.
+         */
+        std::int64_t
+        base() const noexcept;
+
+    private:
+        std::istream &__in;
+        std::vector<std::string> __paths;
+        std::int64_t __base;
+        std::int64_t __last_timestamp;
+        std::uint8_t __version;
+
+        void
+        __header();
+
+        std::uint64_t
+        __varint();
+
+        std::string
+        __string();
+
+        void
+        __bytes(char *buf, std::size_t size);
+    };
+};
+} // namespace hfs
+
+#endif // __HTTP_BINARY_LOG_H__
@@ -0,0 +1,375 @@
+#include <http_body_reader.h>
+
+namespace hfs
+{
+http_body_reader::http_body_reader(
+    int socket, std::string_view buffered,
+    std::optional<std::size_t> content_length, bool expect_continue
+)
+    : __socket(socket), __length(content_length), __consumed(0),
+      __remaining(content_length.value_or(0)), __status(HTTP_STATUS_OK),
+      __continue_pending(expect_continue), __buf(buffered), __pos(0),
+      __tee(nullptr), __tee_limit(0)
+{
+    if (!content_length.has_value())
+        this->__state = state::CHUNK_SIZE;
+    else if (*content_length > 0)
+        this->__state = state::CHUNK_DATA;
+    else
+        this->__state = state::DONE;
+}
+
+http_body_reader::~http_body_reader()
+{
+}
+
+bool
+http_body_reader::eof() const noexcept
+{
+    return this->__state == state::DONE;
+}
+
+bool
+http_body_reader::chunked() const noexcept
+{
+    return !this->__length.has_value();
+}
+
+std::optional<std::size_t>
+http_body_reader::length() const noexcept
+{
+    return this->__length;
+}
+
+std::size_t
+http_body_reader::consumed() const noexcept
+{
+    return this->__consumed;
+}
+
+http_status_code_t
+http_body_reader::status() const noexcept
+{
+    return this->__status;
+}
+
+void
+http_body_reader::tee(std::string &copy, std::size_t limit) noexcept
+{
+    this->__tee       = &copy;
+    this->__tee_limit = limit;
+}
+
+void
+http_body_reader::__fail(http_status_code_t status, const std::string &reason)
+{
+    this->__status = status;
+    this->__state  = state::DONE;
+
+    throw std::runtime_error(
+        hfs::format_function_error(__FILE__, __LINE__, reason)
+    );
+}
+
+std::size_t
+http_body_reader::__recv(char *buf, std::size_t size)
+{
+    static constexpr std::string_view interim = "HTTP/1.1 100 Continue\r\n\r\n";
+
+    ssize_t brecv;
+
+    if (this->__continue_pending)
+    {
+        this->__continue_pending = false;
+
+        if (::send(
+                this->__socket, interim.data(), interim.size(), MSG_NOSIGNAL
+            ) != (ssize_t)interim.size())
+        {
+            this->__fail(
+                HTTP_STATUS_BAD_REQUEST,
+                "send: " + std::string(std::strerror(errno))
+            );
+        }
+    }
+
+    do
+    {
+        brecv = recv(this->__socket, buf, size, 0);
+    } while (brecv == -1 && errno == EINTR);
+
+    if (brecv == -1)
+    {
+        this->__fail(
+            HTTP_STATUS_BAD_REQUEST,
+            "recv: " + std::string(std::strerror(errno))
+        );
+    }
+
+    if (brecv == 0)
+    {
+        this->__fail(
+            HTTP_STATUS_BAD_REQUEST,
+            "Connection closed before the end of the body"
+        );
+    }
+
+    return brecv;
+}
+
+/**
+ * @brief Replace the consumed part of the internal buffer with new bytes from
+ * the socket, keeping the bytes that have not been consumed yet.
+ */
+void
+http_body_reader::__fill()
+{
+    this->__buf.erase(0, this->__pos);
+    this->__pos = 0;
+
+    std::size_t offset = this->__buf.size();
+    this->__buf.resize(offset + hfs::HTTP_BUFSZ);
+
+    std::size_t brecv;
+
+    try
+    {
+        brecv = this->__recv(this->__buf.data() + offset, hfs::HTTP_BUFSZ);
+    }
+    catch (const std::runtime_error &e)
+    {
+        this->__buf.resize(offset);
+        throw;
+    }
+
+    this->__buf.resize(offset + brecv);
+}
+
+/**
+ * @brief Read a CRLF terminated line of the chunked framing. The returned
+ * view is valid until the next call.
+ */
+std::string_view
+http_body_reader::__read_line()
+{
+    std::size_t eol;
+
+    while ((eol = this->__buf.find("\r\n", this->__pos)) == std::string::npos)
+    {
+        if (this->__buf.size() - this->__pos >= hfs::HTTP_HDRSZ)
+        {
+            this->__fail(
+                HTTP_STATUS_BAD_REQUEST, "Chunk framing line is too long"
+            );
+        }
+
+        this->__fill();
+    }
+
+    std::string_view line(this->__buf.data() + this->__pos, eol - this->__pos);
+    this->__pos = eol + 2;
+
+    return line;
+}
+
+/**
+ * @brief Copy the data of the current chunk, or of the fixed length body.
+ * Once the internal buffer is drained, large reads go straight from the
+ * socket to the caller's buffer.
+ */
+std::size_t
+http_body_reader::__read_data(char *buf, std::size_t size)
+{
+    std::size_t want      = std::min(size, this->__remaining);
+    std::size_t available = this->__buf.size() - this->__pos;
+    std::size_t n;
+
+    if (available > 0)
+    {
+        n = std::min(want, available);
+        std::memcpy(buf, this->__buf.data() + this->__pos, n);
+        this->__pos += n;
+    }
+    else
+    {
+        n = this->__recv(buf, want);
+    }
+
+    this->__remaining -= n;
+    this->__consumed += n;
+
+    if (this->__tee != nullptr && this->__tee->size() < this->__tee_limit)
+    {
+        this->__tee->append(
+            buf, std::min(n, this->__tee_limit - this->__tee->size())
+        );
+    }
+
+    if (this->__remaining == 0)
+    {
+        this->__state =
+            this->chunked() ? state::CHUNK_DATA_END : state::DONE;
+    }
+
+    return n;
+}
+
+/**
+ * @brief Parse a `chunk-size [ chunk-ext ]` line. Extensions are ignored.
+ */
+static bool
+__parse_chunk_size(std::string_view line, std::size_t &size)
+{
+    std::size_t i = 0;
+
+    size = 0;
+    for (; i < line.size(); i++)
+    {
+        char c = line[i];
+        int digit;
+
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+        else
+            break;
+
+        if (size > (SIZE_MAX >> 4))
+            return false;
+
+        size = (size << 4) | digit;
+    }
+
+    if (i == 0)
+        return false;
+
+    std::string_view rest = hfs::trim(line.substr(i));
+
+    return rest.empty() || rest.front() == ';';
+}
+
+std::size_t
+http_body_reader::read(char *buf, std::size_t size)
+{
+    if (size == 0)
+        return 0;
+
+    for (;;)
+    {
+        switch (this->__state)
+        {
+        case state::CHUNK_SIZE:
+        {
+            std::string_view line = this->__read_line();
+            std::size_t chunk_size;
+
+            if (!__parse_chunk_size(line, chunk_size))
+            {
+                this->__fail(
+                    HTTP_STATUS_BAD_REQUEST,
+                    "Invalid chunk size: " + std::string(line)
+                );
+            }
+
+            this->__remaining = chunk_size;
+            this->__state =
+                chunk_size == 0 ? state::TRAILERS : state::CHUNK_DATA;
+            break;
+        }
+        case state::CHUNK_DATA:
+            return this->__read_data(buf, size);
+        case state::CHUNK_DATA_END:
+            if (!this->__read_line().empty())
+            {
+                this->__fail(
+                    HTTP_STATUS_BAD_REQUEST,
+                    "Chunk data is not followed by CRLF"
+                );
+            }
+
+            this->__state = state::CHUNK_SIZE;
+            break;
+        case state::TRAILERS:
+            // Trailer fields are not merged into the header section, since
+            // nothing in the server relies on them.
+            if (this->__read_line().empty())
+                this->__state = state::DONE;
+            break;
+        case state::DONE:
+            if (this->__status != HTTP_STATUS_OK)
+            {
+                throw std::runtime_error(hfs::format_function_error(
+                    __FILE__, __LINE__, "Body reader has failed already"
+                ));
+            }
+
+            return 0;
+        }
+    }
+}
+
+std::string
+http_body_reader::read_all(std::size_t limit)
+{
+    std::string body;
+
+    if (this->__length.has_value())
+    {
+        if (*this->__length - this->__consumed > limit)
+        {
+            this->__fail(
+                HTTP_STATUS_REQUEST_TOO_LARGE,
+                "Request body exceeds the size limit (" +
+                    std::to_string(limit) + ")"
+            );
+        }
+
+        body.reserve(*this->__length - this->__consumed);
+    }
+
+    std::size_t n;
+    char buf[hfs::HTTP_BUFSZ];
+
+    while ((n = this->read(buf, sizeof(buf))) > 0)
+    {
+        if (body.size() + n > limit)
+        {
+            this->__fail(
+                HTTP_STATUS_REQUEST_TOO_LARGE,
+                "Request body exceeds the size limit (" +
+                    std::to_string(limit) + ")"
+            );
+        }
+
+        body.append(buf, n);
+    }
+
+    return body;
+}
+
+bool
+http_body_reader::discard(std::size_t limit) noexcept
+{
+    char buf[hfs::HTTP_BUFSZ];
+    std::size_t total = 0, n;
+
+    // The client has not sent anything past the header section
+    if (this->__continue_pending && this->__pos == this->__buf.size())
+        return false;
+
+    try
+    {
+        while (total < limit && (n = this->read(buf, sizeof(buf))) > 0)
+            total += n;
+    }
+    catch (const std::runtime_error &e)
+    {
+        return false;
+    }
+
+    return this->eof();
+}
+} // namespace hfs
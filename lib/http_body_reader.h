@@ -0,0 +1,182 @@
+#ifndef __HTTP_BODY_READER_H__
+#define __HTTP_BODY_READER_H__ 1
+
+#include <http_core.h>
+
+namespace hfs
+{
+/**
+ * @brief Incremental reader of a request body, as framed by RFC 9112
+ * Section 6: either a fixed `Content-Length` or the `chunked` transfer coding.
+ *
+ * The reader hands out the decoded body in pieces of the size asked by the
+ * caller, so that an upload of any size is processed with bounded memory.
+ * Bytes that have been received along with the header section are consumed
+ * first, then the reader pulls from the socket only when it needs to.
+ *
+ * For example:
+ *
+ * @code
+ * ```cpp
+ * server->register_handler(
+ *     "/upload", "PUT",
+ *     [](const hfs::http_request &req, hfs::http_response &res)
+ *     {
+ *         char buf[hfs::HTTP_BUFSZ];
+ *         std::size_t n;
+ *
+ *         while ((n = req.body_reader().read(buf, sizeof(buf))) > 0)
+ *             file.write(buf, n);
+ *     }
+ * );
+ * ```
+ * @endcode
+ */
+class http_body_reader
+{
+public:
+    /**
+     * @brief Construct a new body reader.
+     *
+     * @param socket - The socket of the client.
+     * @param buffered - Bytes following the header section that have been
+     * received already.
+     * @param content_length - The length of the body, or `std::nullopt` if the
+     * body uses the `chunked` transfer coding.
+     * @param expect_continue - Whether the client waits for a `100 (Continue)`
+     * interim response before sending the body. It is sent by the first read
+     * that needs the socket, so a request rejected without looking at its
+     * body never makes the client send it.
+     */
+    http_body_reader(
+        int socket, std::string_view buffered,
+        std::optional<std::size_t> content_length, bool expect_continue = false
+    );
+
+    ~http_body_reader();
+
+    http_body_reader(const http_body_reader &) = delete;
+
+    http_body_reader &
+    operator=(const http_body_reader &) = delete;
+
+    /**
+     * @brief Read the next bytes of the decoded body.
+     *
+     * @param buf - The destination buffer.
+     * @param size - The capacity of `buf`.
+     * @return `std::size_t` - The number of bytes written to `buf`, 0 once
+     * the whole body has been read.
+     * @throw `std::runtime_error` - If the body is malformed, the client
+     * closes the connection too early or the socket fails. `status()` tells
+     * the status to answer with.
+     */
+    std::size_t
+    read(char *buf, std::size_t size);
+
+    /**
+     * @brief Read the rest of the body in memory.
+     *
+     * @param limit - The maximum length of the body.
+     * @return `std::string` - The remaining decoded bytes.
+     * @throw `std::runtime_error` - On the same conditions as `read`, or if
+     * the body is longer than `limit`.
+     */
+    std::string
+    read_all(std::size_t limit = hfs::HTTP_MAX_BODYSZ);
+
+    /**
+     * @brief Read and drop the rest of the body, so that the client is not
+     * reset while it is still sending it.
+     *
+     * @param limit - The maximum number of bytes to drop.
+     * @return `true` if the end of the body has been reached.
+     */
+    bool
+    discard(std::size_t limit = hfs::HTTP_MAX_BODYSZ) noexcept;
+
+    /**
+     * @brief Check whether the whole body has been read.
+     */
+    bool
+    eof() const noexcept;
+
+    /**
+     * @brief Check whether the body uses the `chunked` transfer coding.
+     */
+    bool
+    chunked() const noexcept;
+
+    /**
+     * @brief Retrieve the declared length of the body, if it is known
+     * in advance.
+     */
+    std::optional<std::size_t>
+    length() const noexcept;
+
+    /**
+     * @brief Retrieve the number of decoded bytes read so far.
+     */
+    std::size_t
+    consumed() const noexcept;
+
+    /**
+     * @brief Retrieve the status to answer with after a failed read, or
+     * `200 (HTTP_STATUS_OK)` if no read has failed.
+     */
+    http_status_code_t
+    status() const noexcept;
+
+    /**
+     * @brief Append a copy of the decoded bytes to `copy` as they are read,
+     * whoever reads them, up to `limit` bytes. The server uses it to capture
+     * request bodies without taking them away from the handler.
+     *
+     * @param copy - The buffer, which must outlive the reader.
+     * @param limit - The maximum size of the copy.
+     */
+    void
+    tee(std::string &copy, std::size_t limit) noexcept;
+
+private:
+    enum class state
+    {
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_DATA_END,
+        TRAILERS,
+        DONE,
+    };
+
+    int __socket;
+    std::optional<std::size_t> __length;
+    std::size_t __consumed;
+    std::size_t __remaining;
+    state __state;
+    http_status_code_t __status;
+    bool __continue_pending;
+
+    std::string __buf;
+    std::size_t __pos;
+
+    std::string *__tee;
+    std::size_t __tee_limit;
+
+    std::size_t
+    __read_data(char *buf, std::size_t size);
+
+    std::size_t
+    __recv(char *buf, std::size_t size);
+
+    void
+    __fill();
+
+    std::string_view
+    __read_line();
+
+    [[noreturn]] void
+    __fail(http_status_code_t status, const std::string &reason);
+};
+} // namespace hfs
+
+#endif // __HTTP_BODY_READER_H__
@@ -0,0 +1,308 @@
+#include <http_cache.h>
+
+/**
+ * @brief Check whether a response status may be cached without explicit
+ * freshness, as listed in RFC 9110 Section 15.1.
+ */
+static bool
+__cacheable(hfs::http_status_code_t status)
+{
+    switch (status)
+    {
+    case hfs::HTTP_STATUS_OK:
+    case hfs::HTTP_STATUS_NO_CONTENT:
+    case hfs::HTTP_STATUS_MOVED_PERMANENTLY:
+    case hfs::HTTP_STATUS_NOT_FOUND:
+    case hfs::HTTP_STATUS_METHOD_NOT_ALLOWED:
+    case hfs::HTTP_STATUS_URI_TOO_LONG:
+    case hfs::HTTP_STATUS_NOT_IMPLEMENTED:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Check whether a `Cache-Control` value holds a directive, with or
+ * without an argument.
+ */
+static bool
+__has_directive(std::string_view value, std::string_view directive)
+{
+    while (!value.empty())
+    {
+        std::size_t comma     = value.find(',');
+        std::string_view item = value.substr(0, comma);
+
+        value.remove_prefix(comma == std::string_view::npos ? value.size()
+                                                            : comma + 1);
+
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+            item.remove_prefix(1);
+
+        item = item.substr(0, item.find('='));
+
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+            item.remove_suffix(1);
+
+        if (hfs::iequals(item, directive))
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Check whether a response header field is set by the server for each
+ * request, rather than by the handler.
+ */
+static bool
+__per_request(std::string_view name)
+{
+    static const std::string_view fields[] = {
+        "Date",          "Server", "Connection",     "X-Request-ID",
+        "Server-Timing", "Age",    "Content-Length",
+    };
+
+    return std::any_of(
+        std::begin(fields), std::end(fields),
+        [name](std::string_view field) { return hfs::iequals(name, field); }
+    );
+}
+
+static const std::string *
+__find_header(const hfs::http_request &req, std::string_view name)
+{
+    for (const auto &[key, value] : req.headers())
+    {
+        if (hfs::iequals(key, name))
+            return &value;
+    }
+
+    return nullptr;
+}
+
+namespace hfs
+{
+http_cache::http_cache(const options &opts)
+    : __opts(opts), __entries(), __pending(), __lru(), __bytes(0), __hits(0),
+      __misses(0)
+{
+}
+
+void
+http_cache::operator()(
+    const hfs::http_request &req, hfs::http_response &res,
+    const hfs::http_router::route_handler_t &handler
+)
+{
+    // A response to credentials must not be shared with other clients
+    if ((req.method() != "GET" && req.method() != "HEAD") ||
+        __find_header(req, "Authorization") != nullptr)
+    {
+        handler(req, res);
+        return;
+    }
+
+    std::string key = this->__key(req);
+    std::promise<__entry_ptr> promise;
+    std::shared_future<__entry_ptr> pending;
+    __entry_ptr entry;
+
+    {
+        std::lock_guard<std::mutex> lock(this->__mutex);
+        auto it = this->__entries.find(key);
+
+        if (it != this->__entries.end())
+        {
+            if (std::chrono::steady_clock::now() - it->second.entry->stored <
+                this->__opts.ttl)
+            {
+                this->__lru.splice(
+                    this->__lru.begin(), this->__lru, it->second.lru
+                );
+                entry = it->second.entry;
+            }
+            else
+                this->__erase(it);
+        }
+
+        if (entry == nullptr)
+        {
+            auto flight = this->__pending.find(key);
+
+            if (flight != this->__pending.end())
+                pending = flight->second;
+            else
+                this->__pending.emplace(key, promise.get_future().share());
+        }
+    }
+
+    // Another request is rendering the same response, which is waited for
+    // instead of rendering it again.
+    if (pending.valid())
+        entry = pending.get();
+
+    if (entry != nullptr)
+    {
+        this->__hits++;
+        __apply(*entry, res);
+        return;
+    }
+
+    this->__misses++;
+
+    // The response of the other request could not be stored
+    if (pending.valid())
+    {
+        handler(req, res);
+        return;
+    }
+
+    try
+    {
+        handler(req, res);
+    }
+    catch (...)
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->__mutex);
+            this->__pending.erase(key);
+        }
+
+        promise.set_value(nullptr);
+        throw;
+    }
+
+    entry = this->__store(res);
+
+    {
+        std::lock_guard<std::mutex> lock(this->__mutex);
+        this->__pending.erase(key);
+
+        if (entry != nullptr)
+            this->__insert(key, entry);
+    }
+
+    promise.set_value(entry);
+}
+
+std::size_t
+http_cache::hits() const noexcept
+{
+    return this->__hits.load();
+}
+
+std::size_t
+http_cache::misses() const noexcept
+{
+    return this->__misses.load();
+}
+
+std::string
+http_cache::__key(const hfs::http_request &req) const
+{
+    std::string key(req.method());
+    key += ' ';
+    key += req.target();
+
+    // A missing header and an empty one are told apart
+    for (const std::string &name : this->__opts.vary)
+    {
+        const std::string *value = __find_header(req, name);
+
+        key += value != nullptr ? '\n' : '\0';
+
+        if (value != nullptr)
+            key += *value;
+    }
+
+    return key;
+}
+
+http_cache::__entry_ptr
+http_cache::__store(const hfs::http_response &res) const
+{
+    if (res.streaming() || res.has_file_segments() ||
+        !res.cookies().empty() || !__cacheable(res.status()))
+        return nullptr;
+
+    auto entry      = std::make_shared<__entry>();
+    entry->status   = res.status();
+    entry->has_body = false;
+    entry->size     = 0;
+
+    for (const auto &[name, value] : res.headers())
+    {
+        if (hfs::iequals(name, "Set-Cookie"))
+            return nullptr;
+
+        if (hfs::iequals(name, "Cache-Control") &&
+            (__has_directive(value, "no-store") ||
+             __has_directive(value, "private")))
+            return nullptr;
+
+        // The body sets the length again when the entry is applied
+        if (hfs::iequals(name, "Content-Length"))
+            entry->has_body = true;
+
+        if (__per_request(name))
+            continue;
+
+        entry->size += name.size() + value.size();
+        entry->headers.emplace_back(name, value);
+    }
+
+    entry->body = res.body();
+    entry->size += entry->body.size();
+    entry->stored = std::chrono::steady_clock::now();
+
+    if (entry->size > this->__opts.max_bytes)
+        return nullptr;
+
+    return entry;
+}
+
+void
+http_cache::__insert(const std::string &key, __entry_ptr entry)
+{
+    auto it = this->__entries.find(key);
+
+    if (it != this->__entries.end())
+        this->__erase(it);
+
+    while (!this->__lru.empty() &&
+           this->__bytes + key.size() + entry->size > this->__opts.max_bytes)
+        this->__erase(this->__entries.find(this->__lru.back()));
+
+    this->__lru.push_front(key);
+    this->__bytes += key.size() + entry->size;
+    this->__entries.emplace(key, __slot{std::move(entry), this->__lru.begin()});
+}
+
+void
+http_cache::__erase(std::unordered_map<std::string, __slot>::iterator it)
+{
+    this->__bytes -= it->first.size() + it->second.entry->size;
+    this->__lru.erase(it->second.lru);
+    this->__entries.erase(it);
+}
+
+void
+http_cache::__apply(const __entry &entry, hfs::http_response &res)
+{
+    auto age = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now() - entry.stored
+    );
+
+    res.status(entry.status);
+
+    if (entry.has_body)
+        res.body(entry.body);
+
+    for (const auto &[name, value] : entry.headers)
+        res.header(name, value);
+
+    res.header("Age", std::to_string(age.count()));
+}
+} // namespace hfs
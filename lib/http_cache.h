@@ -0,0 +1,148 @@
+#ifndef __HTTP_CACHE_H__
+#define __HTTP_CACHE_H__ 1
+
+#include <http_core.h>
+#include <http_request.h>
+#include <http_response.h>
+#include <http_router.h>
+
+namespace hfs
+{
+/**
+ * @brief Shared micro-cache of the responses of a route, for pages that
+ * render the same content on every hit.
+ *
+ * A response is stored for `ttl` under the method, the target and the values
+ * of the `vary` request headers. Requests that hit it get a copy of its
+ * status, headers and body without running the handler. Concurrent misses
+ * for the same key are coalesced: the first one runs the handler while the
+ * others wait for its response, so that a burst of requests on a cold or
+ * expired entry costs a single render.
+ *
+ * Only `GET` and `HEAD` requests without `Authorization` are looked up, and
+ * only complete responses are stored: no streamed body, no file, no
+ * `Set-Cookie`, no `Cache-Control: no-store` or `private`, and a status that
+ * is cacheable by default as defined in RFC 9110 Section 15.1.
+ *
+ * For example:
+ *
+ * @code
+ * ```cpp
+ * server->register_cached_handler(
+ *     "/", "GET",
+ *     [](const hfs::http_request &req, hfs::http_response &res)
+ *     { res.render("index"); },
+ *     {.ttl = std::chrono::seconds(1)}
+ * );
+ * ```
+ * @endcode
+ */
+class http_cache
+{
+public:
+    struct options
+    {
+        /**
+         * @brief The time a response is served from the cache.
+         */
+        std::chrono::milliseconds ttl{1000};
+
+        /**
+         * @brief The size of the stored responses beyond which the least
+         * recently used ones are evicted.
+         */
+        std::size_t max_bytes = 16 * 1024 * 1024;
+
+        /**
+         * @brief Request header fields whose values select distinct
+         * responses, compared without regard to case, e.g. `Accept-Language`.
+         */
+        std::vector<std::string> vary = {};
+    };
+
+    explicit http_cache(const options &opts);
+
+    http_cache(const http_cache &) = delete;
+
+    http_cache &
+    operator=(const http_cache &) = delete;
+
+    /**
+     * @brief Answer a request from the cache, or with the handler and store
+     * its response.
+     *
+     * @param handler - The handler of the route.
+     * @throw Whatever the handler throws. Coalesced requests then run the
+     * handler themselves.
+     */
+    void
+    operator()(
+        const hfs::http_request &req, hfs::http_response &res,
+        const hfs::http_router::route_handler_t &handler
+    );
+
+    /**
+     * @brief Retrieve the number of requests answered from the cache,
+     * coalesced ones included.
+     */
+    std::size_t
+    hits() const noexcept;
+
+    /**
+     * @brief Retrieve the number of requests that ran the handler.
+     */
+    std::size_t
+    misses() const noexcept;
+
+private:
+    struct __entry
+    {
+        hfs::http_status_code_t status;
+        std::vector<std::pair<std::string, std::string>> headers;
+        std::string body;
+        bool has_body;
+        std::size_t size;
+        std::chrono::steady_clock::time_point stored;
+    };
+
+    using __entry_ptr = std::shared_ptr<const __entry>;
+
+    struct __slot
+    {
+        __entry_ptr entry;
+        std::list<std::string>::iterator lru;
+    };
+
+    options __opts;
+
+    std::mutex __mutex;
+    std::unordered_map<std::string, __slot> __entries;
+    std::unordered_map<std::string, std::shared_future<__entry_ptr>> __pending;
+
+    /**
+     * @brief The keys of the entries, the most recently used first.
+     */
+    std::list<std::string> __lru;
+    std::size_t __bytes;
+
+    std::atomic<std::size_t> __hits;
+    std::atomic<std::size_t> __misses;
+
+    std::string
+    __key(const hfs::http_request &req) const;
+
+    __entry_ptr
+    __store(const hfs::http_response &res) const;
+
+    void
+    __insert(const std::string &key, __entry_ptr entry);
+
+    void
+    __erase(std::unordered_map<std::string, __slot>::iterator it);
+
+    static void
+    __apply(const __entry &entry, hfs::http_response &res);
+};
+} // namespace hfs
+
+#endif // __HTTP_CACHE_H__
@@ -0,0 +1,200 @@
+#include <http_capture.h>
+
+namespace hfs
+{
+http_capture::http_capture() : http_capture(options())
+{
+}
+
+http_capture::http_capture(const options &opts)
+    : __opts(opts), __fd(-1), __start(std::chrono::steady_clock::now()),
+      __running(true), __captured(0), __dropped(0)
+{
+    this->__fd = open(
+        this->__opts.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+        0644
+    );
+
+    if (this->__fd == -1)
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__,
+            "Failed to open " + this->__opts.path.string() + ": " +
+                std::strerror(errno)
+        ));
+    }
+
+    this->__writer = std::thread(&http_capture::__run, this);
+}
+
+http_capture::~http_capture()
+{
+    this->__running.store(false, std::memory_order_release);
+
+    if (this->__writer.joinable())
+        this->__writer.join();
+
+    if (this->__fd != -1)
+        close(this->__fd);
+}
+
+bool
+http_capture::sample() noexcept
+{
+    thread_local std::minstd_rand engine(std::random_device{}());
+
+    if (this->__opts.max_requests > 0 &&
+        this->__captured.load(std::memory_order_relaxed) >=
+            this->__opts.max_requests)
+    {
+        return false;
+    }
+
+    return std::generate_canonical<double, 32>(engine) < this->__opts.sample;
+}
+
+void
+http_capture::capture(
+    const hfs::http_request &req, std::string_view route,
+    std::string_view body, std::chrono::steady_clock::time_point received
+) noexcept
+{
+    // The body is stored decoded, so its framing does not apply anymore
+    static constexpr std::array<std::string_view, 2> framing = {
+        "Content-Length",
+        "Transfer-Encoding",
+    };
+
+    std::string line;
+
+    try
+    {
+        nlohmann::ordered_json headers = nlohmann::ordered_json::object();
+
+        for (const auto &[name, value] : req.headers())
+        {
+            auto excluded = [&name](std::string_view other)
+            { return hfs::iequals(name, other); };
+
+            if (std::none_of(framing.begin(), framing.end(), excluded) &&
+                std::none_of(
+                    this->__opts.excluded_headers.begin(),
+                    this->__opts.excluded_headers.end(), excluded
+                ))
+            {
+                headers[name] = value;
+            }
+        }
+
+        std::chrono::duration<double> timestamp = received - this->__start;
+
+        nlohmann::ordered_json entry = {
+            {"timestamp", timestamp.count()                                   },
+            {"type",      std::string(req.method()) + " " + std::string(route)},
+            {"method",    req.method()                                        },
+            {"path",      req.target()                                        },
+            {"headers",   headers                                             },
+        };
+
+        if (!body.empty() &&
+            std::find(
+                this->__opts.excluded_routes.begin(),
+                this->__opts.excluded_routes.end(), route
+            ) == this->__opts.excluded_routes.end())
+        {
+            entry["body"] = body;
+        }
+
+        // Bytes that are not valid UTF-8 cannot be held by a JSON string, so
+        // binary bodies are not replayed exactly.
+        line = entry.dump(
+            -1, ' ', false, nlohmann::ordered_json::error_handler_t::replace
+        );
+        line += '\n';
+    }
+    catch (const std::exception &e)
+    {
+        this->drop();
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(this->__mutex);
+
+    if (this->__pending.size() + line.size() > MAX_PENDING)
+    {
+        this->drop();
+        return;
+    }
+
+    this->__pending += line;
+    this->__captured.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::size_t
+http_capture::max_body() const noexcept
+{
+    return this->__opts.max_body;
+}
+
+std::size_t
+http_capture::captured() const noexcept
+{
+    return this->__captured.load(std::memory_order_relaxed);
+}
+
+std::size_t
+http_capture::dropped() const noexcept
+{
+    return this->__dropped.load(std::memory_order_relaxed);
+}
+
+void
+http_capture::drop() noexcept
+{
+    this->__dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+http_capture::__run()
+{
+    std::string batch;
+
+    while (this->__running.load(std::memory_order_acquire))
+    {
+        std::this_thread::sleep_for(this->__opts.flush_interval);
+
+        {
+            std::lock_guard<std::mutex> lock(this->__mutex);
+            batch.swap(this->__pending);
+        }
+
+        this->__write(batch);
+        batch.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(this->__mutex);
+    this->__write(this->__pending);
+}
+
+void
+http_capture::__write(const std::string &batch)
+{
+    for (std::size_t written = 0; written < batch.size();)
+    {
+        ssize_t ret =
+            ::write(this->__fd, batch.data() + written, batch.size() - written);
+
+        if (ret == -1 && errno == EINTR)
+            continue;
+
+        if (ret == -1)
+        {
+            std::cerr << "capture: write: " << std::strerror(errno)
+                      << std::endl;
+            return;
+        }
+
+        written += ret;
+    }
+}
+} // namespace hfs
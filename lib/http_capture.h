@@ -0,0 +1,198 @@
+#ifndef __HTTP_CAPTURE_H__
+#define __HTTP_CAPTURE_H__ 1
+
+#include <http_core.h>
+#include <http_request.h>
+
+namespace hfs
+{
+/**
+ * @brief Samples live requests into a JSON lines file that `hfs-load -r`
+ * replays, so that a server can be benchmarked offline with the shape of its
+ * production traffic.
+ *
+ * Each line describes one request:
+ *
+ * ```json
+ * {"timestamp":12.034512,"type":"POST /blog/:slug","method":"POST",
+ *  "path":"/blog/hello?draft=1","headers":{"Content-Type":"text/plain"},
+ *  "body":"..."}
+ * ```
+ *
+ * - `timestamp` - Seconds since the capture started, which set the pace of
+ * the replay.
+ * - `method`, `path` - The request method and target.
+ * - `headers` - Optional header fields. Credentials and the framing of the
+ * body (`Content-Length`, `Transfer-Encoding`) are not captured.
+ * - `body` - Optional decoded body. The bodies of the excluded routes are
+ * not captured.
+ * - `type` - Optional label under which the replay reports latencies, here
+ * the method and the route pattern. Without it, the replay groups requests
+ * by method and path.
+ *
+ * Only sampled requests cost anything more than a random draw: they are
+ * formatted on the request thread and handed over to a background thread
+ * that writes them.
+ *
+ * For example:
+ *
+ * @code
+ * ```cpp
+ * server->enable_capture({
+ *     .path            = "traffic.jsonl",
+ *     .sample          = 0.05,
+ *     .excluded_routes = {"/login"},
+ * });
+ * ```
+ * @endcode
+ */
+class http_capture
+{
+public:
+    struct options
+    {
+        /**
+         * @brief The capture file, truncated when the capture starts.
+         */
+        std::filesystem::path path = "traffic.jsonl";
+
+        /**
+         * @brief The fraction of the requests that are captured, from 0 to 1.
+         */
+        double sample = 0.01;
+
+        /**
+         * @brief The number of requests after which the capture stops, or 0
+         * to never stop it.
+         */
+        std::size_t max_requests = 100000;
+
+        /**
+         * @brief Requests whose body is longer than this are not captured.
+         */
+        std::size_t max_body = 64 * 1024;
+
+        /**
+         * @brief Header fields that are left out, compared without regard
+         * to case.
+         */
+        std::vector<std::string> excluded_headers = {
+            "Authorization",
+            "Proxy-Authorization",
+            "Cookie",
+        };
+
+        /**
+         * @brief Route patterns whose bodies are left out, e.g. `/login`
+         * for a form that carries a password. Their requests are still
+         * captured, and are replayed without a body.
+         */
+        std::vector<std::string> excluded_routes = {};
+
+        /**
+         * @brief The longest time a captured request waits in memory before
+         * it is written.
+         */
+        std::chrono::milliseconds flush_interval{200};
+    };
+
+    /**
+     * @brief Open `traffic.jsonl` in the working directory and start the
+     * writer thread.
+     *
+     * @throw `std::runtime_error` - If the file cannot be opened.
+     */
+    http_capture();
+
+    /**
+     * @brief Open the capture file and start the writer thread.
+     *
+     * @throw `std::runtime_error` - If the file cannot be opened.
+     */
+    explicit http_capture(const options &opts);
+
+    /**
+     * @brief Stop the writer thread once every pending request is written.
+     */
+    ~http_capture();
+
+    http_capture(const http_capture &) = delete;
+
+    http_capture &
+    operator=(const http_capture &) = delete;
+
+    /**
+     * @brief Draw whether the request that is starting on the calling thread
+     * is captured.
+     */
+    bool
+    sample() noexcept;
+
+    /**
+     * @brief Queue a sampled request.
+     *
+     * @param req - The request.
+     * @param route - The pattern of the route that handled the request.
+     * @param body - The decoded body, as received.
+     * @param received - The time the request was accepted.
+     */
+    void
+    capture(
+        const hfs::http_request &req, std::string_view route,
+        std::string_view body, std::chrono::steady_clock::time_point received
+    ) noexcept;
+
+    /**
+     * @brief Retrieve the maximum length of a captured body.
+     */
+    std::size_t
+    max_body() const noexcept;
+
+    /**
+     * @brief Retrieve the number of requests captured so far.
+     */
+    std::size_t
+    captured() const noexcept;
+
+    /**
+     * @brief Retrieve the number of sampled requests that have not been
+     * captured, because their body was too long or incomplete, or because
+     * the writer could not keep up.
+     */
+    std::size_t
+    dropped() const noexcept;
+
+    /**
+     * @brief Count a sampled request that cannot be captured.
+     */
+    void
+    drop() noexcept;
+
+    /**
+     * @brief The amount of formatted requests that may wait for the writer,
+     * past which requests are dropped.
+     */
+    static constexpr std::size_t MAX_PENDING = 4 * 1024 * 1024;
+
+private:
+    options __opts;
+    int __fd;
+    std::chrono::steady_clock::time_point __start;
+
+    std::mutex __mutex;
+    std::string __pending;
+
+    std::atomic<bool> __running;
+    std::atomic<std::size_t> __captured;
+    std::atomic<std::size_t> __dropped;
+    std::thread __writer;
+
+    void
+    __run();
+
+    void
+    __write(const std::string &batch);
+};
+} // namespace hfs
+
+#endif // __HTTP_CAPTURE_H__
@@ -0,0 +1,670 @@
+#include <http_client.h>
+
+namespace hfs
+{
+/**
+ * @brief The largest header section accepted in a response.
+ */
+static constexpr std::size_t __MAX_HEAD = 64 * 1024;
+
+http_client::http_client(const std::string &host, const std::string &port)
+    : __host(host), __port(port), __addrlen(0), __socket(-1), __timeout(0),
+      __keep_alive(false), __until_close(false)
+{
+    struct addrinfo hints, *info;
+
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    int ret = getaddrinfo(host.c_str(), port.c_str(), &hints, &info);
+
+    if (ret != 0)
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__,
+            "Failed to resolve " + host + ":" + port + ": " +
+                gai_strerror(ret)
+        ));
+    }
+
+    std::memcpy(&this->__addr, info->ai_addr, info->ai_addrlen);
+    this->__addrlen = info->ai_addrlen;
+
+    freeaddrinfo(info);
+}
+
+http_client::~http_client()
+{
+    this->close();
+}
+
+void
+http_client::connect()
+{
+    this->close();
+
+    this->__socket = socket(
+        this->__addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP
+    );
+
+    if (this->__socket == -1)
+        this->__fail("socket: " + std::string(std::strerror(errno)));
+
+    // On Linux, the send timeout bounds `connect` as well
+    this->timeout(this->__timeout);
+
+    if (::connect(
+            this->__socket, (struct sockaddr *)&this->__addr, this->__addrlen
+        ) == -1)
+    {
+        this->__fail(
+            errno == EINPROGRESS
+                ? "Timed out connecting to " + this->__host + ":" +
+                      this->__port
+                : "Failed to connect to " + this->__host + ":" +
+                      this->__port + ": " + std::strerror(errno)
+        );
+    }
+
+    // Requests are small and latency matters more than packet count
+    int flag = 1;
+    setsockopt(this->__socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+bool
+http_client::connected() const noexcept
+{
+    return this->__socket != -1;
+}
+
+void
+http_client::close() noexcept
+{
+    if (this->__socket != -1)
+        ::close(this->__socket);
+
+    this->__socket = -1;
+    this->__buf.clear();
+    this->__body.reset();
+    this->__until_close = false;
+}
+
+void
+http_client::timeout(std::chrono::milliseconds timeout) noexcept
+{
+    this->__timeout = timeout;
+
+    if (this->__socket == -1)
+        return;
+
+    struct timeval tv;
+    tv.tv_sec  = timeout.count() / 1000;
+    tv.tv_usec = (timeout.count() % 1000) * 1000;
+
+    setsockopt(this->__socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(this->__socket, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+std::string
+http_client::request(
+    std::string_view method, std::string_view target,
+    const std::vector<std::pair<std::string, std::string>> &headers,
+    std::string_view body
+) const
+{
+    return serialize(
+        this->__host, this->__port, method, target, headers, body
+    );
+}
+
+std::string
+http_client::serialize(
+    std::string_view host, std::string_view port, std::string_view method,
+    std::string_view target,
+    const std::vector<std::pair<std::string, std::string>> &headers,
+    std::string_view body
+)
+{
+    std::string req;
+
+    req.reserve(128 + body.size());
+    req.append(method).append(" ").append(target).append(" HTTP/1.1\r\n");
+    req.append("Host: ").append(host);
+
+    if (port != "80")
+        req.append(":").append(port);
+
+    req.append("\r\nUser-Agent: " HTTP_CLIENT_USER_AGENT "\r\n");
+
+    for (const auto &[key, value] : headers)
+        req.append(key).append(": ").append(value).append("\r\n");
+
+    if (!body.empty())
+    {
+        req.append("Content-Length: ")
+            .append(std::to_string(body.size()))
+            .append("\r\n");
+    }
+
+    req.append("\r\n").append(body);
+
+    return req;
+}
+
+void
+http_client::send(std::string_view data)
+{
+    if (this->__socket == -1)
+        this->__fail("Not connected");
+
+    while (!data.empty())
+    {
+        ssize_t ret =
+            ::send(this->__socket, data.data(), data.size(), MSG_NOSIGNAL);
+
+        if (ret == -1 && errno == EINTR)
+            continue;
+
+        if (ret == -1)
+        {
+            this->__fail(
+                errno == EAGAIN || errno == EWOULDBLOCK
+                    ? "Timed out sending the request"
+                    : "send: " + std::string(std::strerror(errno))
+            );
+        }
+
+        data.remove_prefix(ret);
+    }
+}
+
+void
+http_client::__fail(const std::string &message)
+{
+    this->close();
+
+    throw std::runtime_error(
+        hfs::format_function_error(__FILE__, __LINE__, message)
+    );
+}
+
+/**
+ * @brief Receive more bytes into the buffer.
+ *
+ * @return `false` if the server has closed the connection.
+ */
+bool
+http_client::__fill()
+{
+    if (this->__socket == -1)
+        this->__fail("Not connected");
+
+    char buf[16 * 1024];
+    ssize_t ret;
+
+    while ((ret = recv(this->__socket, buf, sizeof(buf), 0)) == -1 &&
+           errno == EINTR)
+    {
+    }
+
+    if (ret == -1)
+    {
+        this->__fail(
+            errno == EAGAIN || errno == EWOULDBLOCK
+                ? "Timed out waiting for the response"
+                : "recv: " + std::string(std::strerror(errno))
+        );
+    }
+
+    this->__buf.append(buf, ret);
+
+    return ret > 0;
+}
+
+[[noreturn]] static void
+__malformed(const std::string &message)
+{
+    throw std::runtime_error(
+        hfs::format_function_error(__FILE__, __LINE__, message)
+    );
+}
+
+/**
+ * @brief Decode a chunked body starting at `offset`.
+ *
+ * @return `std::size_t` - The offset right after the trailer section, or 0
+ * if the body is not complete yet.
+ */
+static std::size_t
+__parse_chunked(std::string_view data, std::size_t offset, std::string &body)
+{
+    for (;;)
+    {
+        std::size_t eol = data.find("\r\n", offset);
+
+        if (eol == std::string_view::npos)
+            return 0;
+
+        // chunk-size [ chunk-ext ] CRLF
+        std::size_t size = 0, digits = 0;
+
+        for (std::size_t i = offset; i < eol; i++, digits++)
+        {
+            char c = data[i];
+            int value;
+
+            if (c >= '0' && c <= '9')
+                value = c - '0';
+            else if (c >= 'a' && c <= 'f')
+                value = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                value = c - 'A' + 10;
+            else
+                break;
+
+            if (size > (SIZE_MAX >> 4))
+                __malformed("Chunk size overflow");
+
+            size = size << 4 | value;
+        }
+
+        if (digits == 0)
+            __malformed("Malformed chunk size");
+
+        offset = eol + 2;
+
+        if (size == 0)
+            break;
+
+        if (data.size() < offset + size + 2)
+            return 0;
+
+        body.append(data.substr(offset, size));
+        offset += size;
+
+        if (data.substr(offset, 2) != "\r\n")
+            __malformed("Missing CRLF after a chunk");
+
+        offset += 2;
+    }
+
+    // trailer-section CRLF: skip the trailer fields up to the empty line
+    for (;;)
+    {
+        std::size_t eol = data.find("\r\n", offset);
+
+        if (eol == std::string_view::npos)
+            return 0;
+
+        bool empty = eol == offset;
+        offset     = eol + 2;
+
+        if (empty)
+            return offset;
+    }
+}
+
+/**
+ * @brief Check whether a header value contains a token, e.g. `close` in
+ * `Connection: close`, regardless of case.
+ */
+static bool
+__has_token(std::string_view value, std::string_view token)
+{
+    for (std::size_t i = 0; i + token.size() <= value.size(); i++)
+    {
+        if (strncasecmp(value.data() + i, token.data(), token.size()) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Parse the head of the response at the start of `data`, skipping the
+ * interim `1xx` responses.
+ *
+ * @return `std::size_t` - The offset right after the head, or 0 if it is not
+ * complete yet.
+ */
+static std::size_t
+__parse_head(std::string_view data, http_client::response &res)
+{
+    std::size_t begin = 0, end;
+    bool http10;
+
+    for (;;)
+    {
+        end = data.find("\r\n\r\n", begin);
+
+        if (end == std::string_view::npos)
+        {
+            if (data.size() - begin > __MAX_HEAD)
+                __malformed("Response header section too large");
+
+            return 0;
+        }
+
+        // status-line = HTTP-version SP status-code SP [ reason-phrase ]
+        std::string_view head_view = data.substr(begin, end + 2 - begin);
+        std::size_t eol            = head_view.find("\r\n");
+        std::string_view line      = head_view.substr(0, eol);
+
+        if (line.size() < 12 || line.substr(0, 7) != "HTTP/1." ||
+            line[8] != ' ' || !std::isdigit(line[9]) ||
+            !std::isdigit(line[10]) || !std::isdigit(line[11]))
+        {
+            __malformed("Malformed status line: " + std::string(line));
+        }
+
+        int status = (line[9] - '0') * 100 + (line[10] - '0') * 10 +
+                     (line[11] - '0');
+        http10     = line[7] == '0';
+
+        // Interim responses, e.g. `100 Continue`, precede the final one
+        if (status >= 100 && status < 200)
+        {
+            begin = end + 4;
+            continue;
+        }
+
+        res.status = (http_status_code_t)status;
+        res.reason = hfs::trim(line.substr(12));
+        res.headers.clear();
+        res.cookies.clear();
+
+        for (std::size_t pos = eol + 2; pos < head_view.size();)
+        {
+            std::size_t next       = head_view.find("\r\n", pos);
+            std::string_view field = head_view.substr(pos, next - pos);
+            std::size_t colon      = field.find(':');
+
+            pos = next + 2;
+
+            if (colon == std::string_view::npos || colon == 0)
+                __malformed("Malformed header field: " + std::string(field));
+
+            std::string name(field.substr(0, colon));
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+            std::string_view value = hfs::trim(field.substr(colon + 1));
+
+            if (name == "set-cookie")
+            {
+                res.cookies.emplace_back(value);
+                continue;
+            }
+
+            auto [it, inserted] = res.headers.try_emplace(name, value);
+
+            if (!inserted)
+                it->second.append(", ").append(value);
+        }
+
+        break;
+    }
+
+    auto it = res.headers.find("connection");
+    std::string_view connection =
+        it == res.headers.end() ? "" : std::string_view(it->second);
+
+    res.keep_alive = http10 ? __has_token(connection, "keep-alive")
+                            : !__has_token(connection, "close");
+    res.body.clear();
+
+    return end + 4;
+}
+
+/**
+ * @brief How the body of a response is delimited, see RFC 9112 Section 6.3.
+ */
+enum class __framing
+{
+    NONE,
+    CHUNKED,
+    LENGTH,
+    CLOSE,
+};
+
+static __framing
+__body_framing(const http_client::response &res, bool head, std::size_t &length)
+{
+    auto header = [&res](const std::string &name) -> std::string_view
+    {
+        auto it = res.headers.find(name);
+        return it == res.headers.end() ? "" : std::string_view(it->second);
+    };
+
+    if (head || res.status == 204 || res.status == 304)
+        return __framing::NONE;
+
+    if (__has_token(header("transfer-encoding"), "chunked"))
+        return __framing::CHUNKED;
+
+    std::string_view value = header("content-length");
+
+    // Without framing, the body runs until the server closes
+    if (value.empty())
+        return __framing::CLOSE;
+
+    length = 0;
+
+    for (char c : value)
+    {
+        if (!std::isdigit(c))
+            __malformed("Malformed Content-Length: " + std::string(value));
+
+        length = length * 10 + (c - '0');
+    }
+
+    return length > 0 ? __framing::LENGTH : __framing::NONE;
+}
+
+std::size_t
+http_client::parse(
+    std::string_view data, response &res, bool head, bool closed
+)
+{
+    std::size_t offset = __parse_head(data, res), length;
+
+    if (offset == 0)
+        return 0;
+
+    switch (__body_framing(res, head, length))
+    {
+    case __framing::NONE:
+        break;
+    case __framing::CHUNKED:
+        offset = __parse_chunked(data, offset, res.body);
+
+        if (offset == 0)
+            return 0;
+
+        break;
+    case __framing::LENGTH:
+        if (data.size() < offset + length)
+            return 0;
+
+        res.body.assign(data.substr(offset, length));
+        offset += length;
+        break;
+    case __framing::CLOSE:
+        if (!closed)
+            return 0;
+
+        res.body.assign(data.substr(offset));
+        offset         = data.size();
+        res.keep_alive = false;
+        break;
+    }
+
+    res.size = offset;
+
+    return offset;
+}
+
+http_client::response
+http_client::receive(bool head)
+{
+    response res;
+    bool closed = false;
+
+    if (this->reading_body())
+        this->__fail("The body of the previous response has not been read");
+
+    for (;;)
+    {
+        std::size_t size;
+
+        try
+        {
+            size = parse(this->__buf, res, head, closed);
+        }
+        catch (const std::runtime_error &e)
+        {
+            this->close();
+            throw;
+        }
+
+        if (size != 0)
+        {
+            this->__buf.erase(0, size);
+            break;
+        }
+
+        if (closed)
+        {
+            this->__fail(
+                this->__buf.empty() ? "Connection closed before a response"
+                                    : "Connection closed in a response"
+            );
+        }
+
+        closed = !this->__fill();
+    }
+
+    if (!res.keep_alive)
+        this->close();
+
+    return res;
+}
+
+http_client::response
+http_client::receive_head(bool head)
+{
+    response res;
+    std::size_t size, length;
+    __framing framing;
+
+    if (this->reading_body())
+        this->__fail("The body of the previous response has not been read");
+
+    for (;;)
+    {
+        try
+        {
+            size = __parse_head(this->__buf, res);
+
+            if (size != 0)
+                framing = __body_framing(res, head, length);
+        }
+        catch (const std::runtime_error &e)
+        {
+            this->close();
+            throw;
+        }
+
+        if (size != 0)
+            break;
+
+        if (!this->__fill())
+        {
+            this->__fail(
+                this->__buf.empty() ? "Connection closed before a response"
+                                    : "Connection closed in a response"
+            );
+        }
+    }
+
+    this->__buf.erase(0, size);
+    this->__keep_alive = res.keep_alive;
+    res.size           = size;
+
+    // The bytes received past the head are the beginning of the body
+    switch (framing)
+    {
+    case __framing::NONE:
+        if (!res.keep_alive)
+            this->close();
+        break;
+    case __framing::CHUNKED:
+    case __framing::LENGTH:
+        this->__body = std::make_unique<http_body_reader>(
+            this->__socket, this->__buf,
+            framing == __framing::LENGTH ? std::optional<std::size_t>(length)
+                                         : std::nullopt
+        );
+        this->__buf.clear();
+        break;
+    case __framing::CLOSE:
+        this->__until_close = true;
+        this->__keep_alive  = false;
+        res.keep_alive      = false;
+        break;
+    }
+
+    return res;
+}
+
+bool
+http_client::reading_body() const noexcept
+{
+    return this->__body != nullptr || this->__until_close;
+}
+
+std::size_t
+http_client::read_body(char *buf, std::size_t size)
+{
+    if (this->__until_close)
+    {
+        if (this->__buf.empty() && !this->__fill())
+        {
+            this->close();
+            return 0;
+        }
+
+        std::size_t n = std::min(size, this->__buf.size());
+
+        std::memcpy(buf, this->__buf.data(), n);
+        this->__buf.erase(0, n);
+
+        return n;
+    }
+
+    if (this->__body == nullptr)
+        return 0;
+
+    std::size_t n;
+
+    try
+    {
+        n = this->__body->read(buf, size);
+    }
+    catch (const std::runtime_error &e)
+    {
+        this->close();
+        throw;
+    }
+
+    if (this->__body->eof())
+    {
+        this->__body.reset();
+
+        if (!this->__keep_alive)
+            this->close();
+    }
+
+    return n;
+}
+} // namespace hfs
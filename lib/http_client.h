@@ -1,12 +1,227 @@
 #ifndef __HTTP_CLIENT_H__
 #define __HTTP_CLIENT_H__ 1
 
+#include <http_body_reader.h>
 #include <http_core.h>
 
 #define HTTP_CLIENT_USER_AGENT "http-from-scratch client"
 
-class HttpClient
+namespace hfs
 {
+/**
+ * @brief Blocking HTTP/1.1 client over one connection at a time.
+ *
+ * Requests and responses are decoupled, so that several requests can be
+ * written before their responses are read (pipelining). Bytes received past
+ * the end of a response are kept for the next one.
+ *
+ * For example:
+ *
+ * @code
+ * ```cpp
+ * hfs::http_client client("localhost", "7000");
+ *
+ * client.connect();
+ * client.send(client.request("GET", "/"));
+ *
+ * hfs::http_client::response res = client.receive();
+ * std::cout << res.status << " " << res.body.size() << std::endl;
+ * ```
+ * @endcode
+ */
+class http_client
+{
+public:
+    struct response
+    {
+        http_status_code_t status;
+        std::string reason;
+
+        /**
+         * @brief The header fields, with lowercase names.
+         */
+        std::unordered_map<std::string, std::string> headers;
+
+        /**
+         * @brief The `Set-Cookie` fields in their order. Unlike the other
+         * fields they cannot be joined into one, see RFC 6265 Section 3.
+         */
+        std::vector<std::string> cookies;
+
+        /**
+         * @brief The decoded body.
+         */
+        std::string body;
+
+        /**
+         * @brief Whether the server keeps the connection open afterwards.
+         */
+        bool keep_alive;
+
+        /**
+         * @brief The number of bytes the response took on the wire.
+         */
+        std::size_t size;
+    };
+
+    /**
+     * @brief Resolve the address of a server. The connection is opened by
+     * `connect`.
+     *
+     * @throw `std::runtime_error` - If the address cannot be resolved.
+     */
+    http_client(const std::string &host, const std::string &port);
+
+    ~http_client();
+
+    http_client(const http_client &) = delete;
+
+    http_client &
+    operator=(const http_client &) = delete;
+
+    /**
+     * @brief Open a new connection, closing the current one if any.
+     *
+     * @throw `std::runtime_error` - If the connection fails.
+     */
+    void
+    connect();
+
+    bool
+    connected() const noexcept;
+
+    void
+    close() noexcept;
+
+    /**
+     * @brief Limit the time a connection, a single send or a single receive
+     * may block. A zero timeout blocks forever.
+     */
+    void
+    timeout(std::chrono::milliseconds timeout) noexcept;
+
+    /**
+     * @brief Serialize a request to this server, with its `Host` and
+     * `User-Agent`, and a `Content-Length` if there is a body.
+     *
+     * @param method - The method, e.g. `GET`.
+     * @param target - The request target, e.g. `/blogs/hello?page=2`.
+     * @param headers - Additional header fields.
+     * @param body - The body.
+     */
+    std::string
+    request(
+        std::string_view method, std::string_view target,
+        const std::vector<std::pair<std::string, std::string>> &headers = {},
+        std::string_view body = {}
+    ) const;
+
+    /**
+     * @brief Serialize a request to any server, like `request` does.
+     */
+    static std::string
+    serialize(
+        std::string_view host, std::string_view port, std::string_view method,
+        std::string_view target,
+        const std::vector<std::pair<std::string, std::string>> &headers = {},
+        std::string_view body = {}
+    );
+
+    /**
+     * @brief Write bytes to the connection.
+     *
+     * @throw `std::runtime_error` - If the connection fails or times out.
+     */
+    void
+    send(std::string_view data);
+
+    /**
+     * @brief Read the next response from the connection.
+     *
+     * @param head - Whether the response answers a `HEAD` request, which
+     * has no body whatever its headers say.
+     * @throw `std::runtime_error` - If the connection fails, times out or
+     * is closed early, or if the response is malformed. The connection is
+     * closed then.
+     */
+    response
+    receive(bool head = false);
+
+    /**
+     * @brief Read the head of the next response, and leave its body on the
+     * connection to be read by pieces with `read_body`. This is how a body
+     * is relayed without holding it in memory, so it must not be combined
+     * with pipelining.
+     *
+     * @param head - Whether the response answers a `HEAD` request.
+     * @return `response` - The response, without its body.
+     * @throw `std::runtime_error` - If the connection fails, times out or
+     * is closed early, if the response is malformed, or if the body of the
+     * previous response has not been read. The connection is closed then.
+     */
+    response
+    receive_head(bool head = false);
+
+    /**
+     * @brief Check whether the body of the response received by
+     * `receive_head` has not been read entirely yet.
+     */
+    bool
+    reading_body() const noexcept;
+
+    /**
+     * @brief Read the next piece of the body of the response received by
+     * `receive_head`, with its transfer coding removed. The connection is
+     * closed at the end of the body if the server does not keep it open.
+     *
+     * @param buf - The buffer the piece is copied into.
+     * @param size - The size of the buffer.
+     * @return `std::size_t` - The size of the piece, or 0 at the end of the
+     * body.
+     * @throw `std::runtime_error` - If the connection fails, times out or is
+     * closed early, or if the framing is malformed. The connection is closed
+     * then.
+     */
+    std::size_t
+    read_body(char *buf, std::size_t size);
+
+    /**
+     * @brief Parse the response at the start of the received bytes, without
+     * waiting for more. Interim `1xx` responses are skipped.
+     *
+     * @param data - The bytes received so far on a connection.
+     * @param res - The response, complete when a size is returned.
+     * @param head - Whether the response answers a `HEAD` request.
+     * @param closed - Whether the server has closed the connection, which
+     * ends a body that has neither a length nor chunks.
+     * @return `std::size_t` - The number of bytes the response took, or 0 if
+     * it is not complete yet.
+     * @throw `std::runtime_error` - If the response is malformed.
+     */
+    static std::size_t
+    parse(
+        std::string_view data, response &res, bool head = false,
+        bool closed = false
+    );
+
+private:
+    std::string __host;
+    std::string __port;
+    struct sockaddr_storage __addr;
+    socklen_t __addrlen;
+    int __socket;
+    std::chrono::milliseconds __timeout;
+    std::string __buf;
+    std::unique_ptr<http_body_reader> __body;
+    bool __keep_alive;
+    bool __until_close;
+
+    bool
+    __fill();
+
+    [[noreturn]] void
+    __fail(const std::string &message);
 };
+} // namespace hfs
 
 #endif // __HTTP_CLIENT_H__
@@ -0,0 +1,300 @@
+#include <http_compressor.h>
+#include <http_encoding.h>
+
+namespace hfs
+{
+http_compressor::http_compressor(std::string_view coding, int level)
+    : __finished(false)
+{
+    std::memset(&this->__stream, 0, sizeof(this->__stream));
+
+    // 15 window bits select the zlib wrapper (`deflate`), adding 16 selects
+    // the gzip wrapper instead.
+    int window_bits = coding == http_encoding::GZIP ? 15 + 16 : 15;
+
+    if (deflateInit2(
+            &this->__stream, level, Z_DEFLATED, window_bits, 8,
+            Z_DEFAULT_STRATEGY
+        ) != Z_OK)
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__,
+            "deflateInit2 failed for coding " + std::string(coding)
+        ));
+    }
+}
+
+http_compressor::~http_compressor()
+{
+    deflateEnd(&this->__stream);
+}
+
+void
+http_compressor::update(std::string_view input, std::string &output)
+{
+    this->__stream.next_in  = (Bytef *)input.data();
+    this->__stream.avail_in = input.size();
+
+    this->__deflate(Z_NO_FLUSH, output);
+}
+
+void
+http_compressor::flush(std::string &output)
+{
+    this->__deflate(Z_SYNC_FLUSH, output);
+}
+
+void
+http_compressor::finish(std::string &output)
+{
+    if (this->__finished)
+        return;
+
+    this->__deflate(Z_FINISH, output);
+    this->__finished = true;
+}
+
+void
+http_compressor::__deflate(int flush, std::string &output)
+{
+    int ret;
+
+    // Grow the output by fixed steps until zlib has consumed all the input
+    // and has nothing left to emit for the requested flush mode.
+    do
+    {
+        std::size_t offset = output.size();
+        output.resize(offset + hfs::HTTP_BUFSZ);
+
+        this->__stream.next_out  = (Bytef *)output.data() + offset;
+        this->__stream.avail_out = hfs::HTTP_BUFSZ;
+
+        ret = deflate(&this->__stream, flush);
+
+        output.resize(offset + hfs::HTTP_BUFSZ - this->__stream.avail_out);
+
+        if (ret == Z_STREAM_ERROR)
+        {
+            throw std::runtime_error(hfs::format_function_error(
+                __FILE__, __LINE__, "deflate failed"
+            ));
+        }
+    } while (this->__stream.avail_out == 0 ||
+             (flush == Z_FINISH && ret != Z_STREAM_END));
+}
+
+bool
+http_compressor::compressible(
+    const options &opts, std::string_view content_type
+)
+{
+    std::string_view mime =
+        hfs::trim(content_type.substr(0, content_type.find(';')));
+
+    for (const auto &allowed : opts.mime_types)
+    {
+        if (hfs::iequals(mime, allowed))
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Check the status and the headers that allow a response to be
+ * compressed, whether its body is buffered or streamed.
+ */
+static bool
+__transformable(
+    const http_compressor::options &opts, const hfs::http_response &res
+)
+{
+    if (res.status() != HTTP_STATUS_OK)
+        return false;
+
+    try
+    {
+        if (!http_compressor::compressible(opts, res.header("Content-Type")))
+            return false;
+    }
+    catch (const std::out_of_range &e)
+    {
+        return false;
+    }
+
+    try
+    {
+        res.header("Content-Encoding");
+        return false;
+    }
+    catch (const std::out_of_range &e)
+    {
+    }
+
+    try
+    {
+        if (res.header("Cache-Control").find("no-transform") !=
+            std::string::npos)
+        {
+            return false;
+        }
+    }
+    catch (const std::out_of_range &e)
+    {
+    }
+
+    return true;
+}
+
+bool
+http_compressor::eligible(const options &opts, const hfs::http_response &res)
+{
+    if (res.has_file_segments() || res.body().size() < opts.min_size)
+        return false;
+
+    return __transformable(opts, res);
+}
+
+/**
+ * @brief Select the coding accepted by the client, if any.
+ */
+static std::string_view
+__accepted_coding(const hfs::http_request &req)
+{
+    static const std::vector<std::string_view> available = {
+        http_encoding::GZIP,
+        http_encoding::DEFLATE,
+    };
+
+    try
+    {
+        return http_encoding::negotiate(
+            req.header("Accept-Encoding"), available
+        );
+    }
+    catch (const std::out_of_range &e)
+    {
+        return "";
+    }
+}
+
+std::string_view
+http_compressor::negotiate(
+    const options &opts, const hfs::http_request &req,
+    const hfs::http_response &res
+)
+{
+    if (!eligible(opts, res))
+        return "";
+
+    return __accepted_coding(req);
+}
+
+/**
+ * @brief Mark a response as depending on `Accept-Encoding`, so that shared
+ * caches do not hand a compressed body to a client that cannot decode it.
+ */
+static void
+__vary_accept_encoding(hfs::http_response &res)
+{
+    try
+    {
+        std::string vary = res.header("Vary");
+
+        if (vary.find("Accept-Encoding") == std::string::npos)
+            res.header("Vary", vary + ", Accept-Encoding");
+    }
+    catch (const std::out_of_range &e)
+    {
+        res.header("Vary", "Accept-Encoding");
+    }
+}
+
+/**
+ * @brief A strong validator identifies the exact bytes, so the encoded
+ * representation gets its own. Weak validators stay valid.
+ */
+static void
+__encode_etag(hfs::http_response &res, std::string_view coding)
+{
+    try
+    {
+        std::string_view etag = res.header("ETag");
+
+        if (etag.size() >= 2 && etag.front() == '"' && etag.back() == '"')
+        {
+            std::stringstream tagged;
+            tagged << etag.substr(0, etag.size() - 1) << "-" << coding << "\"";
+
+            res.header("ETag", tagged.str());
+        }
+    }
+    catch (const std::out_of_range &e)
+    {
+    }
+}
+
+bool
+http_compressor::compress(
+    const options &opts, const hfs::http_request &req, hfs::http_response &res
+)
+{
+    if (!eligible(opts, res))
+        return false;
+
+    // The response could have been compressed for another client
+    __vary_accept_encoding(res);
+
+    std::string_view coding = negotiate(opts, req, res);
+
+    if (coding.empty())
+        return false;
+
+    const std::string &body = res.body();
+    std::string compressed;
+
+    compressed.reserve(body.size() / 4);
+
+    // Feed the body by pieces, like a streamed body would be
+    http_compressor compressor(coding, opts.level);
+
+    for (std::size_t offset = 0; offset < body.size();
+         offset += hfs::HTTP_BUFSZ)
+    {
+        compressor.update(
+            std::string_view(body).substr(offset, hfs::HTTP_BUFSZ), compressed
+        );
+    }
+
+    compressor.finish(compressed);
+
+    res.body(compressed).header("Content-Encoding", std::string(coding));
+
+    __encode_etag(res, coding);
+
+    return true;
+}
+
+bool
+http_compressor::compress_stream(
+    const options &opts, const hfs::http_request &req, hfs::http_response &res
+)
+{
+    if (!__transformable(opts, res))
+        return false;
+
+    __vary_accept_encoding(res);
+
+    std::string_view coding = __accepted_coding(req);
+
+    if (coding.empty())
+        return false;
+
+    res.header("Content-Encoding", std::string(coding))
+        .encode_stream(std::make_unique<http_compressor>(coding, opts.level));
+
+    __encode_etag(res, coding);
+
+    return true;
+}
+} // namespace hfs
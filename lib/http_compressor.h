@@ -0,0 +1,161 @@
+#ifndef __HTTP_COMPRESSOR_H__
+#define __HTTP_COMPRESSOR_H__ 1
+
+#include <http_core.h>
+#include <http_request.h>
+#include <http_response.h>
+
+namespace hfs
+{
+/**
+ * @brief Streaming `gzip` and `deflate` content coding built on zlib.
+ *
+ * A compressor is fed with the body in as many pieces as needed and appends
+ * the compressed bytes to an output buffer, so that the whole body never has
+ * to be compressed in a single call.
+ */
+class http_compressor
+{
+public:
+    /**
+     * @brief Settings of the response compression stage of a server.
+     */
+    struct options
+    {
+        /**
+         * @brief The zlib compression level, from 1 (fastest) to 9 (smallest).
+         */
+        int level = Z_DEFAULT_COMPRESSION;
+
+        /**
+         * @brief Bodies smaller than this are sent as is, because the coding
+         * overhead outweighs the savings.
+         */
+        std::size_t min_size = 1024;
+
+        /**
+         * @brief Media types, without parameters, that are compressed.
+         */
+        std::vector<std::string> mime_types = {
+            "text/html",
+            "text/css",
+            "text/plain",
+            "text/javascript",
+            "text/xml",
+            "application/javascript",
+            "application/json",
+            "application/xml",
+            "image/svg+xml",
+        };
+    };
+
+    /**
+     * @brief Construct a new compressor.
+     *
+     * @param coding - Either `gzip` or `deflate`.
+     * @param level - The zlib compression level.
+     * @throw `std::runtime_error` - If zlib cannot be initialized.
+     */
+    explicit http_compressor(
+        std::string_view coding, int level = Z_DEFAULT_COMPRESSION
+    );
+
+    ~http_compressor();
+
+    http_compressor(const http_compressor &) = delete;
+
+    http_compressor &
+    operator=(const http_compressor &) = delete;
+
+    /**
+     * @brief Compress a piece of the body. zlib may keep some of the input
+     * buffered until more is given or the stream is flushed.
+     *
+     * @param input - The next bytes of the body.
+     * @param output - The buffer where the compressed bytes are appended.
+     */
+    void
+    update(std::string_view input, std::string &output);
+
+    /**
+     * @brief Emit everything that has been given so far on a byte boundary,
+     * so that the peer can decode it without waiting for the end of the body.
+     *
+     * @param output - The buffer where the compressed bytes are appended.
+     */
+    void
+    flush(std::string &output);
+
+    /**
+     * @brief Terminate the stream. The compressor cannot be used afterwards.
+     *
+     * @param output - The buffer where the compressed bytes are appended.
+     */
+    void
+    finish(std::string &output);
+
+    /**
+     * @brief Check whether a response may be compressed, regardless of what
+     * the client accepts: it must be a successful `200` response with an
+     * in-memory body of at least `min_size` bytes, an allowed media type, no
+     * `Content-Encoding` yet and no `Cache-Control: no-transform`.
+     */
+    static bool
+    eligible(const options &opts, const hfs::http_response &res);
+
+    /**
+     * @brief Select the coding to apply to a response, if any. The response
+     * must be `eligible` and the client must accept `gzip` or `deflate`.
+     *
+     * @return `std::string_view` - The coding to apply, or an empty view.
+     */
+    static std::string_view
+    negotiate(
+        const options &opts, const hfs::http_request &req,
+        const hfs::http_response &res
+    );
+
+    /**
+     * @brief Check whether a `Content-Type` is one of the allowed media types.
+     */
+    static bool
+    compressible(const options &opts, std::string_view content_type);
+
+    /**
+     * @brief Compress the body of a response in place when `negotiate`
+     * selects a coding, and update `Content-Encoding`, `Content-Length` and
+     * `ETag` accordingly. Every eligible response gets a `Vary` header.
+     *
+     * @return `true` if the response has been compressed.
+     */
+    static bool
+    compress(
+        const options &opts, const hfs::http_request &req,
+        hfs::http_response &res
+    );
+
+    /**
+     * @brief Set up the compression of a streamed body, from the stream hook
+     * of a response. The response must be a `200` response with an allowed
+     * media type, no `Content-Encoding` and no `Cache-Control: no-transform`,
+     * and the client must accept `gzip` or `deflate`. There is no minimum
+     * size since the length of the body is unknown.
+     *
+     * @return `true` if the streamed body is going to be compressed.
+     */
+    static bool
+    compress_stream(
+        const options &opts, const hfs::http_request &req,
+        hfs::http_response &res
+    );
+
+private:
+    z_stream __stream;
+    bool __finished;
+
+    void
+    __deflate(int flush, std::string &output);
+};
+} // namespace hfs
+
+#endif // __HTTP_COMPRESSOR_H__
@@ -6,29 +6,43 @@
 
 // Core C++ headers
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cctype>
 #include <chrono>
+#include <cmath>
 #include <condition_variable>
+#include <csignal>
 #include <cstring>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <future>
 #include <ios>
 #include <iostream>
+#include <list>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <numeric>
 #include <optional>
+#include <random>
 #include <sstream>
 #include <string>
 #include <string_view>
 #include <thread>
+#include <tuple>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 // Core POSIX headers
 #include <fcntl.h>
+#include <strings.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -40,17 +54,33 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 
 // Third-party headers
 #include <nlohmann/json.hpp> // For working with JSON structure
 #include <pantor/inja.hpp>   // For working with Jinja2-like templates
 #include <uriparser/Uri.h>   // For parsing URIs
+#include <zlib.h>            // For compressing response bodies
 
 // UUID headers
 #ifdef HAVE_UUID_UUID_H
 #include <uuid/uuid.h>
 #endif
 
+// Zero-copy file transfer headers
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+
+// SIMD intrinsics for scanning request paths
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #ifdef HAVE_CSTDBOOL_H
 #include <cstdbool>
 #else
@@ -77,6 +107,10 @@ static constexpr const char *HTTP_SERVER_VERSION       = "HTTP/1.1";
 static constexpr std::size_t HTTP_SERVER__DEFAULT_PORT = 7000;
 static constexpr std::size_t HTTP_BUFSZ                = 8192; // 8KB
 static constexpr std::size_t HTTP_HDRSZ                = 2048; // 2KB
+static constexpr std::size_t HTTP_MAX_RANGES           = 16;
+static constexpr std::size_t HTTP_MAX_BODYSZ           = 8 * 1024 * 1024; // 8MB
+static constexpr std::size_t HTTP_LOG_PATHSZ           = 256;
+static constexpr std::size_t HTTP_LOG_BATCHSZ          = 64 * 1024; // 64KB
 
 static constexpr const char template_error[] = R"(
 <!DOCTYPE html>
@@ -95,10 +129,11 @@ static constexpr const char template_error[] = R"(
 typedef enum http_status_code
 {
     /* Request fulfilled */
-    HTTP_STATUS_OK         = 200,
-    HTTP_STATUS_CREATED    = 201,
-    HTTP_STATUS_ACCEPTED   = 202,
-    HTTP_STATUS_NO_CONTENT = 204,
+    HTTP_STATUS_OK              = 200,
+    HTTP_STATUS_CREATED         = 201,
+    HTTP_STATUS_ACCEPTED        = 202,
+    HTTP_STATUS_NO_CONTENT      = 204,
+    HTTP_STATUS_PARTIAL_CONTENT = 206,
 
     /* Redirection */
     HTTP_STATUS_MOVED_PERMANENTLY = 301,
@@ -114,6 +149,8 @@ typedef enum http_status_code
     HTTP_STATUS_LENGTH_REQUIRED                 = 411,
     HTTP_STATUS_REQUEST_TOO_LARGE               = 413,
     HTTP_STATUS_URI_TOO_LONG                    = 414,
+    HTTP_STATUS_RANGE_NOT_SATISFIABLE           = 416,
+    HTTP_STATUS_EXPECTATION_FAILED              = 417,
     HTTP_STATUS_REQUEST_HEADER_FIELDS_TOO_LARGE = 431,
 
     /* Server errors */
@@ -138,6 +175,8 @@ http_status_str(http_status_code_t status)
         return "Accepted";
     case HTTP_STATUS_NO_CONTENT:
         return "No Content";
+    case HTTP_STATUS_PARTIAL_CONTENT:
+        return "Partial Content";
     case HTTP_STATUS_MOVED_PERMANENTLY:
         return "Moved Permanently";
     case HTTP_STATUS_FOUND:
@@ -154,8 +193,16 @@ http_status_str(http_status_code_t status)
         return "Method Not Allowed";
     case HTTP_STATUS_REQUEST_TIMEOUT:
         return "Request Timeout";
+    case HTTP_STATUS_LENGTH_REQUIRED:
+        return "Length Required";
     case HTTP_STATUS_REQUEST_TOO_LARGE:
         return "Request Entity Too Large";
+    case HTTP_STATUS_URI_TOO_LONG:
+        return "URI Too Long";
+    case HTTP_STATUS_RANGE_NOT_SATISFIABLE:
+        return "Range Not Satisfiable";
+    case HTTP_STATUS_EXPECTATION_FAILED:
+        return "Expectation Failed";
     case HTTP_STATUS_REQUEST_HEADER_FIELDS_TOO_LARGE:
         return "Request Header Fields Too Large";
     case HTTP_STATUS_INTERNAL_SERVER_ERROR:
@@ -178,8 +225,6 @@ http_status_str(http_status_code_t status)
 inline static const char *
 http_mime(const std::string &ext)
 {
-    std::cout << "ext: " << ext << std::endl;
-
     if (ext == "html")
         return "text/html";
     else if (ext == "css")
@@ -248,6 +293,102 @@ current_date()
     return format_date(time(0));
 }
 
+/**
+ * @brief Remove the optional whitespaces (`OWS`, spaces and horizontal tabs)
+ * around a header field value or a list element.
+ *
+ * @param str - A view over the value.
+ * @return `std::string_view` - A view over the same buffer without the
+ * surrounding whitespaces.
+ */
+inline static std::string_view
+trim(std::string_view str)
+{
+    while (!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+        str.remove_prefix(1);
+
+    while (!str.empty() && (str.back() == ' ' || str.back() == '\t'))
+        str.remove_suffix(1);
+
+    return str;
+}
+
+/**
+ * @brief Compare two tokens without regard to ASCII case, as header field
+ * names, content codings and media types are.
+ */
+inline static bool
+iequals(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size() &&
+           strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+/**
+ * @brief Check whether a method may be sent twice with the same effect as
+ * once, as defined in RFC 9110 Section 9.2.2, which allows a request to be
+ * pipelined and retried.
+ */
+inline static bool
+idempotent(std::string_view method)
+{
+    static constexpr std::array<std::string_view, 6> methods = {
+        "GET", "HEAD", "PUT", "DELETE", "OPTIONS", "TRACE",
+    };
+
+    return std::find(methods.begin(), methods.end(), method) != methods.end();
+}
+
+/**
+ * @brief Transparent hash for containers keyed by `std::string`, so that they
+ * can be searched with a `std::string_view` without building a key.
+ */
+struct string_hash
+{
+    using is_transparent = void;
+
+    std::size_t
+    operator()(std::string_view str) const noexcept
+    {
+        return std::hash<std::string_view>{}(str);
+    }
+};
+
+/**
+ * @brief Hash and equality of header field names, which do not depend on
+ * their ASCII case. Both are transparent like `string_hash`.
+ */
+struct istring_hash
+{
+    using is_transparent = void;
+
+    std::size_t
+    operator()(std::string_view str) const noexcept
+    {
+        // FNV-1a over the lowercase bytes
+        std::size_t hash = 14695981039346656037ULL;
+
+        for (char c : str)
+        {
+            hash ^= (unsigned char)std::tolower((unsigned char)c);
+            hash *= 1099511628211ULL;
+        }
+
+        return hash;
+    }
+};
+
+struct iequal_to
+{
+    using is_transparent = void;
+
+    bool
+    operator()(std::string_view a, std::string_view b) const noexcept
+    {
+        return iequals(a, b);
+    }
+};
+
 /**
  * @brief Handle syscall-related errors if `status` is set to -1. Otherwise,
  * it will ignore.
@@ -0,0 +1,120 @@
+#include <http_encoding.h>
+
+namespace hfs
+{
+http_encoding::http_encoding()
+{
+}
+
+http_encoding::~http_encoding()
+{
+}
+
+/**
+ * @brief Parse the weight of a list element, e.g. `;q=0.8`. A missing or
+ * malformed weight counts as 1.
+ */
+static double
+__parse_weight(std::string_view params)
+{
+    while (!params.empty())
+    {
+        std::size_t semicolon  = params.find(';');
+        std::string_view param = hfs::trim(params.substr(0, semicolon));
+        params                 = semicolon == std::string_view::npos
+                                     ? ""
+                                     : params.substr(semicolon + 1);
+
+        if (param.size() < 2 || (param[0] != 'q' && param[0] != 'Q') ||
+            param[1] != '=')
+            continue;
+
+        // qvalue = ( "0" [ "." 0*3DIGIT ] ) / ( "1" [ "." 0*3("0") ] )
+        param.remove_prefix(2);
+
+        double weight = 0, scale = 1;
+        bool fraction = false;
+
+        for (char c : param)
+        {
+            if (c == '.' && !fraction)
+            {
+                fraction = true;
+                continue;
+            }
+
+            if (c < '0' || c > '9')
+                return 1;
+
+            if (fraction)
+                weight += (c - '0') * (scale /= 10);
+            else
+                weight = weight * 10 + (c - '0');
+        }
+
+        return std::min(weight, 1.0);
+    }
+
+    return 1;
+}
+
+double
+http_encoding::quality(
+    std::string_view accept_encoding, std::string_view coding
+)
+{
+    std::optional<double> explicit_weight, wildcard_weight;
+
+    while (!accept_encoding.empty())
+    {
+        std::size_t comma      = accept_encoding.find(',');
+        std::string_view entry = hfs::trim(accept_encoding.substr(0, comma));
+        accept_encoding        = comma == std::string_view::npos
+                                     ? ""
+                                     : accept_encoding.substr(comma + 1);
+
+        std::size_t semicolon = entry.find(';');
+        std::string_view name = hfs::trim(entry.substr(0, semicolon));
+        double weight         = 1;
+
+        if (semicolon != std::string_view::npos)
+            weight = __parse_weight(entry.substr(semicolon + 1));
+
+        if (hfs::iequals(name, coding))
+            explicit_weight = weight;
+        else if (name == "*")
+            wildcard_weight = weight;
+    }
+
+    if (explicit_weight.has_value())
+        return *explicit_weight;
+
+    if (wildcard_weight.has_value())
+        return *wildcard_weight;
+
+    return hfs::iequals(coding, IDENTITY) ? 1 : 0;
+}
+
+std::string_view
+http_encoding::negotiate(
+    std::string_view accept_encoding,
+    const std::vector<std::string_view> &available
+)
+{
+    std::string_view selected;
+    double best = 0;
+
+    for (const auto &coding : available)
+    {
+        double weight = quality(accept_encoding, coding);
+
+        if (weight > best)
+        {
+            best     = weight;
+            selected = coding;
+        }
+    }
+
+    return selected;
+}
+} // namespace hfs
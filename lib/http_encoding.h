@@ -0,0 +1,63 @@
+#ifndef __HTTP_ENCODING_H__
+#define __HTTP_ENCODING_H__ 1
+
+#include <http_core.h>
+
+namespace hfs
+{
+class http_encoding
+{
+public:
+    static constexpr const char *IDENTITY = "identity";
+    static constexpr const char *GZIP     = "gzip";
+    static constexpr const char *DEFLATE  = "deflate";
+    static constexpr const char *BROTLI   = "br";
+
+    http_encoding();
+    ~http_encoding();
+
+    /**
+     * @brief Retrieve the quality value that an `Accept-Encoding` header
+     * assigns to a content coding, as defined in RFC 9110 Section 12.5.3.
+     *
+     * An explicit entry for the coding takes precedence over `*`. A coding
+     * that is not listed is not acceptable, except `identity` which is always
+     * acceptable unless it is explicitly refused.
+     *
+     * For example:
+     *
+     * @code
+     * ```cpp
+     * http_encoding::quality("gzip;q=0.5, br", "gzip");     // 0.5
+     * http_encoding::quality("gzip;q=0.5, br", "deflate");  // 0
+     * http_encoding::quality("gzip;q=0.5, br", "identity"); // 1
+     * ```
+     * @endcode
+     *
+     * @param accept_encoding - The raw value of the `Accept-Encoding` header.
+     * @param coding - A content coding name, compared case-insensitively.
+     * @return `double` - A quality value between 0 (not acceptable) and 1.
+     */
+    static double
+    quality(std::string_view accept_encoding, std::string_view coding);
+
+    /**
+     * @brief Select the content coding to apply to a response.
+     *
+     * The available codings are given in the order of preference of the
+     * server, which breaks ties between codings of equal quality.
+     *
+     * @param accept_encoding - The raw value of the `Accept-Encoding` header.
+     * @param available - The codings the server is able to produce.
+     * @return `std::string_view` - The selected coding, or an empty view if
+     * none of them is acceptable and the representation must be sent as is.
+     */
+    static std::string_view
+    negotiate(
+        std::string_view accept_encoding,
+        const std::vector<std::string_view> &available
+    );
+};
+} // namespace hfs
+
+#endif // __HTTP_ENCODING_H__
@@ -0,0 +1,223 @@
+#include <http_form.h>
+
+namespace hfs
+{
+static int
+__hex_value(char c) noexcept
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+
+    return -1;
+}
+
+/**
+ * @brief Decode the character at `i` of a form component and advance `i`
+ * past it.
+ */
+static char
+__decode_at(std::string_view encoded, std::size_t &i) noexcept
+{
+    char c = encoded[i++];
+
+    if (c == '+')
+        return ' ';
+
+    if (c == '%' && i + 1 < encoded.size())
+    {
+        int high = __hex_value(encoded[i]);
+        int low  = __hex_value(encoded[i + 1]);
+
+        if (high >= 0 && low >= 0)
+        {
+            i += 2;
+            return (char)((high << 4) | low);
+        }
+    }
+
+    return c;
+}
+
+/**
+ * @brief Compare an encoded component with a decoded string, without
+ * decoding the component in a new buffer.
+ */
+static bool
+__decoded_equals(std::string_view encoded, std::string_view decoded) noexcept
+{
+    std::size_t i = 0, j = 0;
+
+    while (i < encoded.size() && j < decoded.size())
+    {
+        if (__decode_at(encoded, i) != decoded[j++])
+            return false;
+    }
+
+    return i == encoded.size() && j == decoded.size();
+}
+
+std::string
+http_form::decode(std::string_view encoded)
+{
+    if (encoded.find_first_of("%+") == std::string_view::npos)
+        return std::string(encoded);
+
+    std::string decoded;
+    decoded.reserve(encoded.size());
+
+    for (std::size_t i = 0; i < encoded.size();)
+        decoded.push_back(__decode_at(encoded, i));
+
+    return decoded;
+}
+
+std::string
+http_form::field::decoded_key() const
+{
+    return http_form::decode(this->key);
+}
+
+std::string
+http_form::field::decoded_value() const
+{
+    return http_form::decode(this->value);
+}
+
+http_form::iterator::iterator() noexcept : __field(), __end(true)
+{
+}
+
+http_form::iterator::iterator(std::string_view remaining) noexcept
+    : __remaining(remaining), __field(), __end(false)
+{
+    ++(*this);
+}
+
+http_form::iterator::reference
+http_form::iterator::operator*() const noexcept
+{
+    return this->__field;
+}
+
+http_form::iterator::pointer
+http_form::iterator::operator->() const noexcept
+{
+    return &this->__field;
+}
+
+http_form::iterator &
+http_form::iterator::operator++() noexcept
+{
+    // Empty pairs, as in `a=1&&b=2`, are skipped
+    std::string_view pair;
+
+    while (pair.empty())
+    {
+        if (this->__remaining.empty())
+        {
+            this->__end = true;
+            return *this;
+        }
+
+        std::size_t amp   = this->__remaining.find('&');
+        pair              = this->__remaining.substr(0, amp);
+        this->__remaining = amp == std::string_view::npos
+                                ? std::string_view()
+                                : this->__remaining.substr(amp + 1);
+    }
+
+    std::size_t equal = pair.find('=');
+
+    this->__field.key = pair.substr(0, equal);
+    this->__field.value =
+        equal == std::string_view::npos ? "" : pair.substr(equal + 1);
+
+    return *this;
+}
+
+http_form::iterator
+http_form::iterator::operator++(int) noexcept
+{
+    iterator previous = *this;
+    ++(*this);
+
+    return previous;
+}
+
+bool
+http_form::iterator::operator==(const iterator &other) const noexcept
+{
+    if (this->__end || other.__end)
+        return this->__end == other.__end;
+
+    return this->__field.key.data() == other.__field.key.data();
+}
+
+http_form::http_form() noexcept
+{
+}
+
+http_form::http_form(std::string_view encoded) noexcept : __data(encoded)
+{
+}
+
+http_form::iterator
+http_form::begin() const noexcept
+{
+    return iterator(this->__data);
+}
+
+http_form::iterator
+http_form::end() const noexcept
+{
+    return iterator();
+}
+
+std::optional<std::string>
+http_form::get(std::string_view key) const
+{
+    for (const auto &field : *this)
+    {
+        if (__decoded_equals(field.key, key))
+            return field.decoded_value();
+    }
+
+    return std::nullopt;
+}
+
+std::vector<std::string>
+http_form::get_all(std::string_view key) const
+{
+    std::vector<std::string> values;
+
+    for (const auto &field : *this)
+    {
+        if (__decoded_equals(field.key, key))
+            values.push_back(field.decoded_value());
+    }
+
+    return values;
+}
+
+bool
+http_form::has(std::string_view key) const noexcept
+{
+    for (const auto &field : *this)
+    {
+        if (__decoded_equals(field.key, key))
+            return true;
+    }
+
+    return false;
+}
+
+std::string_view
+http_form::data() const noexcept
+{
+    return this->__data;
+}
+} // namespace hfs
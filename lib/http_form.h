@@ -0,0 +1,136 @@
+#ifndef __HTTP_FORM_H__
+#define __HTTP_FORM_H__ 1
+
+#include <http_core.h>
+
+namespace hfs
+{
+/**
+ * @brief Lazy parser of `application/x-www-form-urlencoded` data, which is
+ * the syntax of both query strings and HTML form bodies.
+ *
+ * A form is a view over the original buffer: nothing is copied or decoded
+ * when it is built. Pairs are split while iterating, and keys and values are
+ * percent-decoded only when asked for. The buffer must outlive the form.
+ *
+ * For example:
+ *
+ * @code
+ * ```cpp
+ * hfs::http_form form("name=John+Doe&city=S%C3%A3o%20Paulo");
+ *
+ * form.get("city");           // "São Paulo"
+ * form.get("age");            // std::nullopt
+ *
+ * for (const auto &field : form)
+ *     std::cout << field.key << " = " << field.value << std::endl;
+ *     // name = John+Doe, city = S%C3%A3o%20Paulo
+ * ```
+ * @endcode
+ */
+class http_form
+{
+public:
+    /**
+     * @brief A `key=value` pair, still encoded.
+     */
+    struct field
+    {
+        std::string_view key;
+        std::string_view value;
+
+        std::string
+        decoded_key() const;
+
+        std::string
+        decoded_value() const;
+    };
+
+    /**
+     * @brief Forward iterator over the non-empty pairs of a form.
+     */
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = field;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const field *;
+        using reference         = const field &;
+
+        iterator() noexcept;
+
+        explicit iterator(std::string_view remaining) noexcept;
+
+        reference
+        operator*() const noexcept;
+
+        pointer
+        operator->() const noexcept;
+
+        iterator &
+        operator++() noexcept;
+
+        iterator
+        operator++(int) noexcept;
+
+        bool
+        operator==(const iterator &other) const noexcept;
+
+    private:
+        std::string_view __remaining;
+        field __field;
+        bool __end;
+    };
+
+    http_form() noexcept;
+
+    explicit http_form(std::string_view encoded) noexcept;
+
+    iterator
+    begin() const noexcept;
+
+    iterator
+    end() const noexcept;
+
+    /**
+     * @brief Retrieve the decoded value of the first pair whose decoded key
+     * is `key`.
+     *
+     * @return `std::nullopt` if there is no such pair.
+     */
+    std::optional<std::string>
+    get(std::string_view key) const;
+
+    /**
+     * @brief Retrieve the decoded values of every pair whose decoded key is
+     * `key`, e.g. the options of a multiple `<select>`.
+     */
+    std::vector<std::string>
+    get_all(std::string_view key) const;
+
+    /**
+     * @brief Check whether a pair has `key` as decoded key.
+     */
+    bool
+    has(std::string_view key) const noexcept;
+
+    /**
+     * @brief Retrieve the data the form is a view of.
+     */
+    std::string_view
+    data() const noexcept;
+
+    /**
+     * @brief Decode a form component: `+` stands for a space and `%XX` for
+     * the byte `0xXX`. Malformed escapes are kept as is.
+     */
+    static std::string
+    decode(std::string_view encoded);
+
+private:
+    std::string_view __data;
+};
+} // namespace hfs
+
+#endif // __HTTP_FORM_H__
@@ -0,0 +1,237 @@
+#include <http_fragments.h>
+#include <http_trace.h>
+
+namespace hfs
+{
+struct __fragment
+{
+    std::vector<std::string> keys;
+    std::shared_ptr<const inja::Template> tmpl;
+};
+
+/**
+ * @brief The fragments parsed by an environment and their outputs. Each
+ * environment, or registry, has its own, since the same name may resolve to
+ * another template in another directory.
+ */
+struct __memo
+{
+    std::mutex mutex;
+    std::unordered_map<std::string, __fragment> parsed;
+    std::unordered_map<std::string, std::string> rendered;
+
+    /**
+     * @brief The value of `__generation` when `rendered` was last emptied.
+     */
+    std::uint64_t generation = 0;
+};
+
+/**
+ * @brief The keys of the declared fragments, shared by every environment.
+ */
+static std::mutex __declared_mutex;
+static std::unordered_map<std::string, std::vector<std::string>> __declared;
+
+/**
+ * @brief Bumped by `http_fragments::clear`, so that every memo drops its
+ * outputs on its next use.
+ */
+static std::atomic<std::uint64_t> __generation{0};
+
+/**
+ * @brief Check whether a key is a variable name in the dotted notation, so
+ * that it can be spliced into an expression.
+ */
+static bool
+__valid_key(std::string_view key)
+{
+    if (key.empty() || key.front() == '.' || key.back() == '.' ||
+        std::isdigit((unsigned char)key.front()))
+        return false;
+
+    return std::all_of(
+        key.begin(), key.end(),
+        [](char c)
+        { return std::isalnum((unsigned char)c) || c == '_' || c == '.'; }
+    );
+}
+
+/**
+ * @brief Render a memoized fragment, or retrieve its output, from the values
+ * of its keys.
+ *
+ * @param args - The name of the fragment, then the value of each key.
+ */
+static inja::json
+__render(inja::Environment &env, __memo &memos, inja::Arguments &args)
+{
+    const std::string &name = args.at(0)->get_ref<const std::string &>();
+    std::string memo        = name;
+    __fragment fragment;
+
+    // The values are told apart by their serialization, which never holds a
+    // NUL character.
+    for (std::size_t i = 1; i < args.size(); i++)
+    {
+        memo += '\0';
+        memo += args[i]->dump();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(memos.mutex);
+        std::uint64_t generation = __generation.load(std::memory_order_acquire);
+
+        if (memos.generation != generation)
+        {
+            memos.rendered.clear();
+            memos.generation = generation;
+        }
+
+        auto it = memos.rendered.find(memo);
+
+        if (it != memos.rendered.end())
+            return it->second;
+
+        auto parsed = memos.parsed.find(name);
+
+        if (parsed == memos.parsed.end())
+        {
+            throw std::runtime_error(hfs::format_function_error(
+                __FILE__, __LINE__, "Unknown fragment: " + name
+            ));
+        }
+
+        fragment = parsed->second;
+    }
+
+    HFS_TRACE_SPAN("fragment", name);
+
+    // The fragment only sees its keys, so that an undeclared dependency is
+    // caught on its first render rather than frozen into the output.
+    inja::json data = inja::json::object();
+
+    for (std::size_t i = 0; i < fragment.keys.size() && i + 1 < args.size();
+         i++)
+    {
+        if (args[i + 1]->is_null())
+            continue;
+
+        std::string pointer = "/" + fragment.keys[i];
+        std::replace(pointer.begin(), pointer.end(), '.', '/');
+
+        data[inja::json::json_pointer(pointer)] = *args[i + 1];
+    }
+
+    std::string output = env.render(*fragment.tmpl, data);
+
+    std::lock_guard<std::mutex> lock(memos.mutex);
+
+    if (memos.rendered.size() >= http_fragments::CAPACITY)
+        memos.rendered.clear();
+
+    memos.rendered.emplace(std::move(memo), output);
+
+    return output;
+}
+
+void
+http_fragments::memoize(
+    const std::string &name, const std::vector<std::string> &keys
+)
+{
+    if (name.find('"') != std::string::npos)
+    {
+        throw std::invalid_argument(
+            "http_fragments::memoize: Invalid fragment name: " + name
+        );
+    }
+
+    for (const std::string &key : keys)
+    {
+        if (!__valid_key(key))
+        {
+            throw std::invalid_argument(
+                "http_fragments::memoize: Invalid key: " + key
+            );
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(__declared_mutex);
+    __declared[name] = keys;
+}
+
+void
+http_fragments::set_include_callback(inja::Environment &env, loader_t loader)
+{
+    auto memos = std::make_shared<__memo>();
+
+    env.add_callback(
+        "fragment",
+        [&env, memos](inja::Arguments &args)
+        { return __render(env, *memos, args); }
+    );
+
+    env.set_include_callback(
+        [&env, memos, loader = std::move(loader)](
+            const std::string &path, const std::string &name
+        ) -> inja::Template
+        {
+            std::string fragment = path + name;
+            std::optional<std::vector<std::string>> keys;
+
+            {
+                std::lock_guard<std::mutex> lock(__declared_mutex);
+                auto it = __declared.find(fragment);
+
+                if (it != __declared.end())
+                    keys = it->second;
+            }
+
+            // The loader parses the includes of the template, which come
+            // back here.
+            if (!keys.has_value())
+                return loader(path, name);
+
+            // A fragment that depends on nothing is rendered right away, and
+            // its output becomes a template of a single piece of text.
+            if (keys->empty())
+            {
+                inja::Template output(
+                    env.render(loader(path, name), inja::json::object())
+                );
+
+                output.root.nodes.push_back(std::make_shared<inja::TextNode>(
+                    0, output.content.size()
+                ));
+
+                return output;
+            }
+
+            auto tmpl = std::make_shared<const inja::Template>(
+                loader(path, name)
+            );
+
+            // A missing key is passed as `null` instead of failing the page
+            std::string lookup = "{{ fragment(\"" + fragment + "\"";
+
+            for (const std::string &key : *keys)
+                lookup += ", default(" + key + ", null)";
+
+            lookup += ") }}";
+
+            {
+                std::lock_guard<std::mutex> lock(memos->mutex);
+                memos->parsed[fragment] = {*keys, std::move(tmpl)};
+            }
+
+            return env.parse(lookup);
+        }
+    );
+}
+
+void
+http_fragments::clear() noexcept
+{
+    __generation.fetch_add(1, std::memory_order_acq_rel);
+}
+} // namespace hfs
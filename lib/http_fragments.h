@@ -0,0 +1,84 @@
+#ifndef __HTTP_FRAGMENTS_H__
+#define __HTTP_FRAGMENTS_H__ 1
+
+#include <http_core.h>
+
+namespace hfs
+{
+/**
+ * @brief Render-once memoization of the template fragments, such as the
+ * components included into every page.
+ *
+ * A memoized fragment declares the keys of the data its output depends on,
+ * if any. Its includes are resolved to a lookup of its output by the values
+ * of these keys: the fragment is only rendered, with these keys alone, the
+ * first time a combination of values is seen, and its output is spliced into
+ * the page as is afterwards. A fragment without keys is rendered once, when
+ * it is first included, and is then output like the static text of a page.
+ *
+ * Fragments must be declared before the first template that includes them
+ * is parsed, because includes are resolved once. The declarations are shared
+ * by every environment, while the parsed fragments and their outputs belong
+ * to the environment that included them.
+ *
+ * For example:
+ *
+ * @code
+ * ```cpp
+ * hfs::http_fragments::memoize("components/_navbar.html");
+ * hfs::http_fragments::memoize("components/_user.html", {"user.name"});
+ *
+ * hfs::http_fragments::set_include_callback(
+ *     hfs::http_response::env,
+ *     [](const std::string &path, const std::string &name)
+ *     { return hfs::http_response::env.parse(load(path + name)); }
+ * );
+ * ```
+ * @endcode
+ */
+class http_fragments
+{
+public:
+    using loader_t = std::function<inja::Template(
+        const std::string &path, const std::string &name
+    )>;
+
+    /**
+     * @brief The number of rendered outputs kept, beyond which they are all
+     * dropped and rendered again on demand.
+     */
+    static constexpr std::size_t CAPACITY = 4096;
+
+    /**
+     * @brief Declare a memoized fragment.
+     *
+     * @param name - The path of the fragment, as included, e.g.
+     * `components/_navbar.html`.
+     * @param keys - The names of the variables the output depends on, in the
+     * dotted notation of the templates, e.g. `user.name`.
+     * @throw `std::invalid_argument` - If a key is not a variable name.
+     */
+    static void
+    memoize(const std::string &name, const std::vector<std::string> &keys = {});
+
+    /**
+     * @brief Resolve the includes of an environment with a loader, and the
+     * memoized fragments with a lookup of their output.
+     *
+     * @param env - The environment, which must outlive the templates.
+     * @param loader - Parses the template of an include.
+     */
+    static void
+    set_include_callback(inja::Environment &env, loader_t loader);
+
+    /**
+     * @brief Drop the rendered outputs of the fragments with keys in every
+     * environment, e.g. after the data they depend on has changed behind the
+     * keys.
+     */
+    static void
+    clear() noexcept;
+};
+} // namespace hfs
+
+#endif // __HTTP_FRAGMENTS_H__
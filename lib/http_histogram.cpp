@@ -0,0 +1,123 @@
+#include <http_histogram.h>
+
+namespace hfs
+{
+static_assert(
+    http_histogram::BUCKETS ==
+        (std::bit_width(http_histogram::MAX_VALUE) - 3) *
+            http_histogram::SUB_BUCKETS,
+    "BUCKETS must cover MAX_VALUE"
+);
+
+http_histogram::http_histogram() noexcept
+{
+    this->reset();
+}
+
+std::size_t
+http_histogram::bucket(std::uint64_t value) noexcept
+{
+    value = std::min(value, MAX_VALUE);
+
+    // The shift keeps the 5 most significant bits of the value: the leading
+    // one selects the power of two and the next 4 select the sub-bucket.
+    std::size_t shift = std::max<std::size_t>(std::bit_width(value), 5) - 5;
+
+    return shift * SUB_BUCKETS + (value >> shift);
+}
+
+std::uint64_t
+http_histogram::lower_bound(std::size_t bucket) noexcept
+{
+    std::size_t shift =
+        bucket < 2 * SUB_BUCKETS ? 0 : bucket / SUB_BUCKETS - 1;
+
+    return (std::uint64_t)(bucket - shift * SUB_BUCKETS) << shift;
+}
+
+std::uint64_t
+http_histogram::upper_bound(std::size_t bucket) noexcept
+{
+    return bucket + 1 < BUCKETS ? lower_bound(bucket + 1) - 1 : MAX_VALUE;
+}
+
+void
+http_histogram::record(std::uint64_t value, std::uint64_t count) noexcept
+{
+    this->__buckets[bucket(value)] += count;
+    this->__count += count;
+    this->__sum += value * count;
+    this->__max = std::max(this->__max, value);
+}
+
+void
+http_histogram::merge(const http_histogram &other) noexcept
+{
+    for (std::size_t i = 0; i < BUCKETS; i++)
+        this->__buckets[i] += other.__buckets[i];
+
+    this->__count += other.__count;
+    this->__sum += other.__sum;
+    this->__max = std::max(this->__max, other.__max);
+}
+
+void
+http_histogram::reset() noexcept
+{
+    this->__buckets.fill(0);
+    this->__count = 0;
+    this->__sum   = 0;
+    this->__max   = 0;
+}
+
+std::uint64_t
+http_histogram::count() const noexcept
+{
+    return this->__count;
+}
+
+std::uint64_t
+http_histogram::sum() const noexcept
+{
+    return this->__sum;
+}
+
+std::uint64_t
+http_histogram::max() const noexcept
+{
+    return this->__max;
+}
+
+double
+http_histogram::mean() const noexcept
+{
+    return this->__count ? (double)this->__sum / this->__count : 0;
+}
+
+std::uint64_t
+http_histogram::percentile(double percent) const noexcept
+{
+    if (this->__count == 0)
+        return 0;
+
+    std::uint64_t rank = std::max<std::uint64_t>(
+        1, std::ceil(std::clamp(percent, 0.0, 100.0) / 100 * this->__count)
+    );
+
+    for (std::size_t i = 0, seen = 0; i < BUCKETS; i++)
+    {
+        seen += this->__buckets[i];
+
+        if (seen >= rank)
+            return std::min(upper_bound(i), this->__max);
+    }
+
+    return this->__max;
+}
+
+const std::array<std::uint64_t, http_histogram::BUCKETS> &
+http_histogram::buckets() const noexcept
+{
+    return this->__buckets;
+}
+} // namespace hfs
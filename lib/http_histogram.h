@@ -0,0 +1,106 @@
+#ifndef __HTTP_HISTOGRAM_H__
+#define __HTTP_HISTOGRAM_H__ 1
+
+#include <http_core.h>
+
+namespace hfs
+{
+/**
+ * @brief Log-linear histogram of durations, in the spirit of HdrHistogram.
+ *
+ * Values below 32 have a bucket each. Above, every power of two is split into
+ * 16 buckets of equal width, so that any value is known within 6.25% whatever
+ * its magnitude, with a fixed number of buckets. Values are meant to be
+ * microseconds and are clamped to 2^32 - 1, a bit more than an hour.
+ *
+ * For example:
+ *
+ * @code
+ * ```cpp
+ * hfs::http_histogram latency;
+ *
+ * latency.record(812);
+ * latency.record(15000);
+ *
+ * std::cout << "p99: " << latency.percentile(99) << "us" << std::endl;
+ * ```
+ * @endcode
+ */
+class http_histogram
+{
+public:
+    static constexpr std::size_t SUB_BUCKETS = 16;
+    static constexpr std::size_t BUCKETS     = 464;
+    static constexpr std::uint64_t MAX_VALUE = 0xffffffff;
+
+    http_histogram() noexcept;
+
+    /**
+     * @brief Retrieve the bucket of a value.
+     */
+    static std::size_t
+    bucket(std::uint64_t value) noexcept;
+
+    /**
+     * @brief Retrieve the smallest value of a bucket.
+     */
+    static std::uint64_t
+    lower_bound(std::size_t bucket) noexcept;
+
+    /**
+     * @brief Retrieve the largest value of a bucket.
+     */
+    static std::uint64_t
+    upper_bound(std::size_t bucket) noexcept;
+
+    /**
+     * @brief Record a value, `count` times.
+     */
+    void
+    record(std::uint64_t value, std::uint64_t count = 1) noexcept;
+
+    /**
+     * @brief Add the values recorded by another histogram.
+     */
+    void
+    merge(const http_histogram &other) noexcept;
+
+    void
+    reset() noexcept;
+
+    std::uint64_t
+    count() const noexcept;
+
+    std::uint64_t
+    sum() const noexcept;
+
+    std::uint64_t
+    max() const noexcept;
+
+    double
+    mean() const noexcept;
+
+    /**
+     * @brief Retrieve the value below which a percentage of the recorded
+     * values fall, as the largest value of its bucket.
+     *
+     * @param percent - From 0 to 100.
+     * @return `std::uint64_t` - The value, or 0 if nothing is recorded.
+     */
+    std::uint64_t
+    percentile(double percent) const noexcept;
+
+    const std::array<std::uint64_t, BUCKETS> &
+    buckets() const noexcept;
+
+private:
+    friend class http_metrics;
+
+    std::array<std::uint64_t, BUCKETS> __buckets;
+    std::uint64_t __count;
+    std::uint64_t __sum;
+    std::uint64_t __max;
+};
+} // namespace hfs
+
+#endif // __HTTP_HISTOGRAM_H__
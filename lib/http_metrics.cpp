@@ -0,0 +1,398 @@
+#include <http_cache.h>
+#include <http_metrics.h>
+
+namespace hfs
+{
+/**
+ * @brief The counters of one route and one status class in a shard. They are
+ * only written by the thread that owns the shard, so a relaxed load and store
+ * is enough to increment them, and readers still see whole values.
+ */
+struct http_metrics::series
+{
+    std::atomic<std::uint64_t> requests{0};
+    std::atomic<std::uint64_t> bytes_in{0};
+    std::atomic<std::uint64_t> bytes_out{0};
+    std::atomic<std::uint64_t> latency_sum{0};
+    std::atomic<std::uint64_t> latency_max{0};
+    std::array<std::atomic<std::uint64_t>, http_histogram::BUCKETS> latency{};
+};
+
+/**
+ * @brief The series of one thread. The owner looks routes up without the
+ * lock and only takes it to add a route, while readers hold it throughout.
+ */
+struct http_metrics::shard
+{
+    std::array<std::atomic<std::uint64_t>, COUNTERS> counters{};
+
+    std::mutex mutex;
+    std::unordered_map<
+        std::string, std::unique_ptr<std::array<series, STATUS_CLASSES>>,
+        hfs::string_hash, std::equal_to<>>
+        routes;
+};
+
+/**
+ * @brief Identifies each instance, so that the shard cached by a thread is
+ * never mistaken for the shard of another instance.
+ */
+static std::atomic<std::uint64_t> __next_id{1};
+
+static inline void
+__add(std::atomic<std::uint64_t> &counter, std::uint64_t value) noexcept
+{
+    counter.store(
+        counter.load(std::memory_order_relaxed) + value,
+        std::memory_order_relaxed
+    );
+}
+
+http_metrics::http_metrics() : __id(__next_id++)
+{
+}
+
+http_metrics::~http_metrics()
+{
+}
+
+http_metrics::shard *
+http_metrics::__shard()
+{
+    thread_local struct
+    {
+        std::uint64_t owner = 0;
+        shard *owned        = nullptr;
+    } cache;
+
+    if (cache.owner == this->__id)
+        return cache.owned;
+
+    auto owned = std::make_unique<shard>();
+    std::lock_guard<std::mutex> lock(this->__shards_mutex);
+
+    cache.owner = this->__id;
+    cache.owned = owned.get();
+    this->__shards.push_back(std::move(owned));
+
+    return cache.owned;
+}
+
+void
+http_metrics::record(
+    std::string_view route, hfs::http_status_code_t status,
+    std::size_t bytes_in, std::size_t bytes_out,
+    std::chrono::microseconds latency
+) noexcept
+{
+    try
+    {
+        shard *owned = this->__shard();
+        auto it      = owned->routes.find(route);
+
+        if (it == owned->routes.end())
+        {
+            auto classes =
+                std::make_unique<std::array<series, STATUS_CLASSES>>();
+            std::lock_guard<std::mutex> lock(owned->mutex);
+
+            it = owned->routes.emplace(route, std::move(classes)).first;
+        }
+
+        std::size_t status_class =
+            std::clamp<std::size_t>(status / 100, 1, STATUS_CLASSES);
+        series &s = (*it->second)[status_class - 1];
+
+        std::uint64_t value = std::clamp<std::int64_t>(
+            latency.count(), 0, http_histogram::MAX_VALUE
+        );
+
+        __add(s.requests, 1);
+        __add(s.bytes_in, bytes_in);
+        __add(s.bytes_out, bytes_out);
+        __add(s.latency_sum, value);
+        __add(s.latency[http_histogram::bucket(value)], 1);
+
+        if (value > s.latency_max.load(std::memory_order_relaxed))
+            s.latency_max.store(value, std::memory_order_relaxed);
+    }
+    catch (const std::bad_alloc &e)
+    {
+    }
+}
+
+void
+http_metrics::count(counter which, std::uint64_t value) noexcept
+{
+    try
+    {
+        __add(this->__shard()->counters[(std::size_t)which], value);
+    }
+    catch (const std::bad_alloc &e)
+    {
+    }
+}
+
+std::uint64_t
+http_metrics::total(counter which) const
+{
+    std::lock_guard<std::mutex> lock(this->__shards_mutex);
+    std::uint64_t sum = 0;
+
+    for (const auto &shard : this->__shards)
+    {
+        sum +=
+            shard->counters[(std::size_t)which].load(std::memory_order_relaxed);
+    }
+
+    return sum;
+}
+
+void
+http_metrics::watch(
+    std::string_view route, std::string_view method,
+    std::shared_ptr<const hfs::http_cache> cache
+)
+{
+    std::lock_guard<std::mutex> lock(this->__caches_mutex);
+    this->__caches.push_back(
+        {std::string(route), std::string(method), std::move(cache)}
+    );
+}
+
+std::vector<http_metrics::stats>
+http_metrics::snapshot() const
+{
+    std::map<std::pair<std::string_view, std::size_t>, stats> merged;
+    std::lock_guard<std::mutex> lock(this->__shards_mutex);
+
+    for (const auto &shard : this->__shards)
+    {
+        std::lock_guard<std::mutex> shard_lock(shard->mutex);
+
+        for (const auto &[route, classes] : shard->routes)
+        {
+            for (std::size_t i = 0; i < STATUS_CLASSES; i++)
+            {
+                const series &s = (*classes)[i];
+                std::uint64_t requests =
+                    s.requests.load(std::memory_order_relaxed);
+
+                if (requests == 0)
+                    continue;
+
+                auto [it, inserted] = merged.try_emplace({route, i + 1});
+                stats &out          = it->second;
+
+                if (inserted)
+                {
+                    out.route        = route;
+                    out.status_class = i + 1;
+                    out.requests = out.bytes_in = out.bytes_out = 0;
+                }
+
+                out.requests += requests;
+                out.bytes_in += s.bytes_in.load(std::memory_order_relaxed);
+                out.bytes_out += s.bytes_out.load(std::memory_order_relaxed);
+
+                // The counts of the buckets may be a few requests ahead of
+                // `requests`, which is harmless for a monitoring view.
+                http_histogram &latency = out.latency;
+
+                for (std::size_t b = 0; b < http_histogram::BUCKETS; b++)
+                {
+                    std::uint64_t count =
+                        s.latency[b].load(std::memory_order_relaxed);
+
+                    latency.__buckets[b] += count;
+                    latency.__count += count;
+                }
+
+                latency.__sum +=
+                    s.latency_sum.load(std::memory_order_relaxed);
+                latency.__max = std::max(
+                    latency.__max,
+                    s.latency_max.load(std::memory_order_relaxed)
+                );
+            }
+        }
+    }
+
+    std::vector<stats> result;
+    result.reserve(merged.size());
+
+    for (auto &[key, stats] : merged)
+        result.push_back(std::move(stats));
+
+    return result;
+}
+
+/**
+ * @brief Escape a label value: backslashes, double quotes and line feeds.
+ */
+static std::string
+__label(std::string_view value)
+{
+    std::string escaped;
+
+    for (char c : value)
+    {
+        if (c == '\\' || c == '"')
+            escaped.push_back('\\');
+
+        if (c == '\n')
+            escaped.append("\\n");
+        else
+            escaped.push_back(c);
+    }
+
+    return escaped;
+}
+
+static void
+__family(
+    std::ostringstream &out, std::string_view name, std::string_view type,
+    std::string_view help
+)
+{
+    out << "# HELP " << name << " " << help << "\n"
+        << "# TYPE " << name << " " << type << "\n";
+}
+
+std::string
+http_metrics::prometheus() const
+{
+    // Upper bounds of the exported buckets, in microseconds
+    static constexpr std::array<std::uint64_t, 14> bounds = {
+        500,    1000,   2500,    5000,    10000,   25000,   50000,
+        100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000,
+    };
+
+    std::ostringstream out;
+    out.precision(15);
+
+    std::uint64_t accepted = this->total(counter::CONNECTIONS_ACCEPTED);
+    std::uint64_t closed   = this->total(counter::CONNECTIONS_CLOSED);
+
+    __family(
+        out, "hfs_connections_accepted_total", "counter",
+        "Connections accepted."
+    );
+    out << "hfs_connections_accepted_total " << accepted << "\n";
+
+    __family(
+        out, "hfs_connections_active", "gauge",
+        "Connections accepted and not closed yet."
+    );
+    out << "hfs_connections_active " << accepted - std::min(accepted, closed)
+        << "\n";
+
+    __family(
+        out, "hfs_parse_errors_total", "counter",
+        "Requests rejected because their head could not be parsed."
+    );
+    out << "hfs_parse_errors_total " << this->total(counter::PARSE_ERRORS)
+        << "\n";
+
+    std::vector<stats> snapshot = this->snapshot();
+    std::vector<std::string> labels;
+
+    for (const auto &stats : snapshot)
+    {
+        labels.push_back(
+            "route=\"" + __label(stats.route) + "\",status=\"" +
+            std::to_string(stats.status_class) + "xx\""
+        );
+    }
+
+    __family(
+        out, "hfs_requests_total", "counter",
+        "Requests answered, by route and status class."
+    );
+    for (std::size_t i = 0; i < snapshot.size(); i++)
+    {
+        out << "hfs_requests_total{" << labels[i] << "} "
+            << snapshot[i].requests << "\n";
+    }
+
+    __family(
+        out, "hfs_received_bytes_total", "counter",
+        "Bytes received, head and decoded body."
+    );
+    for (std::size_t i = 0; i < snapshot.size(); i++)
+    {
+        out << "hfs_received_bytes_total{" << labels[i] << "} "
+            << snapshot[i].bytes_in << "\n";
+    }
+
+    __family(
+        out, "hfs_sent_bytes_total", "counter", "Bytes sent, head and body."
+    );
+    for (std::size_t i = 0; i < snapshot.size(); i++)
+    {
+        out << "hfs_sent_bytes_total{" << labels[i] << "} "
+            << snapshot[i].bytes_out << "\n";
+    }
+
+    __family(
+        out, "hfs_request_duration_seconds", "histogram",
+        "Time from accept to the last byte sent."
+    );
+    for (std::size_t i = 0; i < snapshot.size(); i++)
+    {
+        const http_histogram &latency = snapshot[i].latency;
+        const auto &buckets           = latency.buckets();
+        std::uint64_t cumulative      = 0;
+        std::size_t bucket            = 0;
+
+        // A bucket of the histogram is counted under the first bound that is
+        // not below its largest value.
+        for (std::uint64_t bound : bounds)
+        {
+            for (; bucket < http_histogram::BUCKETS &&
+                   http_histogram::upper_bound(bucket) <= bound;
+                 bucket++)
+            {
+                cumulative += buckets[bucket];
+            }
+
+            out << "hfs_request_duration_seconds_bucket{" << labels[i]
+                << ",le=\"" << bound / 1e6 << "\"} " << cumulative << "\n";
+        }
+
+        out << "hfs_request_duration_seconds_bucket{" << labels[i]
+            << ",le=\"+Inf\"} " << latency.count() << "\n"
+            << "hfs_request_duration_seconds_sum{" << labels[i] << "} "
+            << latency.sum() / 1e6 << "\n"
+            << "hfs_request_duration_seconds_count{" << labels[i] << "} "
+            << latency.count() << "\n";
+    }
+
+    std::lock_guard<std::mutex> lock(this->__caches_mutex);
+
+    __family(
+        out, "hfs_cache_hits_total", "counter",
+        "Requests answered from the micro-cache, by route and method."
+    );
+    for (const auto &watched : this->__caches)
+    {
+        out << "hfs_cache_hits_total{route=\"" << __label(watched.route)
+            << "\",method=\"" << __label(watched.method) << "\"} "
+            << watched.cache->hits() << "\n";
+    }
+
+    __family(
+        out, "hfs_cache_misses_total", "counter",
+        "Requests that ran the handler of a cached route, by route and "
+        "method."
+    );
+    for (const auto &watched : this->__caches)
+    {
+        out << "hfs_cache_misses_total{route=\"" << __label(watched.route)
+            << "\",method=\"" << __label(watched.method) << "\"} "
+            << watched.cache->misses() << "\n";
+    }
+
+    return out.str();
+}
+} // namespace hfs
@@ -0,0 +1,178 @@
+#ifndef __HTTP_METRICS_H__
+#define __HTTP_METRICS_H__ 1
+
+#include <http_core.h>
+#include <http_histogram.h>
+
+namespace hfs
+{
+class http_cache;
+
+/**
+ * @brief Request counters and latency histograms, per route pattern and per
+ * status class.
+ *
+ * Every thread records into a shard of its own, so recording a request is a
+ * handful of relaxed stores that never contend with other threads. Readers
+ * merge the shards on demand, which is the only time a lock is taken, and
+ * only contends with a thread that records a route for the first time.
+ *
+ * For example:
+ *
+ * @code
+ * ```cpp
+ * server->enable_metrics();
+ *
+ * for (const auto &stats : server->metrics()->snapshot())
+ * {
+ *     std::cout << stats.route << " " << stats.status_class << "xx: p99 "
+ *               << stats.latency.percentile(99) << "us" << std::endl;
+ * }
+ * ```
+ * @endcode
+ */
+class http_metrics
+{
+public:
+    static constexpr std::size_t STATUS_CLASSES = 5;
+
+    /**
+     * @brief The route of requests served from the static directory.
+     */
+    static constexpr std::string_view ROUTE_STATIC = "(static)";
+
+    /**
+     * @brief The route of requests rejected before routing, e.g. because
+     * they could not be parsed.
+     */
+    static constexpr std::string_view ROUTE_NONE = "(none)";
+
+    /**
+     * @brief Server-wide counters, outside of any route.
+     */
+    enum class counter : std::size_t
+    {
+        CONNECTIONS_ACCEPTED,
+        CONNECTIONS_CLOSED,
+        PARSE_ERRORS,
+    };
+
+    static constexpr std::size_t COUNTERS = 3;
+
+    /**
+     * @brief The merged figures of one route and one status class.
+     */
+    struct stats
+    {
+        std::string route;
+
+        /**
+         * @brief From 1 (`1xx`) to 5 (`5xx`).
+         */
+        unsigned status_class;
+
+        std::uint64_t requests;
+        std::uint64_t bytes_in;
+        std::uint64_t bytes_out;
+
+        /**
+         * @brief The time from accept to the last byte sent, in
+         * microseconds.
+         */
+        hfs::http_histogram latency;
+    };
+
+    http_metrics();
+    ~http_metrics();
+
+    http_metrics(const http_metrics &) = delete;
+
+    http_metrics &
+    operator=(const http_metrics &) = delete;
+
+    /**
+     * @brief Record a request from the calling thread. This never blocks, and
+     * only allocates the first time a thread records a route.
+     *
+     * @param route - The pattern of the route, e.g. `/blogs/:slug`.
+     * @param status - The status of the response.
+     * @param bytes_in - The number of bytes received from the client.
+     * @param bytes_out - The number of bytes sent to the client.
+     * @param latency - The time spent on the request.
+     */
+    void
+    record(
+        std::string_view route, hfs::http_status_code_t status,
+        std::size_t bytes_in, std::size_t bytes_out,
+        std::chrono::microseconds latency
+    ) noexcept;
+
+    /**
+     * @brief Increment a server-wide counter from the calling thread.
+     */
+    void
+    count(counter which, std::uint64_t value = 1) noexcept;
+
+    /**
+     * @brief Retrieve the value of a server-wide counter, summed over all
+     * threads.
+     */
+    std::uint64_t
+    total(counter which) const;
+
+    /**
+     * @brief Report the hits and the misses of the micro-cache of a route.
+     *
+     * @param route - The pattern of the route.
+     * @param method - The method of the route.
+     * @param cache - The cache, whose counters are read on every render.
+     */
+    void
+    watch(
+        std::string_view route, std::string_view method,
+        std::shared_ptr<const hfs::http_cache> cache
+    );
+
+    /**
+     * @brief Merge the shards of all threads.
+     *
+     * @return `std::vector<stats>` - The figures of every route and status
+     * class with at least one request, sorted by route then status class.
+     */
+    std::vector<stats>
+    snapshot() const;
+
+    /**
+     * @brief Render every metric in the Prometheus text exposition format.
+     *
+     * Latency histograms are reduced to a fixed set of buckets, from 500us
+     * to 10s, so that their series are the same for every route.
+     */
+    std::string
+    prometheus() const;
+
+private:
+    struct series;
+    struct shard;
+
+    std::uint64_t __id;
+
+    mutable std::mutex __shards_mutex;
+    std::vector<std::unique_ptr<shard>> __shards;
+
+    struct __watched_cache
+    {
+        std::string route;
+        std::string method;
+        std::shared_ptr<const hfs::http_cache> cache;
+    };
+
+    mutable std::mutex __caches_mutex;
+    std::vector<__watched_cache> __caches;
+
+    shard *
+    __shard();
+};
+} // namespace hfs
+
+#endif // __HTTP_METRICS_H__
@@ -0,0 +1,418 @@
+#include <http_multipart.h>
+
+namespace hfs
+{
+/**
+ * @brief RFC 2046 Section 5.1.1 limits boundaries to 70 characters.
+ */
+static constexpr std::size_t __max_boundary = 70;
+
+/**
+ * @brief Remove the quotes and the escapes of a `quoted-string`, or return
+ * the token as is.
+ */
+static std::string
+__unquote(std::string_view value)
+{
+    if (value.size() < 2 || value.front() != '"' || value.back() != '"')
+        return std::string(value);
+
+    std::string unquoted;
+    value = value.substr(1, value.size() - 2);
+
+    for (std::size_t i = 0; i < value.size(); i++)
+    {
+        if (value[i] == '\\' && i + 1 < value.size())
+            i++;
+
+        unquoted.push_back(value[i]);
+    }
+
+    return unquoted;
+}
+
+/**
+ * @brief Find a parameter of a header value such as
+ * `form-data; name="file"; filename="a.txt"`. The separators are searched
+ * outside of quoted strings, so that a filename may contain a semicolon.
+ */
+static std::optional<std::string>
+__find_param(std::string_view value, std::string_view name)
+{
+    std::size_t start = value.find(';');
+
+    while (start != std::string_view::npos)
+    {
+        std::size_t end = start + 1;
+        bool quoted     = false;
+
+        for (; end < value.size(); end++)
+        {
+            if (value[end] == '\\' && quoted)
+                end++;
+            else if (value[end] == '"')
+                quoted = !quoted;
+            else if (value[end] == ';' && !quoted)
+                break;
+        }
+
+        std::string_view param =
+            hfs::trim(value.substr(start + 1, end - start - 1));
+        std::size_t equal = param.find('=');
+
+        if (equal != std::string_view::npos &&
+            hfs::iequals(hfs::trim(param.substr(0, equal)), name))
+        {
+            return __unquote(hfs::trim(param.substr(equal + 1)));
+        }
+
+        start = end < value.size() ? end : std::string_view::npos;
+    }
+
+    return std::nullopt;
+}
+
+http_multipart::http_multipart(
+    http_body_reader &reader, std::string_view boundary
+)
+    : __reader(reader), __delimiter("\r\n--" + std::string(boundary)),
+      __searcher(this->__delimiter.begin(), this->__delimiter.end()),
+      __state(state::PREAMBLE), __buf("\r\n"), __pos(0),
+      __match(std::string::npos)
+{
+    // The buffer starts with a CRLF so that the first delimiter, which is
+    // not preceded by one when there is no preamble, is found like the
+    // others.
+    if (boundary.empty() || boundary.size() > __max_boundary)
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__,
+            "Invalid multipart boundary: " + std::string(boundary)
+        ));
+    }
+}
+
+http_multipart::~http_multipart()
+{
+}
+
+std::optional<std::string>
+http_multipart::boundary(std::string_view content_type)
+{
+    std::string_view mime =
+        hfs::trim(content_type.substr(0, content_type.find(';')));
+
+    if (!hfs::iequals(mime, "multipart/form-data"))
+        return std::nullopt;
+
+    std::optional<std::string> boundary =
+        __find_param(content_type, "boundary");
+
+    if (!boundary.has_value() || boundary->empty() ||
+        boundary->size() > __max_boundary)
+    {
+        return std::nullopt;
+    }
+
+    return boundary;
+}
+
+/**
+ * @brief Drop the consumed part of the buffer and append the next bytes of
+ * the body.
+ */
+void
+http_multipart::__fill()
+{
+    if (this->__pos > 0)
+    {
+        this->__buf.erase(0, this->__pos);
+
+        if (this->__match != std::string::npos)
+            this->__match -= this->__pos;
+
+        this->__pos = 0;
+    }
+
+    std::size_t offset = this->__buf.size();
+    this->__buf.resize(offset + hfs::HTTP_BUFSZ);
+
+    std::size_t n = this->__reader.read(
+        this->__buf.data() + offset, hfs::HTTP_BUFSZ
+    );
+
+    this->__buf.resize(offset + n);
+
+    if (n == 0)
+    {
+        this->__state = state::DONE;
+
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__, "Multipart body ends without closing delimiter"
+        ));
+    }
+}
+
+/**
+ * @brief Copy the content of the current part up to the next delimiter. The
+ * bytes that could be the beginning of a delimiter split across two reads
+ * are kept in the buffer until more of the body is known.
+ */
+std::size_t
+http_multipart::__read_content(char *buf, std::size_t size)
+{
+    for (;;)
+    {
+        if (this->__match == std::string::npos)
+        {
+            auto it = std::search(
+                this->__buf.cbegin() + this->__pos, this->__buf.cend(),
+                this->__searcher
+            );
+
+            if (it != this->__buf.cend())
+                this->__match = it - this->__buf.cbegin();
+        }
+
+        std::size_t available;
+
+        if (this->__match != std::string::npos)
+        {
+            available = this->__match - this->__pos;
+
+            if (available == 0)
+            {
+                this->__pos   = this->__match + this->__delimiter.size();
+                this->__match = std::string::npos;
+                this->__state = state::DELIMITER;
+
+                return 0;
+            }
+        }
+        else
+        {
+            std::size_t pending = this->__buf.size() - this->__pos;
+            std::size_t keep    = this->__delimiter.size() - 1;
+
+            available = pending > keep ? pending - keep : 0;
+        }
+
+        if (available > 0)
+        {
+            std::size_t n = std::min(available, size);
+
+            std::memcpy(buf, this->__buf.data() + this->__pos, n);
+            this->__pos += n;
+
+            return n;
+        }
+
+        this->__fill();
+    }
+}
+
+std::string_view
+http_multipart::__read_line()
+{
+    std::size_t eol;
+
+    while ((eol = this->__buf.find("\r\n", this->__pos)) == std::string::npos)
+    {
+        if (this->__buf.size() - this->__pos >= hfs::HTTP_HDRSZ)
+        {
+            this->__state = state::DONE;
+
+            throw std::runtime_error(hfs::format_function_error(
+                __FILE__, __LINE__, "Multipart header line is too long"
+            ));
+        }
+
+        this->__fill();
+    }
+
+    std::string_view line(this->__buf.data() + this->__pos, eol - this->__pos);
+    this->__pos = eol + 2;
+
+    return line;
+}
+
+/**
+ * @brief Tell the closing delimiter, followed by `--`, from the delimiter of
+ * another part. Transport padding is allowed before the CRLF.
+ */
+bool
+http_multipart::__after_delimiter()
+{
+    while (this->__buf.size() - this->__pos < 2)
+        this->__fill();
+
+    if (this->__buf.compare(this->__pos, 2, "--") == 0)
+    {
+        // The epilogue is ignored
+        this->__state = state::DONE;
+        return false;
+    }
+
+    if (!hfs::trim(this->__read_line()).empty())
+    {
+        this->__state = state::DONE;
+
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__, "Invalid multipart delimiter line"
+        ));
+    }
+
+    return true;
+}
+
+void
+http_multipart::__read_headers(part &p)
+{
+    std::size_t total = 0;
+
+    p.content_type = "text/plain";
+
+    for (;;)
+    {
+        std::string_view line = this->__read_line();
+
+        if (line.empty())
+            break;
+
+        total += line.size();
+
+        std::size_t colon = line.find(':');
+
+        if (total > hfs::HTTP_HDRSZ || colon == std::string_view::npos)
+        {
+            this->__state = state::DONE;
+
+            throw std::runtime_error(hfs::format_function_error(
+                __FILE__, __LINE__,
+                "Invalid multipart header: " + std::string(line)
+            ));
+        }
+
+        std::string_view name  = hfs::trim(line.substr(0, colon));
+        std::string_view value = hfs::trim(line.substr(colon + 1));
+
+        if (hfs::iequals(name, "Content-Disposition"))
+        {
+            p.name     = __find_param(value, "name").value_or("");
+            p.filename = __find_param(value, "filename").value_or("");
+        }
+        else if (hfs::iequals(name, "Content-Type"))
+        {
+            p.content_type = value;
+        }
+
+        p.headers[std::string(name)] = value;
+    }
+}
+
+bool
+http_multipart::next(part &p)
+{
+    if (this->__state == state::PREAMBLE || this->__state == state::CONTENT)
+    {
+        char scratch[hfs::HTTP_BUFSZ];
+
+        while (this->__read_content(scratch, sizeof(scratch)) > 0)
+            ;
+    }
+
+    if (this->__state != state::DELIMITER || !this->__after_delimiter())
+        return false;
+
+    p = part();
+    this->__read_headers(p);
+    this->__state = state::CONTENT;
+
+    return true;
+}
+
+std::size_t
+http_multipart::read(char *buf, std::size_t size)
+{
+    if (this->__state != state::CONTENT || size == 0)
+        return 0;
+
+    return this->__read_content(buf, size);
+}
+
+std::string
+http_multipart::read_all(std::size_t limit)
+{
+    std::string content;
+    char buf[hfs::HTTP_BUFSZ];
+    std::size_t n;
+
+    while ((n = this->read(buf, sizeof(buf))) > 0)
+    {
+        if (content.size() + n > limit)
+        {
+            throw std::runtime_error(hfs::format_function_error(
+                __FILE__, __LINE__,
+                "Multipart part exceeds the size limit (" +
+                    std::to_string(limit) + ")"
+            ));
+        }
+
+        content.append(buf, n);
+    }
+
+    return content;
+}
+
+std::filesystem::path
+http_multipart::spill(const std::filesystem::path &dir)
+{
+    std::string path = (dir / "hfs-upload-XXXXXX").string();
+    int fd           = mkstemp(path.data());
+
+    if (fd == -1)
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__,
+            "mkstemp: " + std::string(std::strerror(errno))
+        ));
+    }
+
+    char buf[hfs::HTTP_BUFSZ];
+    std::size_t n;
+
+    try
+    {
+        while ((n = this->read(buf, sizeof(buf))) > 0)
+        {
+            for (std::size_t written = 0; written < n;)
+            {
+                ssize_t ret = write(fd, buf + written, n - written);
+
+                if (ret == -1 && errno == EINTR)
+                    continue;
+
+                if (ret == -1)
+                {
+                    throw std::runtime_error(hfs::format_function_error(
+                        __FILE__, __LINE__,
+                        "write: " + std::string(std::strerror(errno))
+                    ));
+                }
+
+                written += ret;
+            }
+        }
+    }
+    catch (const std::runtime_error &e)
+    {
+        close(fd);
+        unlink(path.c_str());
+        throw;
+    }
+
+    close(fd);
+
+    return path;
+}
+} // namespace hfs
@@ -0,0 +1,171 @@
+#ifndef __HTTP_MULTIPART_H__
+#define __HTTP_MULTIPART_H__ 1
+
+#include <http_body_reader.h>
+#include <http_core.h>
+
+namespace hfs
+{
+/**
+ * @brief Incremental parser of `multipart/form-data` bodies, as defined in
+ * RFC 7578 and RFC 2046 Section 5.1.
+ *
+ * The parser pulls the body from a body reader and hands out one part at a
+ * time. The content of a part is streamed to the caller, or straight to a
+ * file, so that uploads of any size are parsed with a buffer of a few
+ * kilobytes.
+ *
+ * For example:
+ *
+ * @code
+ * ```cpp
+ * auto boundary = hfs::http_multipart::boundary(req.header("Content-Type"));
+ * hfs::http_multipart multipart(req.body_reader(), *boundary);
+ * hfs::http_multipart::part part;
+ *
+ * while (multipart.next(part))
+ * {
+ *     if (part.filename.empty())
+ *         fields[part.name] = multipart.read_all();
+ *     else
+ *         files[part.name] = multipart.spill();
+ * }
+ * ```
+ * @endcode
+ */
+class http_multipart
+{
+public:
+    /**
+     * @brief The header section of a part.
+     */
+    struct part
+    {
+        /**
+         * @brief The `name` parameter of `Content-Disposition`.
+         */
+        std::string name;
+
+        /**
+         * @brief The `filename` parameter of `Content-Disposition`, empty if
+         * the part is not a file.
+         */
+        std::string filename;
+
+        /**
+         * @brief The `Content-Type` of the part, `text/plain` by default.
+         */
+        std::string content_type;
+
+        std::unordered_map<std::string, std::string> headers;
+    };
+
+    /**
+     * @brief Construct a new parser.
+     *
+     * @param reader - The reader of the request body.
+     * @param boundary - The `boundary` parameter of the `Content-Type`.
+     * @throw `std::runtime_error` - If the boundary is empty or longer than
+     * 70 characters.
+     */
+    http_multipart(http_body_reader &reader, std::string_view boundary);
+
+    ~http_multipart();
+
+    http_multipart(const http_multipart &) = delete;
+
+    http_multipart &
+    operator=(const http_multipart &) = delete;
+
+    /**
+     * @brief Extract the `boundary` parameter of a `multipart/form-data`
+     * content type.
+     *
+     * @param content_type - The value of the `Content-Type` header.
+     * @return `std::nullopt` if the media type is not `multipart/form-data`
+     * or has no boundary.
+     */
+    static std::optional<std::string>
+    boundary(std::string_view content_type);
+
+    /**
+     * @brief Move to the next part, skipping what is left of the current one.
+     *
+     * @param p - The header section of the next part.
+     * @return `false` once the closing delimiter has been reached.
+     * @throw `std::runtime_error` - If the body is malformed or cannot be
+     * read.
+     */
+    bool
+    next(part &p);
+
+    /**
+     * @brief Read the next bytes of the content of the current part.
+     *
+     * @return `std::size_t` - The number of bytes written to `buf`, 0 at the
+     * end of the part.
+     * @throw `std::runtime_error` - If the body is malformed or cannot be
+     * read.
+     */
+    std::size_t
+    read(char *buf, std::size_t size);
+
+    /**
+     * @brief Read the rest of the content of the current part in memory.
+     *
+     * @param limit - The maximum length of the content.
+     * @throw `std::runtime_error` - If the content is longer than `limit`, or
+     * on the same conditions as `read`.
+     */
+    std::string
+    read_all(std::size_t limit = hfs::HTTP_BUFSZ);
+
+    /**
+     * @brief Write the rest of the content of the current part to a new
+     * temporary file. The caller owns the file and must remove it.
+     *
+     * @param dir - The directory of the temporary file.
+     * @return `std::filesystem::path` - The path of the temporary file.
+     * @throw `std::runtime_error` - If the file cannot be written, or on the
+     * same conditions as `read`.
+     */
+    std::filesystem::path
+    spill(const std::filesystem::path &dir =
+              std::filesystem::temp_directory_path());
+
+private:
+    enum class state
+    {
+        PREAMBLE,
+        CONTENT,
+        DELIMITER,
+        DONE,
+    };
+
+    http_body_reader &__reader;
+    std::string __delimiter;
+    std::boyer_moore_horspool_searcher<std::string::const_iterator> __searcher;
+    state __state;
+
+    std::string __buf;
+    std::size_t __pos;
+    std::size_t __match;
+
+    std::size_t
+    __read_content(char *buf, std::size_t size);
+
+    void
+    __fill();
+
+    std::string_view
+    __read_line();
+
+    void
+    __read_headers(part &p);
+
+    bool
+    __after_delimiter();
+};
+} // namespace hfs
+
+#endif // __HTTP_MULTIPART_H__
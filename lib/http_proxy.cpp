@@ -0,0 +1,588 @@
+#include <http_proxy.h>
+
+namespace hfs
+{
+/**
+ * @brief The number of points each upstream has on the consistent hash ring.
+ * More points spread the keys more evenly.
+ */
+static constexpr std::size_t __RING_POINTS = 160;
+
+/**
+ * @brief Count a request in flight to an upstream for as long as it lives.
+ */
+class __in_flight
+{
+public:
+    explicit __in_flight(std::atomic<std::size_t> &active) : __active(active)
+    {
+        this->__active++;
+    }
+
+    ~__in_flight()
+    {
+        this->__active--;
+    }
+
+private:
+    std::atomic<std::size_t> &__active;
+};
+
+/**
+ * @brief Check whether a request has a body to relay. Every request gets a
+ * body reader, which is empty without `Content-Length` or chunks.
+ */
+static bool
+__has_body(const hfs::http_request &req)
+{
+    return req.has_body_reader() && req.body_reader().length() != 0;
+}
+
+/**
+ * @brief Check whether a header field only concerns one connection, as
+ * listed in RFC 9110 Section 7.6.1 or named by the `Connection` header, so
+ * that it must not be forwarded.
+ */
+static bool
+__hop_by_hop(std::string_view name, std::string_view connection)
+{
+    static constexpr std::array<std::string_view, 9> fields = {
+        "Connection", "Keep-Alive", "Proxy-Authenticate",
+        "Proxy-Authorization", "Proxy-Connection", "TE", "Trailer",
+        "Transfer-Encoding", "Upgrade",
+    };
+
+    for (std::string_view field : fields)
+    {
+        if (hfs::iequals(name, field))
+            return true;
+    }
+
+    std::string_view token;
+
+    while (!connection.empty())
+    {
+        std::size_t comma = connection.find(',');
+
+        token      = hfs::trim(connection.substr(0, comma));
+        connection = comma == std::string_view::npos
+                         ? std::string_view()
+                         : connection.substr(comma + 1);
+
+        if (hfs::iequals(name, token))
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Restore the usual case of a header name received in lowercase, e.g.
+ * `content-type` to `Content-Type`, since the response headers are looked up
+ * by their exact name.
+ */
+static std::string
+__canonical(std::string_view name)
+{
+    if (name == "etag")
+        return "ETag";
+
+    if (name == "www-authenticate")
+        return "WWW-Authenticate";
+
+    std::string canonical(name);
+    bool upper = true;
+
+    for (char &c : canonical)
+    {
+        c     = upper ? std::toupper(c) : c;
+        upper = c == '-';
+    }
+
+    return canonical;
+}
+
+http_proxy::http_proxy(const options &opts) : __opts(opts), __next(0)
+{
+    if (opts.upstreams.empty())
+        throw std::invalid_argument("http_proxy: No upstream");
+
+    for (std::size_t i = 0; i < opts.upstreams.size(); i++)
+    {
+        const std::string &address = opts.upstreams[i];
+        std::size_t colon          = address.rfind(':');
+
+        if (colon == std::string::npos || colon == 0 ||
+            colon == address.size() - 1)
+        {
+            throw std::invalid_argument(
+                "http_proxy: Invalid upstream: " + address +
+                " (must be host:port)"
+            );
+        }
+
+        auto upstream        = std::make_unique<__upstream>();
+        upstream->host       = address.substr(0, colon);
+        upstream->port       = address.substr(colon + 1);
+        upstream->active     = 0;
+        upstream->fails      = 0;
+        upstream->down_until = std::chrono::steady_clock::time_point::min();
+
+        this->__upstreams.push_back(std::move(upstream));
+
+        for (std::size_t point = 0; point < __RING_POINTS; point++)
+        {
+            this->__ring.emplace_back(
+                std::hash<std::string>{}(address + "#" + std::to_string(point)),
+                i
+            );
+        }
+    }
+
+    std::sort(this->__ring.begin(), this->__ring.end());
+}
+
+http_proxy::~http_proxy()
+{
+}
+
+bool
+http_proxy::down(std::size_t index) const
+{
+    std::lock_guard<std::mutex> lock(this->__mutex);
+
+    return this->__upstreams.at(index)->down_until >
+           std::chrono::steady_clock::now();
+}
+
+void
+http_proxy::operator()(const hfs::http_request &req, hfs::http_response &res)
+{
+    bool idempotent = hfs::idempotent(req.method());
+    bool has_body   = __has_body(req);
+    bool body_read  = false;
+    bool timed_out  = false;
+    std::string error;
+    std::vector<bool> tried(this->__upstreams.size(), false);
+
+    for (std::size_t attempts = 0; attempts <= this->__opts.retries;)
+    {
+        std::optional<std::size_t> index = this->__pick(req, tried);
+
+        if (!index.has_value())
+            break;
+
+        __upstream &upstream = *this->__upstreams[*index];
+        __in_flight in_flight(upstream.active);
+        std::unique_ptr<http_client> client;
+        http_client::response head;
+        bool reused = false, sent = false;
+
+        tried[*index] = true;
+
+        try
+        {
+            client = this->__acquire(upstream, reused);
+            sent   = true;
+
+            client->send(this->__head(req, upstream));
+
+            // Relay the request body by pieces, with the same framing
+            if (has_body)
+            {
+                http_body_reader &reader = req.body_reader();
+                char buf[hfs::HTTP_BUFSZ];
+                std::size_t n;
+
+                body_read = true;
+
+                while ((n = reader.read(buf, sizeof(buf))) > 0)
+                {
+                    if (reader.chunked())
+                    {
+                        std::stringstream size;
+                        size << std::hex << n << "\r\n";
+
+                        client->send(size.str());
+                        client->send(std::string_view(buf, n));
+                        client->send("\r\n");
+                    }
+                    else
+                    {
+                        client->send(std::string_view(buf, n));
+                    }
+                }
+
+                if (reader.chunked())
+                    client->send("0\r\n\r\n");
+            }
+
+            head = client->receive_head(req.method() == "HEAD");
+        }
+        catch (const std::runtime_error &e)
+        {
+            // A body that cannot be read is the client's fault
+            if (has_body && req.body_reader().status() != HTTP_STATUS_OK)
+                throw;
+
+            bool retry = !sent || (idempotent && !body_read);
+
+            // A pooled connection may have been closed by the upstream while
+            // idle, which says nothing about its health.
+            if (reused && retry)
+            {
+                tried[*index] = false;
+                continue;
+            }
+
+            this->__failed(upstream);
+
+            error     = e.what();
+            timed_out = error.find("Timed out") != std::string::npos;
+            attempts++;
+
+            if (!retry)
+                break;
+
+            continue;
+        }
+
+        this->__succeeded(upstream);
+
+        // The end-to-end headers of the upstream response are relayed, while
+        // the framing is left to the server.
+        auto it = head.headers.find("connection");
+        std::string_view connection =
+            it == head.headers.end() ? "" : std::string_view(it->second);
+
+        res.status(head.status);
+
+        for (const auto &[name, value] : head.headers)
+        {
+            // The request ID of the proxy ties the response to its own logs
+            if (__hop_by_hop(name, connection) || name == "content-length" ||
+                name == "x-request-id")
+            {
+                continue;
+            }
+
+            res.header(__canonical(name), value);
+        }
+
+        for (const auto &cookie : head.cookies)
+            res.cookie(cookie);
+
+        try
+        {
+            this->__relay_body(*client, head, res);
+        }
+        catch (const std::runtime_error &e)
+        {
+            // Once streaming, the server can only cut the body short
+            if (!res.streaming())
+                res.status(hfs::HTTP_STATUS_BAD_GATEWAY);
+
+            this->__failed(upstream);
+            throw;
+        }
+
+        if (client->connected() && !client->reading_body())
+            this->__release(upstream, std::move(client));
+
+        return;
+    }
+
+    res.status(
+        timed_out ? hfs::HTTP_STATUS_GATEWAY_TIMEOUT
+                  : hfs::HTTP_STATUS_BAD_GATEWAY
+    );
+
+    throw std::runtime_error(hfs::format_function_error(
+        __FILE__, __LINE__,
+        error.empty() ? "No upstream available" : "Upstream failed: " + error
+    ));
+}
+
+/**
+ * @brief Relay the body of an upstream response. A body that fits in a
+ * buffer is sent with a length, larger ones are streamed as they arrive.
+ */
+void
+http_proxy::__relay_body(
+    http_client &client, const http_client::response &head,
+    hfs::http_response &res
+)
+{
+    if (!client.reading_body())
+    {
+        // Responses to `HEAD` requests, `204` and `304` have no body, but
+        // the length is kept for `HEAD`
+        auto it = head.headers.find("content-length");
+
+        if (it != head.headers.end())
+            res.header("Content-Length", it->second);
+        else
+            res.body("");
+
+        return;
+    }
+
+    std::string body(hfs::HTTP_BUFSZ, '\0');
+    std::size_t size = 0, n;
+
+    while (size < body.size() && client.reading_body() &&
+           (n = client.read_body(body.data() + size, body.size() - size)) > 0)
+    {
+        size += n;
+    }
+
+    body.resize(size);
+
+    if (!client.reading_body())
+    {
+        res.body(body);
+        return;
+    }
+
+    char buf[hfs::HTTP_BUFSZ];
+
+    res.write(body);
+
+    while ((n = client.read_body(buf, sizeof(buf))) > 0)
+        res.write(std::string_view(buf, n));
+
+    res.end();
+}
+
+/**
+ * @brief Pick an upstream that has not been tried for this request yet,
+ * preferring the healthy ones. When every upstream is down, they are tried
+ * anyway rather than failing the request without a chance.
+ */
+std::optional<std::size_t>
+http_proxy::__pick(const hfs::http_request &req, const std::vector<bool> &tried)
+{
+    std::size_t count = this->__upstreams.size();
+    std::vector<bool> allowed(count, false);
+    std::vector<std::size_t> candidates;
+
+    {
+        std::lock_guard<std::mutex> lock(this->__mutex);
+        auto now = std::chrono::steady_clock::now();
+
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (!tried[i] && this->__upstreams[i]->down_until <= now)
+                candidates.push_back(i);
+        }
+    }
+
+    if (candidates.empty())
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (!tried[i])
+                candidates.push_back(i);
+        }
+    }
+
+    if (candidates.empty())
+        return std::nullopt;
+
+    // Turns are taken among the candidates only, so that the turn of an
+    // upstream that is down does not fall on its neighbour every time.
+    std::size_t start = this->__next++;
+
+    switch (this->__opts.balancing)
+    {
+    case balancer::ROUND_ROBIN:
+        return candidates[start % candidates.size()];
+    case balancer::LEAST_CONNECTIONS:
+    {
+        std::size_t best = candidates[start % candidates.size()];
+
+        for (std::size_t index : candidates)
+        {
+            if (this->__upstreams[index]->active <
+                this->__upstreams[best]->active)
+            {
+                best = index;
+            }
+        }
+
+        return best;
+    }
+    case balancer::CONSISTENT_HASH:
+        break;
+    }
+
+    std::string_view key = req.target();
+
+    if (!this->__opts.hash_header.empty())
+    {
+        try
+        {
+            if (!req.header(this->__opts.hash_header).empty())
+                key = req.header(this->__opts.hash_header);
+        }
+        catch (const std::out_of_range &e)
+        {
+        }
+    }
+
+    for (std::size_t index : candidates)
+        allowed[index] = true;
+
+    // Walk the ring clockwise from the key to a candidate
+    std::size_t hash = std::hash<std::string_view>{}(key);
+    auto it          = std::lower_bound(
+        this->__ring.begin(), this->__ring.end(),
+        std::make_pair(hash, std::size_t(0))
+    );
+
+    for (std::size_t i = 0; i < this->__ring.size(); i++, it++)
+    {
+        if (it == this->__ring.end())
+            it = this->__ring.begin();
+
+        if (allowed[it->second])
+            return it->second;
+    }
+
+    return std::nullopt;
+}
+
+std::unique_ptr<http_client>
+http_proxy::__acquire(__upstream &upstream, bool &reused)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->__mutex);
+
+        if (!upstream.idle.empty())
+        {
+            auto client = std::move(upstream.idle.back());
+            upstream.idle.pop_back();
+
+            reused = true;
+            return client;
+        }
+    }
+
+    auto client = std::make_unique<http_client>(upstream.host, upstream.port);
+
+    client->timeout(this->__opts.timeout);
+    client->connect();
+
+    reused = false;
+    return client;
+}
+
+void
+http_proxy::__release(__upstream &upstream, std::unique_ptr<http_client> client)
+{
+    std::lock_guard<std::mutex> lock(this->__mutex);
+
+    if (upstream.idle.size() < this->__opts.max_idle)
+        upstream.idle.push_back(std::move(client));
+}
+
+void
+http_proxy::__succeeded(__upstream &upstream)
+{
+    std::lock_guard<std::mutex> lock(this->__mutex);
+    upstream.fails = 0;
+}
+
+void
+http_proxy::__failed(__upstream &upstream)
+{
+    std::lock_guard<std::mutex> lock(this->__mutex);
+
+    if (++upstream.fails < this->__opts.max_fails)
+        return;
+
+    upstream.fails      = 0;
+    upstream.down_until =
+        std::chrono::steady_clock::now() + this->__opts.fail_timeout;
+
+    // Its pooled connections are likely dead as well
+    upstream.idle.clear();
+
+    std::cerr << "http_proxy: Upstream " << upstream.host << ":"
+              << upstream.port << " is down for "
+              << this->__opts.fail_timeout.count() << "ms" << std::endl;
+}
+
+/**
+ * @brief Serialize the head of the forwarded request. The original `Host`
+ * is kept so that the upstream builds the same absolute URLs.
+ */
+std::string
+http_proxy::__head(const hfs::http_request &req, const __upstream &upstream)
+    const
+{
+    std::string connection, head;
+
+    try
+    {
+        connection = req.header("Connection");
+    }
+    catch (const std::out_of_range &e)
+    {
+    }
+
+    head.reserve(1024);
+    head.append(req.method())
+        .append(" ")
+        .append(req.target())
+        .append(" HTTP/1.1\r\n");
+
+    bool has_host = false;
+
+    for (const auto &[name, value] : req.headers())
+    {
+        // The framing is set below, and `100 Continue` is handled by the
+        // body reader when the body is relayed
+        if (__hop_by_hop(name, connection) ||
+            hfs::iequals(name, "Content-Length") ||
+            hfs::iequals(name, "Expect") || hfs::iequals(name, "X-Request-ID"))
+        {
+            continue;
+        }
+
+        has_host = has_host || hfs::iequals(name, "Host");
+        head.append(name).append(": ").append(value).append("\r\n");
+    }
+
+    if (!has_host)
+    {
+        head.append("Host: ")
+            .append(upstream.host)
+            .append(":")
+            .append(upstream.port)
+            .append("\r\n");
+    }
+
+    head.append("X-Request-ID: ").append(req.uuid()).append("\r\n");
+
+    if (__has_body(req))
+    {
+        std::optional<std::size_t> length = req.body_reader().length();
+
+        if (length.has_value())
+        {
+            head.append("Content-Length: ")
+                .append(std::to_string(*length))
+                .append("\r\n");
+        }
+        else
+        {
+            head.append("Transfer-Encoding: chunked\r\n");
+        }
+    }
+
+    head.append("\r\n");
+
+    return head;
+}
+} // namespace hfs
@@ -0,0 +1,188 @@
+#ifndef __HTTP_PROXY_H__
+#define __HTTP_PROXY_H__ 1
+
+#include <http_client.h>
+#include <http_core.h>
+#include <http_request.h>
+#include <http_response.h>
+
+namespace hfs
+{
+/**
+ * @brief Reverse-proxy handler that forwards requests to a pool of upstream
+ * HTTP/1.1 servers.
+ *
+ * Each request goes to an upstream picked by the balancing strategy among
+ * the healthy ones. Connections to the upstreams are kept alive and reused
+ * across requests. Request and response bodies are relayed by pieces, so
+ * that neither is ever held in memory entirely.
+ *
+ * Health is checked passively: an upstream that fails `max_fails` times in a
+ * row, by refusing connections, timing out or sending malformed responses,
+ * is left out for `fail_timeout`. A failed request is retried on another
+ * upstream when its method is idempotent and its body has not been read yet,
+ * or when the upstream failed before the request was sent.
+ *
+ * For example:
+ *
+ * @code
+ * ```cpp
+ * server->register_proxy_handler(
+ *     "/api/:resource",
+ *     {.upstreams = {"10.0.0.1:8080", "10.0.0.2:8080"},
+ *      .balancing = hfs::http_proxy::balancer::LEAST_CONNECTIONS}
+ * );
+ * ```
+ * @endcode
+ */
+class http_proxy
+{
+public:
+    enum class balancer
+    {
+        /**
+         * @brief Take turns over the upstreams.
+         */
+        ROUND_ROBIN,
+
+        /**
+         * @brief Prefer the upstream with the fewest requests in flight.
+         */
+        LEAST_CONNECTIONS,
+
+        /**
+         * @brief Send the requests with the same key to the same upstream,
+         * and move only the keys of an upstream when it goes away.
+         */
+        CONSISTENT_HASH,
+    };
+
+    struct options
+    {
+        /**
+         * @brief The upstream servers, as `host:port`.
+         */
+        std::vector<std::string> upstreams = {};
+
+        balancer balancing = balancer::ROUND_ROBIN;
+
+        /**
+         * @brief The request header whose value is the key of the consistent
+         * hash, e.g. a session or tenant identifier. The request target is
+         * used when it is empty or missing from the request.
+         */
+        std::string hash_header = "";
+
+        /**
+         * @brief The number of idle connections kept open per upstream.
+         */
+        std::size_t max_idle = 8;
+
+        /**
+         * @brief The time a connection, a send or a receive on an upstream
+         * may block.
+         */
+        std::chrono::milliseconds timeout{10000};
+
+        /**
+         * @brief The number of failures in a row after which an upstream is
+         * left out.
+         */
+        std::size_t max_fails = 3;
+
+        /**
+         * @brief The time an upstream is left out after too many failures.
+         */
+        std::chrono::milliseconds fail_timeout{10000};
+
+        /**
+         * @brief The number of other upstreams a failed request may be
+         * retried on.
+         */
+        std::size_t retries = 1;
+    };
+
+    /**
+     * @brief Set up the upstreams. No connection is opened until the first
+     * request.
+     *
+     * @throw `std::invalid_argument` - If there is no upstream, or one is not
+     * a `host:port` pair.
+     */
+    explicit http_proxy(const options &opts);
+
+    ~http_proxy();
+
+    http_proxy(const http_proxy &) = delete;
+
+    http_proxy &
+    operator=(const http_proxy &) = delete;
+
+    /**
+     * @brief Forward a request and relay the response, as a route handler.
+     *
+     * @throw `std::runtime_error` - If no upstream could answer, with the
+     * response status set to `502` or `504`, or if an upstream fails once
+     * the response is being relayed.
+     */
+    void
+    operator()(const hfs::http_request &req, hfs::http_response &res);
+
+    /**
+     * @brief Check whether an upstream is currently left out.
+     *
+     * @param index - The position of the upstream in the options.
+     */
+    bool
+    down(std::size_t index) const;
+
+private:
+    struct __upstream
+    {
+        std::string host;
+        std::string port;
+        std::atomic<std::size_t> active;
+        std::size_t fails;
+        std::chrono::steady_clock::time_point down_until;
+        std::vector<std::unique_ptr<http_client>> idle;
+    };
+
+    options __opts;
+    std::vector<std::unique_ptr<__upstream>> __upstreams;
+
+    /**
+     * @brief The points of the consistent hash ring, sorted by hash, and the
+     * upstream each one belongs to.
+     */
+    std::vector<std::pair<std::size_t, std::size_t>> __ring;
+
+    std::atomic<std::size_t> __next;
+    mutable std::mutex __mutex;
+
+    std::optional<std::size_t>
+    __pick(const hfs::http_request &req, const std::vector<bool> &tried);
+
+    void
+    __relay_body(
+        http_client &client, const http_client::response &head,
+        hfs::http_response &res
+    );
+
+    std::unique_ptr<http_client>
+    __acquire(__upstream &upstream, bool &reused);
+
+    void
+    __release(__upstream &upstream, std::unique_ptr<http_client> client);
+
+    void
+    __succeeded(__upstream &upstream);
+
+    void
+    __failed(__upstream &upstream);
+
+    std::string
+    __head(const hfs::http_request &req, const __upstream &upstream) const;
+};
+} // namespace hfs
+
+#endif // __HTTP_PROXY_H__
@@ -0,0 +1,141 @@
+#include <http_range.h>
+
+namespace hfs
+{
+http_range::http_range()
+{
+}
+
+http_range::~http_range()
+{
+}
+
+/**
+ * @brief Parse a non-empty run of decimal digits. Return `false` if the string
+ * contains anything else or if the value does not fit in `std::size_t`.
+ */
+static bool
+__parse_number(std::string_view str, std::size_t &value)
+{
+    if (str.empty())
+        return false;
+
+    value = 0;
+    for (char c : str)
+    {
+        if (c < '0' || c > '9')
+            return false;
+
+        if (value > (SIZE_MAX - (c - '0')) / 10)
+            return false;
+
+        value = value * 10 + (c - '0');
+    }
+
+    return true;
+}
+
+std::optional<std::vector<http_range::byte_range>>
+http_range::parse(std::string_view value, std::size_t size)
+{
+    static constexpr std::string_view unit = "bytes=";
+
+    value = hfs::trim(value);
+
+    if (!hfs::iequals(value.substr(0, unit.size()), unit))
+        return std::nullopt;
+
+    value.remove_prefix(unit.size());
+
+    std::vector<byte_range> ranges;
+    std::size_t count = 0;
+
+    while (!value.empty())
+    {
+        std::size_t comma     = value.find(',');
+        std::string_view spec = hfs::trim(value.substr(0, comma));
+        value = comma == std::string_view::npos ? "" : value.substr(comma + 1);
+
+        // Empty list elements are allowed by the `#rule` ABNF extension.
+        if (spec.empty())
+            continue;
+
+        if (++count > hfs::HTTP_MAX_RANGES)
+            return std::nullopt;
+
+        std::size_t dash = spec.find('-');
+        if (dash == std::string_view::npos)
+            return std::nullopt;
+
+        std::string_view first_str = spec.substr(0, dash);
+        std::string_view last_str  = spec.substr(dash + 1);
+        std::size_t first, last;
+
+        // suffix-range = "-" suffix-length
+        if (first_str.empty())
+        {
+            if (!__parse_number(last_str, last))
+                return std::nullopt;
+
+            if (last == 0 || size == 0)
+                continue;
+
+            first = last >= size ? 0 : size - last;
+            ranges.push_back({first, size - 1});
+            continue;
+        }
+
+        // int-range = first-pos "-" [ last-pos ]
+        if (!__parse_number(first_str, first))
+            return std::nullopt;
+
+        if (last_str.empty())
+            last = SIZE_MAX;
+        else if (!__parse_number(last_str, last) || last < first)
+            return std::nullopt;
+
+        if (first >= size)
+            continue;
+
+        ranges.push_back({first, std::min(last, size - 1)});
+    }
+
+    if (count == 0)
+        return std::nullopt;
+
+    // Coalesce overlapping and adjacent ranges so that a client cannot make
+    // the server send the same bytes over and over again.
+    std::sort(
+        ranges.begin(), ranges.end(),
+        [](const byte_range &a, const byte_range &b)
+        { return a.first < b.first; }
+    );
+
+    std::vector<byte_range> merged;
+    for (const auto &range : ranges)
+    {
+        if (!merged.empty() && range.first <= merged.back().last + 1)
+        {
+            merged.back().last = std::max(merged.back().last, range.last);
+            continue;
+        }
+
+        merged.push_back(range);
+    }
+
+    return merged;
+}
+
+std::string
+http_range::content_range(const byte_range &range, std::size_t size)
+{
+    return "bytes " + std::to_string(range.first) + "-" +
+           std::to_string(range.last) + "/" + std::to_string(size);
+}
+
+std::string
+http_range::unsatisfied_range(std::size_t size)
+{
+    return "bytes */" + std::to_string(size);
+}
+} // namespace hfs
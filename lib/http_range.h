@@ -0,0 +1,77 @@
+#ifndef __HTTP_RANGE_H__
+#define __HTTP_RANGE_H__ 1
+
+#include <http_core.h>
+
+namespace hfs
+{
+class http_range
+{
+public:
+    /**
+     * @brief An inclusive byte range `[first, last]` of a representation.
+     */
+    struct byte_range
+    {
+        std::size_t first;
+        std::size_t last;
+
+        std::size_t
+        length() const noexcept
+        {
+            return this->last - this->first + 1;
+        }
+    };
+
+    http_range();
+    ~http_range();
+
+    /**
+     * @brief Parse the value of a `Range` header against a representation of
+     * `size` bytes, as defined in RFC 9110 Section 14.1.2.
+     *
+     * Ranges are resolved to absolute offsets, sorted and coalesced when they
+     * overlap or are adjacent. Unsatisfiable ranges are dropped.
+     *
+     * For example:
+     *
+     * @code
+     * ```cpp
+     * auto ranges = http_range::parse("bytes=0-99,-100", 1000);
+     * // ranges = {{0, 99}, {900, 999}}
+     * ```
+     * @endcode
+     *
+     * @param value - The raw value of the `Range` header.
+     * @param size - The complete length of the selected representation.
+     * @return `std::nullopt` if the header is malformed, uses an unknown unit
+     * or asks for more than `HTTP_MAX_RANGES` ranges, in which case the header
+     * must be ignored. An empty vector if no range is satisfiable, in which
+     * case the server must answer with `416 (Range Not Satisfiable)`.
+     */
+    static std::optional<std::vector<byte_range>>
+    parse(std::string_view value, std::size_t size);
+
+    /**
+     * @brief Format the value of a `Content-Range` header for the given range.
+     *
+     * @param range - A satisfiable byte range.
+     * @param size - The complete length of the selected representation.
+     * @return `std::string` - For example, `bytes 0-99/1000`.
+     */
+    static std::string
+    content_range(const byte_range &range, std::size_t size);
+
+    /**
+     * @brief Format the value of a `Content-Range` header for a `416` response.
+     *
+     * @param size - The complete length of the selected representation.
+     * @return `std::string` - For example, `bytes * / 1000` (without the
+     * surrounding spaces of the slash).
+     */
+    static std::string
+    unsatisfied_range(std::size_t size);
+};
+} // namespace hfs
+
+#endif // __HTTP_RANGE_H__
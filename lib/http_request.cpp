@@ -31,7 +31,8 @@ http_request::http_request(
     const std::unordered_map<std::string, std::string> &headers
 )
     : __status(HTTP_STATUS_OK), __method(method), __path(path),
-      __version(version), __body(body), __headers(headers), __params()
+      __version(version), __body(body),
+      __headers(headers.begin(), headers.end()), __params()
 {
     this->__uuid = http_uuid::generate(this);
 }
@@ -60,6 +61,12 @@ http_request::method() const noexcept
 
 std::string_view
 http_request::path() const noexcept
+{
+    return this->__path.path();
+}
+
+std::string_view
+http_request::target() const noexcept
 {
     return this->__path.uri();
 }
@@ -71,11 +78,64 @@ http_request::version() const noexcept
 }
 
 const std::string &
-http_request::body() const noexcept
+http_request::body() const
 {
+    if (this->__reader != nullptr && !this->__reader->eof())
+        this->__body.append(this->__reader->read_all());
+
     return this->__body;
 }
 
+http_form
+http_request::query() const noexcept
+{
+    return this->__path.query();
+}
+
+http_form
+http_request::form() const
+{
+    static constexpr std::string_view urlencoded =
+        "application/x-www-form-urlencoded";
+
+    auto it = this->__headers.find("Content-Type");
+
+    if (it == this->__headers.end())
+        return http_form();
+
+    std::string_view mime =
+        hfs::trim(std::string_view(it->second).substr(0, it->second.find(';')));
+
+    if (!hfs::iequals(mime, urlencoded))
+        return http_form();
+
+    return http_form(this->body());
+}
+
+http_body_reader &
+http_request::body_reader() const
+{
+    if (this->__reader == nullptr)
+    {
+        throw std::out_of_range("http_request::body_reader: No body reader");
+    }
+
+    return *this->__reader;
+}
+
+bool
+http_request::has_body_reader() const noexcept
+{
+    return this->__reader != nullptr;
+}
+
+void
+http_request::set_body_reader(std::unique_ptr<http_body_reader> reader
+) noexcept
+{
+    this->__reader = std::move(reader);
+}
+
 void
 http_request::set_body(std::string_view body) noexcept
 {
@@ -100,6 +160,12 @@ http_request::header(const std::string &key) const
     return it->second;
 }
 
+const http_request::header_map_t &
+http_request::headers() const noexcept
+{
+    return this->__headers;
+}
+
 const std::string &
 http_request::param(const std::string &key) const
 {
@@ -236,18 +302,37 @@ http_request::__parse_headers(const std::string &line)
         ));
     }
 
-    // Extract the header name and value
-    std::string name  = line.substr(0, pos);
-    std::string value = line.substr(pos + 1);
+    // The line still ends with the `\r` of its `\r\n`
+    std::string_view field(line);
+
+    if (!field.empty() && field.back() == '\r')
+        field.remove_suffix(1);
+
+    // Extract the header name and value, without their surrounding
+    // whitespaces. Inner whitespaces of the value are meaningful, e.g. in
+    // dates of `If-Range` or `If-Modified-Since`.
+    std::string name(hfs::trim(field.substr(0, pos)));
+    std::string value(hfs::trim(field.substr(pos + 1)));
 
-    // Remove leading and trailing whitespaces
-    name.erase(std::remove_if(name.begin(), name.end(), ::isspace), name.end());
+    auto [it, inserted] = this->__headers.try_emplace(name, value);
 
-    value.erase(
-        std::remove_if(value.begin(), value.end(), ::isspace), value.end()
-    );
+    if (inserted)
+        return;
+
+    // A repeated framing field could make the body end at another place for
+    // the server than for a proxy in front of it, see RFC 9112 Section 6.3.
+    if (hfs::iequals(name, "Transfer-Encoding") ||
+        (hfs::iequals(name, "Content-Length") && it->second != value))
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__, "Conflicting header: " + name
+        ));
+    }
 
-    this->__headers[name] = value;
+    // Other repeated fields are combined into a list, see RFC 9110 Section
+    // 5.3, except cookies which are separated by semicolons.
+    if (!hfs::iequals(name, "Content-Length"))
+        it->second += (hfs::iequals(name, "Cookie") ? "; " : ", ") + value;
 }
 
 void
@@ -1,7 +1,9 @@
 #ifndef __HTTP_REQUEST_H__
 #define __HTTP_REQUEST_H__ 1
 
+#include <http_body_reader.h>
 #include <http_core.h>
+#include <http_form.h>
 #include <http_uri.h>
 #include <http_uuid.h>
 
@@ -10,6 +12,13 @@ namespace hfs
 class http_request
 {
 public:
+    /**
+     * @brief The header fields, looked up without regard to the case of
+     * their names.
+     */
+    using header_map_t = std::unordered_map<
+        std::string, std::string, hfs::istring_hash, hfs::iequal_to>;
+
     http_request();
 
     explicit http_request(const std::string &buf);
@@ -92,6 +101,14 @@ public:
     std::string_view
     path() const noexcept;
 
+    /**
+     * @brief Retrieve the request target as sent, including the query string.
+     *
+     * @return `std::string_view`
+     */
+    std::string_view
+    target() const noexcept;
+
     /**
      * @brief Retrieve the HTTP version that is part of the request line.
      *
@@ -144,10 +161,59 @@ public:
      * ```
      * @endcode
      *
+     * When a body reader is attached, the part of the body that has not been
+     * read through `body_reader()` yet is read in memory by the first call.
+     *
      * @return `const std::string&`
+     * @throw `std::runtime_error` - If the body cannot be read or is longer
+     * than `HTTP_MAX_BODYSZ`.
      */
     const std::string &
-    body() const noexcept;
+    body() const;
+
+    /**
+     * @brief Retrieve the parameters of the query string of the request.
+     *
+     * @return `http_form` - A lazy view, valid as long as the request.
+     */
+    http_form
+    query() const noexcept;
+
+    /**
+     * @brief Retrieve the fields of an `application/x-www-form-urlencoded`
+     * body. The body is read in memory like `body()` does.
+     *
+     * #### For example:
+     *
+     * @code
+     * ```cpp
+     * // POST /login with email=john%40doe.com&password=1234
+     * req.form().get("email"); // john@doe.com
+     * ```
+     * @endcode
+     *
+     * @return `http_form` - A lazy view, valid as long as the request. The
+     * form is empty if the body has another content type.
+     * @throw `std::runtime_error` - If the body cannot be read.
+     */
+    http_form
+    form() const;
+
+    /**
+     * @brief Retrieve the reader of the request body, to process the body
+     * incrementally instead of holding it in memory.
+     *
+     * @return `http_body_reader&`
+     * @throw `std::out_of_range` - If the request has no body reader.
+     */
+    http_body_reader &
+    body_reader() const;
+
+    /**
+     * @brief Check whether a body reader is attached to the request.
+     */
+    bool
+    has_body_reader() const noexcept;
 
     /**
      * @brief Retrieve a header value by name.
@@ -159,6 +225,15 @@ public:
     const std::string &
     header(const std::string &key) const;
 
+    /**
+     * @brief Retrieve every header field of the request, with their names as
+     * sent by the client.
+     *
+     * @return `const header_map_t&`
+     */
+    const header_map_t &
+    headers() const noexcept;
+
     /**
      * @brief Retrieve a paramter value of the request that matches with the
      * corresponding key of a parameter router
@@ -219,6 +294,15 @@ public:
     void
     set_body(const char *body, size_t len) noexcept;
 
+    /**
+     * @brief Attach the reader of the request body. The body is read lazily,
+     * by either `body()` or `body_reader()`.
+     *
+     * @param reader - The body reader bound to the client socket.
+     */
+    void
+    set_body_reader(std::unique_ptr<http_body_reader> reader) noexcept;
+
     /**
      * @brief Add a parameter from a parameter router to the request
      *
@@ -261,8 +345,9 @@ private:
     std::string __method;
     hfs::http_uri __path;
     std::string __version;
-    std::string __body;
-    std::unordered_map<std::string, std::string> __headers;
+    mutable std::string __body;
+    std::unique_ptr<http_body_reader> __reader;
+    header_map_t __headers;
     std::unordered_map<std::string, std::string> __params;
 
     std::string __buf;
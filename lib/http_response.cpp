@@ -1,4 +1,6 @@
+#include <http_compressor.h>
 #include <http_response.h>
+#include <http_trace.h>
 
 static std::string
 __current_date()
@@ -12,26 +14,231 @@ __current_date()
     return buf;
 }
 
+#ifdef MSG_MORE
+static constexpr int __MSG_MORE = MSG_MORE;
+#else
+static constexpr int __MSG_MORE = 0;
+#endif
+
+/**
+ * @brief Write the buffers to the socket in as few system calls as possible,
+ * retrying on partial writes. `SIGPIPE` is suppressed so that a client hanging
+ * up early is reported as an error instead of killing the server.
+ */
+static ssize_t
+__send_all(
+    int socket, std::initializer_list<std::string_view> parts, int flags = 0
+)
+{
+    struct iovec iov[4];
+    struct msghdr msg;
+    std::size_t total = 0, remaining = 0;
+
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = 0;
+
+    for (const auto &part : parts)
+    {
+        if (part.empty() || msg.msg_iovlen == std::size(iov))
+            continue;
+
+        iov[msg.msg_iovlen++] = {(void *)part.data(), part.size()};
+        remaining += part.size();
+    }
+
+    while (remaining > 0)
+    {
+        ssize_t bsent = sendmsg(socket, &msg, MSG_NOSIGNAL | flags);
+
+        if (bsent == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return -1;
+        }
+
+        total += bsent;
+        remaining -= bsent;
+
+        // Skip what has been written already
+        for (std::size_t left = bsent; left > 0;)
+        {
+            std::size_t step = std::min(left, msg.msg_iov->iov_len);
+            msg.msg_iov->iov_base = (char *)msg.msg_iov->iov_base + step;
+            msg.msg_iov->iov_len -= step;
+            left -= step;
+
+            if (msg.msg_iov->iov_len == 0 && msg.msg_iovlen > 1)
+            {
+                msg.msg_iov++;
+                msg.msg_iovlen--;
+            }
+        }
+    }
+
+    return total;
+}
+
+/**
+ * @brief Transfer a region of a file to the socket. `sendfile(2)` keeps the
+ * data in the kernel when it is available, otherwise the region is copied
+ * through a user-space buffer.
+ */
+static ssize_t
+__send_file(int socket, int fd, off_t offset, std::size_t length)
+{
+    std::size_t total = 0;
+
+    while (total < length)
+    {
+#ifdef HAVE_SYS_SENDFILE_H
+        ssize_t bsent = sendfile(socket, fd, &offset, length - total);
+#else
+        char buf[hfs::HTTP_BUFSZ];
+        ssize_t bsent =
+            pread(fd, buf, std::min(sizeof(buf), length - total), offset);
+
+        if (bsent > 0)
+        {
+            bsent = __send_all(socket, {std::string_view(buf, bsent)});
+            offset += bsent > 0 ? bsent : 0;
+        }
+#endif
+
+        if (bsent == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return -1;
+        }
+
+        // The file was truncated after the headers were sent, so the promised
+        // `Content-Length` cannot be honored anymore.
+        if (bsent == 0)
+        {
+            errno = EIO;
+            return -1;
+        }
+
+        total += bsent;
+    }
+
+    return total;
+}
+
+/**
+ * @brief Bodies released by the responses of the thread. Their storage is
+ * handed over to the next responses, so that rendering a page does not grow
+ * a new string from scratch every time.
+ */
+static thread_local std::vector<std::string> __body_pool;
+
+static constexpr std::size_t __BODY_POOL_SIZE     = 4;
+static constexpr std::size_t __BODY_POOL_CAPACITY = 256 * 1024;
+
+static std::string
+__acquire_body()
+{
+    if (__body_pool.empty())
+        return std::string();
+
+    std::string body = std::move(__body_pool.back());
+    __body_pool.pop_back();
+
+    return body;
+}
+
+static void
+__release_body(std::string &body)
+{
+    // Oversized buffers are freed, so that one large page does not pin its
+    // memory for good.
+    if (body.capacity() <= std::string().capacity() ||
+        body.capacity() > __BODY_POOL_CAPACITY ||
+        __body_pool.size() >= __BODY_POOL_SIZE)
+        return;
+
+    body.clear();
+    __body_pool.push_back(std::move(body));
+}
+
 namespace hfs
 {
+/**
+ * @brief Stream buffer appending to a string, through which templates are
+ * rendered straight into the body of a response.
+ */
+class __body_streambuf : public std::streambuf
+{
+public:
+    explicit __body_streambuf(std::string &body) : __body(body)
+    {
+    }
+
+protected:
+    int_type
+    overflow(int_type c) override
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+            this->__body.push_back(traits_type::to_char_type(c));
+
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize
+    xsputn(const char *s, std::streamsize n) override
+    {
+        this->__body.append(s, n);
+        return n;
+    }
+
+private:
+    std::string &__body;
+};
+
 inja::Environment http_response::env = inja::Environment();
 
 http_response::http_response()
-    : __status(HTTP_STATUS_OK), __headers(), __body(""), __page_dir("")
+    : __status(HTTP_STATUS_OK), __headers(), __cookies(),
+      __body(__acquire_body()),
+      __page_dir(""),
+      __file(-1), __segments(), __segments_length(0), __socket(-1),
+      __with_body(true), __streaming(false), __ended(false), __aborted(false),
+      __bytes_streamed(0), __on_stream(), __compressor(nullptr),
+      __templates(nullptr)
 {
 }
 
 http_response::http_response(const std::string &page_dir)
-    : __status(HTTP_STATUS_OK), __headers(), __body(""), __page_dir(page_dir)
+    : __status(HTTP_STATUS_OK), __headers(), __cookies(),
+      __body(__acquire_body()),
+      __page_dir(page_dir),
+      __file(-1), __segments(), __segments_length(0), __socket(-1),
+      __with_body(true), __streaming(false), __ended(false), __aborted(false),
+      __bytes_streamed(0), __on_stream(), __compressor(nullptr),
+      __templates(nullptr)
 {
 }
 
 http_response::~http_response()
 {
+    if (this->__file != -1)
+        close(this->__file);
+
+    __release_body(this->__body);
 }
 
 std::string
 http_response::operator()() const
+{
+    return this->__serialize_head() + this->__body;
+}
+
+std::string
+http_response::__serialize_head() const
 {
     std::stringstream response;
     response << "HTTP/1.1 " << this->__status << " "
@@ -42,11 +249,304 @@ http_response::operator()() const
         response << key << ": " << value << "\r\n";
     }
 
-    response << "\r\n" << this->__body;
+    for (const auto &cookie : this->__cookies)
+    {
+        response << "Set-Cookie: " << cookie << "\r\n";
+    }
+
+    response << "\r\n";
 
     return response.str();
 }
 
+void
+http_response::__update_content_length()
+{
+    this->__headers["Content-Length"] =
+        std::to_string(this->__body.length() + this->__segments_length);
+}
+
+http_response &
+http_response::file(int fd)
+{
+    if (this->__file != -1 && this->__file != fd)
+        close(this->__file);
+
+    this->__file = fd;
+    this->__segments.clear();
+    this->__segments_length = 0;
+    this->__update_content_length();
+
+    return *this;
+}
+
+http_response &
+http_response::file_segment(
+    off_t offset, std::size_t length, std::string prefix
+)
+{
+    this->__segments_length += prefix.size() + length;
+    this->__segments.push_back({std::move(prefix), offset, length});
+    this->__update_content_length();
+
+    return *this;
+}
+
+ssize_t
+http_response::send(int socket, bool with_body) const
+{
+    std::string head = this->__serialize_head();
+    std::string_view body;
+    ssize_t bsent, total = 0;
+
+    if (with_body)
+        body = this->__body;
+
+    bool more = with_body && !this->__segments.empty();
+
+    bsent = __send_all(socket, {head, body}, more ? __MSG_MORE : 0);
+
+    if (bsent == -1)
+        return -1;
+
+    total += bsent;
+
+    if (!with_body)
+        return total;
+
+    for (std::size_t i = 0; i < this->__segments.size(); i++)
+    {
+        const auto &segment = this->__segments[i];
+        bool last           = i + 1 == this->__segments.size();
+
+        if (!segment.prefix.empty())
+        {
+            bsent = __send_all(
+                socket, {segment.prefix},
+                last && segment.length == 0 ? 0 : __MSG_MORE
+            );
+
+            if (bsent == -1)
+                return -1;
+
+            total += bsent;
+        }
+
+        if (segment.length == 0)
+            continue;
+
+        bsent =
+            __send_file(socket, this->__file, segment.offset, segment.length);
+
+        if (bsent == -1)
+            return -1;
+
+        total += bsent;
+    }
+
+    return total;
+}
+
+http_response &
+http_response::bind(int socket, bool with_body, stream_hook_t on_stream)
+{
+    this->__socket    = socket;
+    this->__with_body = with_body;
+    this->__on_stream = std::move(on_stream);
+
+    return *this;
+}
+
+http_response &
+http_response::encode_stream(std::unique_ptr<http_compressor> compressor)
+{
+    this->__compressor = std::move(compressor);
+    return *this;
+}
+
+bool
+http_response::streaming() const noexcept
+{
+    return this->__streaming;
+}
+
+bool
+http_response::ended() const noexcept
+{
+    return this->__ended;
+}
+
+bool
+http_response::aborted() const noexcept
+{
+    return this->__aborted;
+}
+
+std::size_t
+http_response::bytes_streamed() const noexcept
+{
+    return this->__bytes_streamed;
+}
+
+hfs::http_timing &
+http_response::timing() noexcept
+{
+    return this->__timing;
+}
+
+const hfs::http_timing &
+http_response::timing() const noexcept
+{
+    return this->__timing;
+}
+
+void
+http_response::__start_stream()
+{
+    if (this->__socket == -1)
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__, "The response is not bound to a connection"
+        ));
+    }
+
+    if (this->__on_stream)
+        this->__on_stream(*this);
+
+    // The length of a streamed body is unknown until its end
+    this->__headers.erase("Content-Length");
+    this->__headers["Transfer-Encoding"] = "chunked";
+    this->__headers["Date"]              = __current_date();
+    this->__streaming                    = true;
+
+    std::string head = this->__serialize_head();
+
+    ssize_t bsent = __send_all(this->__socket, {head});
+
+    if (bsent == -1)
+    {
+        this->__ended = true;
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__,
+            "Failed to send the response headers: " +
+                std::string(std::strerror(errno))
+        ));
+    }
+
+    this->__bytes_streamed += bsent;
+
+    // A body set before streaming goes first
+    if (!this->__body.empty())
+    {
+        std::string body = std::move(this->__body);
+        this->__body.clear();
+        this->write(body);
+    }
+}
+
+void
+http_response::__send_chunk(std::string_view data)
+{
+    if (!this->__with_body || data.empty())
+        return;
+
+    // chunk = chunk-size CRLF chunk-data CRLF
+    char buf[24];
+    int len = std::snprintf(buf, sizeof(buf), "%zx\r\n", data.size());
+    std::string_view size(buf, len);
+
+    ssize_t bsent = __send_all(this->__socket, {size, data, "\r\n"});
+
+    if (bsent == -1)
+    {
+        this->__ended = true;
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__,
+            "Failed to send a chunk: " + std::string(std::strerror(errno))
+        ));
+    }
+
+    this->__bytes_streamed += bsent;
+}
+
+http_response &
+http_response::write(std::string_view data)
+{
+    if (this->__ended)
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__, "The response has ended already"
+        ));
+    }
+
+    if (!this->__streaming)
+        this->__start_stream();
+
+    if (data.empty())
+        return *this;
+
+    if (this->__compressor == nullptr)
+    {
+        this->__send_chunk(data);
+        return *this;
+    }
+
+    // Flush the compressor on every write, otherwise zlib could hold the
+    // piece back until much more data is written.
+    std::string encoded;
+    this->__compressor->update(data, encoded);
+    this->__compressor->flush(encoded);
+    this->__send_chunk(encoded);
+
+    return *this;
+}
+
+http_response &
+http_response::end()
+{
+    if (this->__ended)
+        return *this;
+
+    if (!this->__streaming)
+        this->__start_stream();
+
+    std::string encoded;
+
+    if (this->__compressor != nullptr)
+        this->__compressor->finish(encoded);
+
+    this->__send_chunk(encoded);
+    this->__ended = true;
+
+    if (!this->__with_body)
+        return *this;
+
+    // last-chunk = 1*("0") CRLF, followed by an empty trailer section
+    ssize_t bsent = __send_all(this->__socket, {"0\r\n\r\n"});
+
+    if (bsent == -1)
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__,
+            "Failed to terminate the body: " +
+                std::string(std::strerror(errno))
+        ));
+    }
+
+    this->__bytes_streamed += bsent;
+
+    return *this;
+}
+
+http_response &
+http_response::abort() noexcept
+{
+    this->__ended   = true;
+    this->__aborted = true;
+
+    return *this;
+}
+
 http_response &
 http_response::status(http_status_code_t status)
 {
@@ -67,21 +567,143 @@ http_response::header(const std::string &key, const std::string &value)
     return *this;
 }
 
+const std::string &
+http_response::header(const std::string &key) const
+{
+    auto it = this->__headers.find(key);
+    if (it == this->__headers.end())
+    {
+        throw std::out_of_range("http_response::header: Invalid header");
+    }
+
+    return it->second;
+}
+
+const std::unordered_map<std::string, std::string> &
+http_response::headers() const noexcept
+{
+    return this->__headers;
+}
+
+http_response &
+http_response::cookie(const std::string &value)
+{
+    this->__cookies.push_back(value);
+    return *this;
+}
+
+const std::vector<std::string> &
+http_response::cookies() const noexcept
+{
+    return this->__cookies;
+}
+
+const std::string &
+http_response::body() const noexcept
+{
+    return this->__body;
+}
+
+bool
+http_response::has_file_segments() const noexcept
+{
+    return !this->__segments.empty();
+}
+
 http_response &
 http_response::body(const std::string &body)
 {
     // Headers prepared for generic text content
-    this->__headers["Content-Length"] = std::to_string(body.length());
-    this->__headers["Date"]           = __current_date();
+    this->__body            = body;
+    this->__headers["Date"] = __current_date();
+    this->__update_content_length();
 
-    this->__body = body;
     return *this;
 }
 
+void
+http_response::__render_body(
+    const std::string &endpoint,
+    const std::function<void(std::ostream &os)> &render
+)
+{
+    this->__timing.mark(http_timing::RENDER_START);
+    HFS_TRACE_SPAN("render", endpoint);
+
+    // The template is rendered into the body, which is sent as is after the
+    // headers.
+    __body_streambuf sink(this->__body);
+    std::ostream os(&sink);
+
+    this->__body.clear();
+
+    try
+    {
+        render(os);
+    }
+    catch (...)
+    {
+        this->__body.clear();
+        throw;
+    }
+
+    this->__timing.mark(http_timing::RENDER_END);
+
+    this->__headers["Date"] = __current_date();
+    this->__update_content_length();
+    this->header("Content-Type", "text/html; charset=utf-8");
+}
+
+void
+http_response::__set_validators(int flags, time_t mtime, std::size_t size)
+{
+    if (flags & ETAG)
+        this->header("ETag", "W/" + hfs::etag(mtime, size));
+
+    if (flags & LAST_MODIFIED)
+        this->header("Last-Modified", hfs::format_date(mtime));
+
+    this->header("Cache-Control", "public, max-age=0, must-revalidate");
+}
+
+http_response &
+http_response::templates(const hfs::http_templates *templates) noexcept
+{
+    this->__templates = templates;
+    return *this;
+}
+
+const hfs::http_templates *
+http_response::templates() const noexcept
+{
+    return this->__templates;
+}
+
 http_response &
 http_response::render(const std::string &endpoint, inja::json data, int flags)
 {
-    (void)data;
+    if (this->__templates != nullptr)
+    {
+        const http_templates::page *page = this->__templates->find(endpoint);
+
+        if (page == nullptr)
+        {
+            this->status(HTTP_STATUS_NOT_FOUND);
+            this->body("404 Not Found");
+            return *this;
+        }
+
+        if (flags & GET_REQUEST)
+        {
+            this->__render_body(
+                endpoint, [this, page, &data](std::ostream &os)
+                { this->__templates->render_to(os, *page, data); }
+            );
+        }
+
+        this->__set_validators(flags, page->mtime, page->size);
+        return *this;
+    }
 
     int fd;
     struct stat st;
@@ -133,18 +755,27 @@ http_response::render(const std::string &endpoint, inja::json data, int flags)
 
     if (flags & GET_REQUEST)
     {
-        std::string temp(buffer, st.st_size);
-        std::string body = hfs::http_response::env.render(temp, data);
-        this->body(body).header("Content-Type", "text/html; charset=utf-8");
+        // The template is parsed from the mapping
+        try
+        {
+            this->__render_body(
+                endpoint,
+                [buffer, &st, &data](std::ostream &os)
+                {
+                    hfs::http_response::env.render_to(
+                        os, std::string_view(buffer, st.st_size), data
+                    );
+                }
+            );
+        }
+        catch (...)
+        {
+            munmap(buffer, st.st_size);
+            throw;
+        }
     }
 
-    if (flags & ETAG)
-        this->header("ETag", "W/" + hfs::etag(st.st_mtime, st.st_size));
-
-    if (flags & LAST_MODIFIED)
-        this->header("Last-Modified", hfs::format_date(st.st_mtime));
-
-    this->header("Cache-Control", "public, max-age=0, must-revalidate");
+    this->__set_validators(flags, st.st_mtime, st.st_size);
 
     if (munmap(buffer, st.st_size) == -1)
     {
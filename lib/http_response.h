@@ -2,13 +2,22 @@
 #define __HTTP_RESPONSE_H__ 1
 
 #include <http_core.h>
+#include <http_templates.h>
+#include <http_timing.h>
 
 namespace hfs
 {
+class http_compressor;
 
 class http_response
 {
 public:
+    /**
+     * @brief A callback invoked right before the headers of a streamed
+     * response are sent, which is the last chance to amend them.
+     */
+    using stream_hook_t = std::function<void(http_response &res)>;
+
     static inja::Environment env;
     static const int HEAD_REQUEST  = 0b0000000;
     static const int GET_REQUEST   = 0b0000001;
@@ -19,6 +28,11 @@ public:
     http_response(const std::string &page_dir);
     ~http_response();
 
+    http_response(const http_response &) = delete;
+
+    http_response &
+    operator=(const http_response &) = delete;
+
     std::string
     operator()() const;
 
@@ -31,9 +45,54 @@ public:
     http_response &
     header(const std::string &key, const std::string &value);
 
+    /**
+     * @brief Retrieve a header value by name.
+     *
+     * @param key - Response header name.
+     * @return `const std::string&`
+     * @throw `std::out_of_range` - If the header is not set.
+     */
+    const std::string &
+    header(const std::string &key) const;
+
+    /**
+     * @brief Retrieve every header field of the response.
+     *
+     * @return `const std::unordered_map<std::string, std::string>&`
+     */
+    const std::unordered_map<std::string, std::string> &
+    headers() const noexcept;
+
+    /**
+     * @brief Add a `Set-Cookie` field. Each call sends its own field line,
+     * since cookies cannot be joined into one value like other headers.
+     *
+     * @param value - The value of the field, e.g. `id=a3fWa; Path=/`.
+     * @return `http_response&`
+     */
+    http_response &
+    cookie(const std::string &value);
+
+    /**
+     * @brief Retrieve the `Set-Cookie` fields of the response.
+     *
+     * @return `const std::vector<std::string>&`
+     */
+    const std::vector<std::string> &
+    cookies() const noexcept;
+
     http_response &
     body(const std::string &body);
 
+    /**
+     * @brief Retrieve the in-memory body of the response, which does not
+     * include the file segments.
+     *
+     * @return `const std::string&`
+     */
+    const std::string &
+    body() const noexcept;
+
     http_response &
     render(
         const std::string &endpoint, inja::json data,
@@ -43,11 +102,240 @@ public:
     http_response &
     render(const std::string &endpoint);
 
+    /**
+     * @brief Render the pages from a registry of parsed templates instead of
+     * reading and parsing them from `page_dir` on every render. The registry
+     * must outlive the response.
+     *
+     * @param templates - The registry, or `nullptr` to read the pages again.
+     */
+    http_response &
+    templates(const hfs::http_templates *templates) noexcept;
+
+    /**
+     * @brief Retrieve the registry the pages are rendered from, if any.
+     */
+    const hfs::http_templates *
+    templates() const noexcept;
+
+    /**
+     * @brief Attach an open file whose content is transferred with
+     * `sendfile(2)` after the headers and the in-memory body. The response
+     * takes the ownership of the descriptor and closes it when destroyed.
+     *
+     * Nothing of the file is sent until a segment is added with
+     * `file_segment`.
+     *
+     * @param fd - An open file descriptor, readable from any offset.
+     */
+    http_response &
+    file(int fd);
+
+    /**
+     * @brief Append `length` bytes of the attached file starting at `offset`
+     * to the body, preceded by `prefix`. A segment with a zero length only
+     * sends its prefix, which is useful for trailers such as the closing
+     * delimiter of a `multipart/byteranges` body.
+     *
+     * The `Content-Length` header is updated accordingly.
+     *
+     * @param offset - The position of the first byte in the attached file.
+     * @param length - The number of bytes to send.
+     * @param prefix - Bytes sent before the file region.
+     */
+    http_response &
+    file_segment(off_t offset, std::size_t length, std::string prefix = "");
+
+    /**
+     * @brief Check whether a part of the body is transferred from a file.
+     *
+     * @return `bool`
+     */
+    bool
+    has_file_segments() const noexcept;
+
+    /**
+     * @brief Serialize and write the response to the given socket: the status
+     * line, the headers, the in-memory body and then every file segment.
+     *
+     * @param socket - A connected socket.
+     * @param with_body - Whether to send the body at all. This must be `false`
+     * for responses to `HEAD` requests.
+     * @return `ssize_t` - The number of bytes sent, or `-1` if the connection
+     * failed, in which case `errno` is set.
+     */
+    ssize_t
+    send(int socket, bool with_body = true) const;
+
+    /**
+     * @brief Bind the response to the connection it answers, so that the
+     * handler can stream the body with `write` and `end` instead of building
+     * it up front.
+     *
+     * @param socket - The connected client socket.
+     * @param with_body - Whether to send the body at all. This must be `false`
+     * for responses to `HEAD` requests.
+     * @param on_stream - An optional callback invoked before the headers of a
+     * streamed response are sent.
+     */
+    http_response &
+    bind(int socket, bool with_body = true, stream_hook_t on_stream = nullptr);
+
+    /**
+     * @brief Stream a piece of the body to the client with the `chunked`
+     * transfer coding, as defined in RFC 9112 Section 7.1.
+     *
+     * The first call sends the status line and the headers, without
+     * `Content-Length`. Each call is flushed to the socket immediately, so
+     * that the client receives the beginning of the body while the rest is
+     * still being produced. The status and headers cannot be changed once the
+     * first piece is written.
+     *
+     * For example:
+     *
+     * @code
+     * ```cpp
+     * server->register_handler("/export", "GET",
+     *     [](const hfs::http_request &req, hfs::http_response &res)
+     *     {
+     *         res.header("Content-Type", "text/csv");
+     *
+     *         for (const auto &row : rows)
+     *             res.write(row.to_csv());
+     *
+     *         res.end();
+     *     });
+     * ```
+     * @endcode
+     *
+     * @param data - The next bytes of the body. Empty pieces are ignored,
+     * because an empty chunk terminates the body.
+     * @throw `std::runtime_error` - If the response is not bound to a
+     * connection, has ended already, or the client has gone away.
+     */
+    http_response &
+    write(std::string_view data);
+
+    /**
+     * @brief Terminate a streamed body. The server calls it on behalf of the
+     * handler if the handler returns without doing it.
+     *
+     * @throw `std::runtime_error` - If the client has gone away.
+     */
+    http_response &
+    end();
+
+    /**
+     * @brief Give up on a streamed body that cannot be completed, e.g. when
+     * the handler fails halfway. The response is marked as ended without
+     * sending the last chunk, so that the server resets the connection and
+     * the client sees the body as truncated rather than complete.
+     */
+    http_response &
+    abort() noexcept;
+
+    /**
+     * @brief Apply a content coding to the streamed body, usually set from the
+     * stream hook. The `Content-Encoding` header is left to the caller.
+     *
+     * @param compressor - The compressor every piece goes through.
+     */
+    http_response &
+    encode_stream(std::unique_ptr<http_compressor> compressor);
+
+    /**
+     * @brief Check whether the headers have been sent by `write` or `end`, in
+     * which case the response must not be sent again with `send`.
+     *
+     * @return `bool`
+     */
+    bool
+    streaming() const noexcept;
+
+    /**
+     * @brief Check whether a streamed body has been terminated.
+     *
+     * @return `bool`
+     */
+    bool
+    ended() const noexcept;
+
+    /**
+     * @brief Check whether a streamed body has been given up with `abort`.
+     *
+     * @return `bool`
+     */
+    bool
+    aborted() const noexcept;
+
+    /**
+     * @brief Retrieve the number of bytes sent by `write` and `end`, framing
+     * included.
+     *
+     * @return `std::size_t`
+     */
+    std::size_t
+    bytes_streamed() const noexcept;
+
+    /**
+     * @brief Retrieve the phase timestamps of the request being answered.
+     * `render` marks the template rendering, the server marks the rest.
+     */
+    hfs::http_timing &
+    timing() noexcept;
+
+    const hfs::http_timing &
+    timing() const noexcept;
+
 private:
+    struct __file_segment
+    {
+        std::string prefix;
+        off_t offset;
+        std::size_t length;
+    };
+
     http_status_code_t __status;
     std::unordered_map<std::string, std::string> __headers;
+    std::vector<std::string> __cookies;
     std::string __body;
     std::string __page_dir;
+
+    int __file;
+    std::vector<__file_segment> __segments;
+    std::size_t __segments_length;
+
+    int __socket;
+    bool __with_body;
+    bool __streaming;
+    bool __ended;
+    bool __aborted;
+    std::size_t __bytes_streamed;
+    stream_hook_t __on_stream;
+    std::unique_ptr<http_compressor> __compressor;
+    hfs::http_timing __timing;
+    const hfs::http_templates *__templates;
+
+    std::string
+    __serialize_head() const;
+
+    void
+    __update_content_length();
+
+    void
+    __render_body(
+        const std::string &endpoint,
+        const std::function<void(std::ostream &os)> &render
+    );
+
+    void
+    __set_validators(int flags, time_t mtime, std::size_t size);
+
+    void
+    __start_stream();
+
+    void
+    __send_chunk(std::string_view data);
 };
 } // namespace hfs
 
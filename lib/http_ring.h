@@ -0,0 +1,81 @@
+#ifndef __HTTP_RING_H__
+#define __HTTP_RING_H__ 1
+
+#include <http_core.h>
+
+namespace hfs
+{
+/**
+ * @brief Bounded lock-free queue for exactly one producer thread and one
+ * consumer thread.
+ *
+ * Both sides only ever wait on nothing: `try_push` fails when the ring is
+ * full and `try_pop` fails when it is empty. The indices live on separate
+ * cache lines so that the producer and the consumer do not invalidate each
+ * other's line on every operation.
+ *
+ * @tparam T - A trivially copyable element type.
+ * @tparam N - The capacity, a power of two.
+ */
+template <typename T, std::size_t N>
+class http_ring
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be 2^n");
+    static_assert(std::is_trivially_copyable_v<T>, "T must be a POD");
+
+public:
+    http_ring() noexcept : __head(0), __tail(0)
+    {
+    }
+
+    http_ring(const http_ring &) = delete;
+
+    http_ring &
+    operator=(const http_ring &) = delete;
+
+    /**
+     * @brief Append an element. Called by the producer only.
+     *
+     * @return `false` if the ring is full.
+     */
+    bool
+    try_push(const T &value) noexcept
+    {
+        std::size_t tail = this->__tail.load(std::memory_order_relaxed);
+
+        if (tail - this->__head.load(std::memory_order_acquire) == N)
+            return false;
+
+        this->__slots[tail & (N - 1)] = value;
+        this->__tail.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest element. Called by the consumer only.
+     *
+     * @return `false` if the ring is empty.
+     */
+    bool
+    try_pop(T &value) noexcept
+    {
+        std::size_t head = this->__head.load(std::memory_order_relaxed);
+
+        if (head == this->__tail.load(std::memory_order_acquire))
+            return false;
+
+        value = this->__slots[head & (N - 1)];
+        this->__head.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+private:
+    alignas(64) std::atomic<std::size_t> __head;
+    alignas(64) std::atomic<std::size_t> __tail;
+    alignas(64) std::array<T, N> __slots;
+};
+} // namespace hfs
+
+#endif // __HTTP_RING_H__
@@ -1,4 +1,5 @@
 #include <http_router.h>
+#include <http_trace.h>
 
 namespace hfs
 {
@@ -75,29 +76,31 @@ http_router::get_route_handler(
     hfs::http_router *root_router, hfs::http_request *req
 )
 {
-    std::vector<std::string> path_parts =
-        hfs::http_uri::split_path(std::string(req->path()));
+    HFS_TRACE_SPAN("route");
+
+    // The path has been split by the request parser already, so segments
+    // are looked up as views over it.
+    std::string_view path = req->path(), part;
 
     hfs::http_router::route_handler_t handler = nullptr;
     hfs::http_router *router                  = root_router;
-    std::unordered_map<std::string, std::string> params;
 
     // Find the handler for the path
-    for (const auto &part : path_parts)
+    while (hfs::http_uri::next_segment(path, part))
     {
-        if (part == "/")
-        {
-            router = root_router;
-        }
-        else if (router->routes.find(part) != router->routes.end())
+        auto it = router->routes.find(part);
+
+        if (it != router->routes.end())
         {
-            router = router->routes[part].get();
+            router = it->second.get();
         }
         // Check if the router has a parameter router
-        else if (router->routes.find("*") != router->routes.end())
+        else if ((it = router->routes.find("*")) != router->routes.end())
         {
-            router = router->routes["*"].get();
-            req->add_param(((http_param_router *)router)->param_name, part);
+            router = it->second.get();
+            req->add_param(
+                ((http_param_router *)router)->param_name, std::string(part)
+            );
         }
         // Find in the static files
         else
@@ -106,7 +109,10 @@ http_router::get_route_handler(
         }
     }
 
-    handler = router->handlers[std::string(req->method())];
+    auto it = router->handlers.find(req->method());
+
+    if (it != router->handlers.end())
+        handler = it->second;
 
     return std::make_pair(router, handler);
 }
@@ -33,13 +33,25 @@ public:
 
 public:
     http_router();
-    ~http_router();
+    virtual ~http_router();
 
     std::string base_name;
+
+    /**
+     * @brief The path the handlers of this router have been registered with,
+     * e.g. `/blogs/:slug`, which labels their metrics.
+     */
+    std::string pattern;
+
     bool is_param_router;
-    std::unordered_map<std::string, std::unique_ptr<hfs::http_router>> routes;
+    std::unordered_map<
+        std::string, std::unique_ptr<hfs::http_router>, hfs::string_hash,
+        std::equal_to<>>
+        routes;
     std::unordered_map<hfs::http_status_code_t, error_handler_t> error_handlers;
-    std::unordered_map<std::string, route_handler_t> handlers = {
+    std::unordered_map<
+        std::string, route_handler_t, hfs::string_hash, std::equal_to<>>
+        handlers = {
         {"GET",     not_implemented},
         {"POST",    not_implemented},
         {"PUT",     not_implemented},
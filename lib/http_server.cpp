@@ -2,4 +2,148 @@
 
 namespace hfs
 {
+void
+http_server_base::enable_compression(
+    const hfs::http_compressor::options &options
+)
+{
+    this->__compression = options;
+}
+
+void
+http_server_base::enable_access_log(
+    const hfs::http_access_log::options &options
+)
+{
+    this->__access_log = std::make_unique<hfs::http_access_log>(options);
+}
+
+void
+http_server_base::enable_server_timing()
+{
+    this->__server_timing = true;
+}
+
+void
+http_server_base::enable_capture(const hfs::http_capture::options &options)
+{
+    this->__capture = std::make_unique<hfs::http_capture>(options);
+}
+
+void
+http_server_base::enable_metrics()
+{
+    // The metrics handler holds on to them, so they are never replaced
+    if (this->__metrics != nullptr)
+        return;
+
+    this->__metrics = std::make_unique<hfs::http_metrics>();
+
+    for (const auto &[path, method, cache] : this->__caches)
+        this->__metrics->watch(path, method, cache);
+}
+
+void
+http_server_base::register_metrics_handler(const std::string &path)
+{
+    this->enable_metrics();
+
+    // Merging the shards only locks each of them briefly, so a scrape does
+    // not hold back the threads that record requests.
+    this->register_handler(
+        path, "GET",
+        [metrics = this->__metrics.get()](
+            const hfs::http_request &req, hfs::http_response &res
+        )
+        {
+            (void)req;
+
+            res.status(hfs::HTTP_STATUS_OK)
+                .header("Content-Type", "text/plain; version=0.0.4")
+                .header("Cache-Control", "no-store")
+                .body(metrics->prometheus());
+        }
+    );
+}
+
+void
+http_server_base::enable_tracing(const std::filesystem::path &path, int signum)
+{
+    hfs::http_trace::start();
+    hfs::http_trace::dump_on_signal(signum, path);
+}
+
+void
+http_server_base::register_trace_handler(const std::string &path)
+{
+    hfs::http_trace::start();
+
+    this->register_handler(
+        path, "GET",
+        [](const hfs::http_request &req, hfs::http_response &res)
+        {
+            (void)req;
+
+            res.status(hfs::HTTP_STATUS_OK)
+                .header("Content-Type", "application/json")
+                .header("Cache-Control", "no-store")
+                .body(hfs::http_trace::chrome_json());
+        }
+    );
+}
+
+void
+http_server_base::register_proxy_handler(
+    const std::string &path, const hfs::http_proxy::options &options
+)
+{
+    // The handlers of every method share the upstream pools and health
+    auto proxy = std::make_shared<hfs::http_proxy>(options);
+
+    for (const char *method :
+         {"GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS"})
+    {
+        this->register_handler(
+            path, method,
+            [proxy](const hfs::http_request &req, hfs::http_response &res)
+            { (*proxy)(req, res); }
+        );
+    }
+}
+
+void
+http_server_base::register_cached_handler(
+    const std::string &path, const std::string &method,
+    hfs::http_router::route_handler_t handler,
+    const hfs::http_cache::options &options
+)
+{
+    auto cache = std::make_shared<hfs::http_cache>(options);
+
+    this->__caches.emplace_back(path, method, cache);
+
+    if (this->__metrics != nullptr)
+        this->__metrics->watch(path, method, cache);
+
+    this->register_handler(
+        path, method,
+        [cache, handler = std::move(handler)](
+            const hfs::http_request &req, hfs::http_response &res
+        ) { (*cache)(req, res, handler); }
+    );
+}
+
+void
+http_server_base::memoize_fragment(
+    const std::string &name, const std::vector<std::string> &keys
+)
+{
+    hfs::http_fragments::memoize(name, keys);
+}
+
+hfs::http_metrics *
+http_server_base::metrics() const noexcept
+{
+    return this->__metrics.get();
 }
+} // namespace hfs
@@ -1,8 +1,16 @@
 #ifndef __HTTP_SERVER_H__
 #define __HTTP_SERVER_H__ 1
 
+#include "http_access_log.h"
+#include "http_cache.h"
+#include "http_capture.h"
+#include "http_compressor.h"
+#include "http_fragments.h"
 #include "http_core.h"
+#include "http_metrics.h"
+#include "http_proxy.h"
 #include "http_router.h"
+#include "http_trace.h"
 #include "http_uri.h"
 
 #define HTTP_SERVER_USER_AGENT "http-from-scratch server"
@@ -36,6 +44,184 @@ public:
         hfs::http_router::route_handler_t handler
     ) = 0;
 
+    /**
+     * @brief Compress the bodies produced by handlers, such as rendered pages,
+     * with `gzip` or `deflate` when the client accepts it. Static files are
+     * not affected, see the precompressed siblings instead.
+     *
+     * @param options - The compression level, the minimum body size and the
+     * media types to compress.
+     */
+    void
+    enable_compression(const hfs::http_compressor::options &options = {});
+
+    /**
+     * @brief Record every answered request in an access log, written by a
+     * background thread so that request handling never waits on the disk.
+     *
+     * @param options - The log file, its rotation and the flush interval.
+     * @throw `std::runtime_error` - If the log file cannot be opened.
+     */
+    void
+    enable_access_log(const hfs::http_access_log::options &options = {});
+
+    /**
+     * @brief Report how long each phase of a request took in a
+     * `Server-Timing` response header, e.g. `parse;dur=0.012`, which browser
+     * developer tools display next to the network timings. Along with the
+     * `X-Request-ID` header, it ties a slow response to its access log entry.
+     */
+    void
+    enable_server_timing();
+
+    /**
+     * @brief Sample live requests into a file that `hfs-load -r` replays,
+     * to benchmark the server offline with production-shaped traffic.
+     *
+     * @param options - The capture file, the sampling rate and the fields
+     * left out.
+     * @throw `std::runtime_error` - If the capture file cannot be opened.
+     */
+    void
+    enable_capture(const hfs::http_capture::options &options = {});
+
+    /**
+     * @brief Count the requests and measure their latency per route pattern
+     * and per status class. Enabling them again keeps what they have
+     * recorded.
+     */
+    void
+    enable_metrics();
+
+    /**
+     * @brief Serve the metrics in the Prometheus text format on an admin
+     * route, enabling them if needed. The route is opt-in because it exposes
+     * the routes of the server to anyone who can reach it.
+     *
+     * For example:
+     *
+     * @code
+     * ```cpp
+     * server->register_metrics_handler("/admin/metrics");
+     * ```
+     * @endcode
+     *
+     * @param path - The path of the route.
+     */
+    void
+    register_metrics_handler(const std::string &path = "/metrics");
+
+    /**
+     * @brief Start recording the stages of every request (parse, route,
+     * handler, render, memoized fragments and send) and dump them as a Chrome
+     * trace when the process receives a signal, e.g. `kill -USR2 <pid>`.
+     *
+     * @param path - The file the trace is written to.
+     * @param signum - The signal that triggers a dump.
+     */
+    void
+    enable_tracing(
+        const std::filesystem::path &path = "trace.json", int signum = SIGUSR2
+    );
+
+    /**
+     * @brief Serve the recorded trace, in the Chrome trace-event format, on
+     * an admin route, starting the recording if needed.
+     *
+     * @param path - The path of the route.
+     */
+    void
+    register_trace_handler(const std::string &path = "/debug/trace");
+
+    /**
+     * @brief Forward the requests of a route to a pool of upstream servers,
+     * for every method but `CONNECT` and `TRACE`. The request target is
+     * forwarded as is, so the upstreams see the same paths.
+     *
+     * For example:
+     *
+     * @code
+     * ```cpp
+     * server->register_proxy_handler(
+     *     "/api/:resource", {.upstreams = {"localhost:7001", "localhost:7002"}}
+     * );
+     * ```
+     * @endcode
+     *
+     * @param path - The path of the route.
+     * @param options - The upstreams, the balancing strategy, the timeouts,
+     * the passive health checks and the retries.
+     * @throw `std::invalid_argument` - If an upstream is not a `host:port`
+     * pair.
+     */
+    void
+    register_proxy_handler(
+        const std::string &path, const hfs::http_proxy::options &options
+    );
+
+    /**
+     * @brief Register a route handler whose responses are kept in a shared
+     * micro-cache for a short time, for pages that render the same content on
+     * every hit. Concurrent misses run the handler once.
+     *
+     * For example:
+     *
+     * @code
+     * ```cpp
+     * server->register_cached_handler(
+     *     "/about", "GET",
+     *     [](const hfs::http_request &req, hfs::http_response &res)
+     *     { res.render("about"); },
+     *     {.ttl = std::chrono::seconds(1), .vary = {"Accept-Language"}}
+     * );
+     * ```
+     * @endcode
+     *
+     * @param path - The path of the route.
+     * @param method - The method of the route.
+     * @param handler - The handler, run on misses only.
+     * @param options - The lifetime of the responses, the size of the cache
+     * and the request headers that select distinct responses.
+     *
+     * The hits and the misses of the cache are exported by the metrics as
+     * `hfs_cache_hits_total` and `hfs_cache_misses_total`.
+     */
+    void
+    register_cached_handler(
+        const std::string &path, const std::string &method,
+        hfs::http_router::route_handler_t handler,
+        const hfs::http_cache::options &options = {}
+    );
+
+    /**
+     * @brief Render a template fragment once per combination of the values
+     * of the keys it depends on, and splice its output into the pages that
+     * include it afterwards. It must be called before the server starts.
+     *
+     * For example:
+     *
+     * @code
+     * ```cpp
+     * server->memoize_fragment("components/_navbar.html");
+     * ```
+     * @endcode
+     *
+     * @param name - The path of the fragment, as included.
+     * @param keys - The variables of the data the output depends on, if any.
+     * @throw `std::invalid_argument` - If a key is not a variable name.
+     */
+    void
+    memoize_fragment(
+        const std::string &name, const std::vector<std::string> &keys = {}
+    );
+
+    /**
+     * @brief Retrieve the metrics of the server, or `nullptr` if they are not
+     * enabled.
+     */
+    hfs::http_metrics *
+    metrics() const noexcept;
+
 protected:
     struct addrinfo __hints;
     int __port;
@@ -45,6 +231,20 @@ protected:
     std::string __static_path;
     std::filesystem::directory_entry __static_dir;
     std::unique_ptr<hfs::http_router> __router;
+    std::optional<hfs::http_compressor::options> __compression;
+    std::unique_ptr<hfs::http_access_log> __access_log;
+    std::unique_ptr<hfs::http_capture> __capture;
+    std::unique_ptr<hfs::http_metrics> __metrics;
+    std::shared_ptr<const hfs::http_templates> __templates;
+    bool __server_timing = false;
+
+    /**
+     * @brief The route pattern, the method and the cache of every cached
+     * route, reported by the metrics once they are enabled.
+     */
+    std::vector<std::tuple<
+        std::string, std::string, std::shared_ptr<const hfs::http_cache>>>
+        __caches;
 };
 } // namespace hfs
 
@@ -0,0 +1,108 @@
+#include <http_fragments.h>
+#include <http_templates.h>
+
+namespace hfs
+{
+http_templates::http_templates(const std::filesystem::path &dir)
+    : __env(), __pages()
+{
+    resolve_includes(this->__env, dir);
+
+    std::error_code ec;
+    std::filesystem::recursive_directory_iterator it(dir, ec), end;
+
+    for (; !ec && it != end; it.increment(ec))
+    {
+        const std::filesystem::path &path = it->path();
+        struct stat st;
+
+        if (!it->is_regular_file() || path.extension() != ".html")
+            continue;
+
+        if (stat(path.c_str(), &st) == -1)
+        {
+            throw std::runtime_error(hfs::format_function_error(
+                __FILE__, __LINE__,
+                "Failed to stat " + path.string() + ": " +
+                    std::string(std::strerror(errno))
+            ));
+        }
+
+        std::filesystem::path relative = path.lexically_relative(dir);
+        std::string name =
+            (relative.parent_path() / relative.stem()).generic_string();
+
+        this->__pages.emplace(
+            std::move(name),
+            page{
+                this->__env.parse(this->__load(path)), st.st_mtime,
+                static_cast<std::size_t>(st.st_size)
+        }
+        );
+    }
+
+    if (ec)
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__,
+            "Failed to read the templates of " + dir.string() + ": " +
+                ec.message()
+        ));
+    }
+}
+
+const http_templates::page *
+http_templates::find(std::string_view name) const noexcept
+{
+    auto it = this->__pages.find(name);
+    return it != this->__pages.end() ? &it->second : nullptr;
+}
+
+void
+http_templates::render_to(
+    std::ostream &os, const page &p, const inja::json &data
+) const
+{
+    this->__env.render_to(os, p.tmpl, data);
+}
+
+std::size_t
+http_templates::size() const noexcept
+{
+    return this->__pages.size();
+}
+
+void
+http_templates::resolve_includes(
+    inja::Environment &env, const std::filesystem::path &dir
+)
+{
+    // Includes are resolved from the directory of the pages rather than from
+    // the working directory of the process.
+    env.set_search_included_templates_in_files(false);
+
+    hfs::http_fragments::set_include_callback(
+        env,
+        [&env, dir](const std::string &path, const std::string &name)
+        { return env.parse(__load(dir / (path + name))); }
+    );
+}
+
+std::string
+http_templates::__load(const std::filesystem::path &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream content;
+
+    if (!file)
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__, "Template not found: " + path.string()
+        ));
+    }
+
+    content << file.rdbuf();
+
+    return content.str();
+}
+} // namespace hfs
@@ -0,0 +1,112 @@
+#ifndef __HTTP_TEMPLATES_H__
+#define __HTTP_TEMPLATES_H__ 1
+
+#include <http_core.h>
+
+namespace hfs
+{
+/**
+ * @brief Immutable registry of the pages of a server, parsed once when it is
+ * built, along with every template they include or extend.
+ *
+ * Rendering a page from the registry neither reads nor parses anything: the
+ * environment only holds parsed templates that are never modified again, and
+ * each render has a renderer of its own. A registry can thus be shared by any
+ * number of threads without locking, unlike `http_response::env` whose
+ * templates are parsed on every render.
+ *
+ * Memoized fragments, see `http_fragments`, must be declared before the
+ * registry is built.
+ *
+ * For example:
+ *
+ * @code
+ * ```cpp
+ * auto templates = std::make_shared<const hfs::http_templates>("public/pages");
+ *
+ * hfs::http_response res;
+ * res.templates(templates.get()).render("index");
+ * ```
+ * @endcode
+ */
+class http_templates
+{
+public:
+    struct page
+    {
+        inja::Template tmpl;
+
+        /**
+         * @brief The last modification time and the size of the file, from
+         * which the validators of the responses are derived.
+         */
+        time_t mtime;
+        std::size_t size;
+    };
+
+    /**
+     * @brief Parse every `.html` file of a directory and its subdirectories.
+     * Pages are named after their path relative to the directory, without
+     * the extension, e.g. `index` or `components/_navbar`.
+     *
+     * @param dir - The directory of the pages.
+     * @throw `std::runtime_error` - If the directory cannot be read, or a
+     * template cannot be read or parsed.
+     */
+    explicit http_templates(const std::filesystem::path &dir);
+
+    http_templates(const http_templates &) = delete;
+
+    http_templates &
+    operator=(const http_templates &) = delete;
+
+    /**
+     * @brief Retrieve a page by name.
+     *
+     * @return `const page*` - The page, or `nullptr` if there is none.
+     */
+    const page *
+    find(std::string_view name) const noexcept;
+
+    /**
+     * @brief Render a page of the registry, from any thread.
+     *
+     * @param os - The stream the output is written to.
+     * @throw `std::runtime_error` - If the data does not fit the template.
+     */
+    void
+    render_to(std::ostream &os, const page &p, const inja::json &data) const;
+
+    /**
+     * @brief Retrieve the number of pages.
+     */
+    std::size_t
+    size() const noexcept;
+
+    /**
+     * @brief Resolve the includes of an environment from a directory of
+     * pages, like those of a registry, memoized fragments included.
+     *
+     * @param env - The environment, e.g. `http_response::env` when no
+     * registry could be built.
+     * @param dir - The directory of the pages.
+     */
+    static void
+    resolve_includes(inja::Environment &env, const std::filesystem::path &dir);
+
+private:
+    /**
+     * @brief Only ever read once the registry is built. inja renders through
+     * non-const members, which do not modify it either.
+     */
+    mutable inja::Environment __env;
+
+    std::unordered_map<std::string, page, hfs::string_hash, std::equal_to<>>
+        __pages;
+
+    static std::string
+    __load(const std::filesystem::path &path);
+};
+} // namespace hfs
+
+#endif // __HTTP_TEMPLATES_H__
@@ -0,0 +1,64 @@
+#include <http_timing.h>
+
+namespace hfs
+{
+http_timing::http_timing() noexcept
+{
+    // The epoch of the steady clock stands for a phase not reached
+    this->__marks.fill(clock::time_point());
+}
+
+void
+http_timing::mark(phase which) noexcept
+{
+    this->__marks[which] = clock::now();
+}
+
+void
+http_timing::mark(phase which, clock::time_point at) noexcept
+{
+    this->__marks[which] = at;
+}
+
+bool
+http_timing::marked(phase which) const noexcept
+{
+    return this->__marks[which] != clock::time_point();
+}
+
+std::optional<std::chrono::microseconds>
+http_timing::elapsed(phase from, phase to) const noexcept
+{
+    if (!this->marked(from) || !this->marked(to))
+        return std::nullopt;
+
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        this->__marks[to] - this->__marks[from]
+    );
+}
+
+std::string
+http_timing::server_timing() const
+{
+    std::string value;
+
+    for (const auto &span : SPANS)
+    {
+        std::optional<std::chrono::microseconds> elapsed =
+            this->elapsed(span.from, span.to);
+
+        if (!elapsed.has_value())
+            continue;
+
+        char entry[64];
+        int len = std::snprintf(
+            entry, sizeof(entry), "%s%.*s;dur=%.3f", value.empty() ? "" : ", ",
+            (int)span.name.size(), span.name.data(), elapsed->count() / 1e3
+        );
+
+        value.append(entry, std::min<std::size_t>(len, sizeof(entry) - 1));
+    }
+
+    return value;
+}
+} // namespace hfs
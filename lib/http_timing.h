@@ -0,0 +1,98 @@
+#ifndef __HTTP_TIMING_H__
+#define __HTTP_TIMING_H__ 1
+
+#include <http_core.h>
+
+namespace hfs
+{
+/**
+ * @brief Monotonic timestamps of the phases of a request, from the accept of
+ * its connection to the last byte of its response.
+ *
+ * The phases are reported as spans between two of them, e.g. `parse` from
+ * the first byte received to the end of the header section, either in a
+ * `Server-Timing` response header or in the access log. Spans whose phases
+ * have not been reached, such as `render` for a static file, are left out.
+ */
+class http_timing
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    enum phase : std::size_t
+    {
+        ACCEPT,
+        FIRST_BYTE,
+        HEADERS_PARSED,
+        ROUTE_RESOLVED,
+        HANDLER_START,
+        RENDER_START,
+        RENDER_END,
+        HANDLER_END,
+        SERIALIZED,
+        LAST_BYTE,
+    };
+
+    static constexpr std::size_t PHASES = LAST_BYTE + 1;
+
+    struct span
+    {
+        std::string_view name;
+        phase from;
+        phase to;
+    };
+
+    static constexpr std::array<span, 7> SPANS = {{
+        {"wait",      ACCEPT,         FIRST_BYTE    },
+        {"parse",     FIRST_BYTE,     HEADERS_PARSED},
+        {"route",     HEADERS_PARSED, ROUTE_RESOLVED},
+        {"handler",   HANDLER_START,  HANDLER_END   },
+        {"render",    RENDER_START,   RENDER_END    },
+        {"serialize", HANDLER_END,    SERIALIZED    },
+        {"send",      SERIALIZED,     LAST_BYTE     },
+    }};
+
+    http_timing() noexcept;
+
+    /**
+     * @brief Record that a phase is reached now.
+     */
+    void
+    mark(phase which) noexcept;
+
+    /**
+     * @brief Record that a phase has been reached at a given time.
+     */
+    void
+    mark(phase which, clock::time_point at) noexcept;
+
+    bool
+    marked(phase which) const noexcept;
+
+    /**
+     * @brief Retrieve the time between two phases.
+     *
+     * @return `std::nullopt` if either phase has not been reached.
+     */
+    std::optional<std::chrono::microseconds>
+    elapsed(phase from, phase to) const noexcept;
+
+    /**
+     * @brief Format the spans reached so far as the value of a
+     * `Server-Timing` header, with durations in milliseconds.
+     *
+     * For example:
+     *
+     * ```
+     * wait;dur=0.031, parse;dur=0.012, route;dur=0.002, handler;dur=0.81
+     * ```
+     */
+    std::string
+    server_timing() const;
+
+private:
+    std::array<clock::time_point, PHASES> __marks;
+};
+} // namespace hfs
+
+#endif // __HTTP_TIMING_H__
@@ -0,0 +1,290 @@
+#include <http_trace.h>
+
+namespace hfs
+{
+struct __trace_event
+{
+    const char *name;
+    char detail[48];
+
+    /**
+     * @brief Nanoseconds since `__epoch`.
+     */
+    std::int64_t start;
+    std::int64_t duration;
+};
+
+/**
+ * @brief The events of one thread, as a ring that overwrites the oldest
+ * event. Only the owner thread writes, so its mutex is only contended while
+ * a dump copies the buffer.
+ */
+struct __trace_buffer
+{
+    std::mutex mutex;
+    std::size_t tid;
+    std::size_t next = 0;
+    std::size_t size = 0;
+    std::vector<__trace_event> events;
+};
+
+static const http_trace::clock::time_point __epoch = http_trace::clock::now();
+static std::atomic<bool> __started{false};
+
+static std::mutex __buffers_mutex;
+static std::vector<std::unique_ptr<__trace_buffer>> __buffers;
+
+static volatile std::sig_atomic_t __dump_requested = 0;
+static std::mutex __dump_mutex;
+static std::filesystem::path __dump_path;
+static std::once_flag __dump_thread;
+
+http_trace::span::span(const char *name, std::string_view detail) noexcept
+    : __name(name), __detail(detail)
+{
+    if (__started.load(std::memory_order_relaxed))
+        this->__start = clock::now();
+}
+
+http_trace::span::~span()
+{
+    if (this->__start != clock::time_point())
+        record(this->__name, this->__detail, this->__start, clock::now());
+}
+
+void
+http_trace::start() noexcept
+{
+    __started.store(true, std::memory_order_relaxed);
+}
+
+void
+http_trace::stop() noexcept
+{
+    __started.store(false, std::memory_order_relaxed);
+}
+
+bool
+http_trace::started() noexcept
+{
+    return __started.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Retrieve the buffer of the calling thread, creating it on the first
+ * call.
+ */
+static __trace_buffer *
+__buffer()
+{
+    thread_local __trace_buffer *buffer = nullptr;
+
+    if (buffer != nullptr)
+        return buffer;
+
+    auto owned = std::make_unique<__trace_buffer>();
+    owned->events.resize(http_trace::CAPACITY);
+
+    std::lock_guard<std::mutex> lock(__buffers_mutex);
+
+    owned->tid = __buffers.size() + 1;
+    buffer     = owned.get();
+    __buffers.push_back(std::move(owned));
+
+    return buffer;
+}
+
+void
+http_trace::record(
+    const char *name, std::string_view detail, clock::time_point start,
+    clock::time_point end
+) noexcept
+{
+    __trace_buffer *buffer;
+
+    try
+    {
+        buffer = __buffer();
+    }
+    catch (const std::bad_alloc &e)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    __trace_event &event = buffer->events[buffer->next];
+
+    std::size_t len = std::min(detail.size(), sizeof(event.detail) - 1);
+    std::memcpy(event.detail, detail.data(), len);
+    event.detail[len] = '\0';
+
+    event.name     = name;
+    event.start    = (start - __epoch).count();
+    event.duration = (end - start).count();
+
+    buffer->next = (buffer->next + 1) % CAPACITY;
+    buffer->size = std::min(buffer->size + 1, CAPACITY);
+}
+
+/**
+ * @brief Append a JSON string, escaping what has to be.
+ */
+static void
+__quote(std::string &out, std::string_view value)
+{
+    out.push_back('"');
+
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out.push_back('\\');
+            out.push_back(c);
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out.append(escaped);
+        }
+        else
+        {
+            out.push_back(c);
+        }
+    }
+
+    out.push_back('"');
+}
+
+std::string
+http_trace::chrome_json()
+{
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    std::vector<__trace_event> events;
+    std::vector<__trace_buffer *> buffers;
+    int pid = getpid();
+    bool first = true;
+
+    {
+        std::lock_guard<std::mutex> lock(__buffers_mutex);
+
+        for (const auto &buffer : __buffers)
+            buffers.push_back(buffer.get());
+    }
+
+    for (__trace_buffer *buffer : buffers)
+    {
+        {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            std::size_t oldest =
+                (buffer->next + CAPACITY - buffer->size) % CAPACITY;
+
+            events.clear();
+
+            for (std::size_t i = 0; i < buffer->size; i++)
+                events.push_back(buffer->events[(oldest + i) % CAPACITY]);
+        }
+
+        char line[160];
+        int len = std::snprintf(
+            line, sizeof(line),
+            "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%zu,"
+            "\"args\":{\"name\":\"thread %zu\"}}",
+            first ? "" : ",", pid, buffer->tid, buffer->tid
+        );
+
+        out.append(line, std::min<std::size_t>(len, sizeof(line) - 1));
+        first = false;
+
+        // Complete events ("X"), with timestamps in microseconds
+        for (const auto &event : events)
+        {
+            out.append(",{\"name\":");
+            __quote(out, event.name);
+
+            len = std::snprintf(
+                line, sizeof(line),
+                ",\"cat\":\"hfs\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                "\"pid\":%d,\"tid\":%zu",
+                event.start / 1e3, event.duration / 1e3, pid, buffer->tid
+            );
+            out.append(line, std::min<std::size_t>(len, sizeof(line) - 1));
+
+            if (event.detail[0] != '\0')
+            {
+                out.append(",\"args\":{\"detail\":");
+                __quote(out, event.detail);
+                out.push_back('}');
+            }
+
+            out.push_back('}');
+        }
+    }
+
+    out.append("]}\n");
+
+    return out;
+}
+
+void
+http_trace::dump(const std::filesystem::path &path)
+{
+    std::string json = chrome_json();
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+    if (!file.write(json.data(), json.size()))
+    {
+        throw std::runtime_error(hfs::format_function_error(
+            __FILE__, __LINE__, "Failed to write " + path.string()
+        ));
+    }
+}
+
+void
+http_trace::dump_on_signal(int signum, const std::filesystem::path &path)
+{
+    {
+        std::lock_guard<std::mutex> lock(__dump_mutex);
+        __dump_path = path;
+    }
+
+    // Writing a file is not async-signal-safe, so a thread polls the flag
+    std::call_once(
+        __dump_thread,
+        []()
+        {
+            std::thread(
+                []()
+                {
+                    for (;;)
+                    {
+                        std::this_thread::sleep_for(
+                            std::chrono::milliseconds(100)
+                        );
+
+                        if (!__dump_requested)
+                            continue;
+
+                        __dump_requested = 0;
+
+                        std::lock_guard<std::mutex> lock(__dump_mutex);
+
+                        try
+                        {
+                            dump(__dump_path);
+                            std::cerr << "trace: dumped to " << __dump_path
+                                      << std::endl;
+                        }
+                        catch (const std::runtime_error &e)
+                        {
+                            std::cerr << "trace: " << e.what() << std::endl;
+                        }
+                    }
+                }
+            ).detach();
+        }
+    );
+
+    signal(signum, [](int) { __dump_requested = 1; });
+}
+} // namespace hfs
@@ -0,0 +1,136 @@
+#ifndef __HTTP_TRACE_H__
+#define __HTTP_TRACE_H__ 1
+
+#include <http_core.h>
+
+namespace hfs
+{
+/**
+ * @brief Flight recorder of the stages of request handling, exported in the
+ * Chrome trace-event format (`chrome://tracing`, Perfetto).
+ *
+ * Spans are recorded into a buffer per thread that keeps the most recent
+ * events, so tracing can stay on in production and be dumped when a tail
+ * latency shows up. When tracing is stopped, a span costs a relaxed load.
+ * Building without `HFS_ENABLE_TRACING` removes the spans altogether.
+ *
+ * For example:
+ *
+ * @code
+ * ```cpp
+ * void
+ * handler(const hfs::http_request &req, hfs::http_response &res)
+ * {
+ *     HFS_TRACE_SPAN("query");
+ *     ...
+ * }
+ *
+ * hfs::http_trace::start();
+ * hfs::http_trace::dump_on_signal(SIGUSR2, "trace.json");
+ * ```
+ * @endcode
+ */
+class http_trace
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * @brief The number of most recent events kept per thread.
+     */
+    static constexpr std::size_t CAPACITY = 16384;
+
+    /**
+     * @brief Records the time between its construction and its destruction,
+     * if tracing was started at its construction.
+     */
+    class span
+    {
+    public:
+        /**
+         * @param name - A string with static storage duration.
+         * @param detail - Shown as the `detail` argument of the event, and
+         * truncated to a few dozen characters.
+         */
+        explicit span(const char *name, std::string_view detail = {}) noexcept;
+        ~span();
+
+        span(const span &) = delete;
+
+        span &
+        operator=(const span &) = delete;
+
+    private:
+        const char *__name;
+        std::string_view __detail;
+        clock::time_point __start;
+    };
+
+    /**
+     * @brief Start recording spans, in every thread.
+     */
+    static void
+    start() noexcept;
+
+    /**
+     * @brief Stop recording spans. Recorded events are kept.
+     */
+    static void
+    stop() noexcept;
+
+    static bool
+    started() noexcept;
+
+    /**
+     * @brief Record a span of the calling thread.
+     */
+    static void
+    record(
+        const char *name, std::string_view detail, clock::time_point start,
+        clock::time_point end
+    ) noexcept;
+
+    /**
+     * @brief Render the events of all threads as a Chrome trace-event JSON
+     * document. Each buffer is only locked while it is copied.
+     */
+    static std::string
+    chrome_json();
+
+    /**
+     * @brief Write `chrome_json()` to a file.
+     *
+     * @throw `std::runtime_error` - If the file cannot be written.
+     */
+    static void
+    dump(const std::filesystem::path &path);
+
+    /**
+     * @brief Dump the trace to a file every time a signal is received. The
+     * handler only raises a flag, the file is written by a background
+     * thread.
+     *
+     * @param signum - The signal, e.g. `SIGUSR2`.
+     * @param path - The file, overwritten on every dump.
+     */
+    static void
+    dump_on_signal(int signum, const std::filesystem::path &path);
+};
+} // namespace hfs
+
+#define __HFS_TRACE_CONCAT_IMPL(a, b) a##b
+#define __HFS_TRACE_CONCAT(a, b)      __HFS_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef HFS_ENABLE_TRACING
+/**
+ * @brief Trace the rest of the enclosing scope as a span.
+ */
+#define HFS_TRACE_SPAN(...)                                                    \
+    hfs::http_trace::span __HFS_TRACE_CONCAT(__hfs_span_, __LINE__)(           \
+        __VA_ARGS__                                                            \
+    )
+#else
+#define HFS_TRACE_SPAN(...) ((void)0)
+#endif
+
+#endif // __HTTP_TRACE_H__
@@ -2,74 +2,180 @@
 
 namespace hfs
 {
+/**
+ * @brief Classes of the characters allowed in a request target, from the
+ * ABNF of RFC 3986 Section 3.3 and 3.4. `%` is allowed by both classes and
+ * checked separately.
+ */
+static constexpr unsigned char __path_char  = 1 << 0;
+static constexpr unsigned char __query_char = 1 << 1;
+
+static constexpr std::array<unsigned char, 256> __char_classes = []()
+{
+    std::array<unsigned char, 256> classes{};
+
+    // unreserved / sub-delims / ":" / "@" / "/" / "%"
+    constexpr std::string_view path_chars = "abcdefghijklmnopqrstuvwxyz"
+                                            "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                            "0123456789-._~!$&'()*+,;=:@/%";
+
+    for (char c : path_chars)
+        classes[(unsigned char)c] |= __path_char | __query_char;
+
+    classes['?'] |= __query_char;
+
+    return classes;
+}();
+
+static bool
+__is_hex(char c) noexcept
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+           (c >= 'A' && c <= 'F');
+}
+
+/**
+ * @brief Scan the characters of a component of the class `cls` from
+ * `offset`, up to the first character in `stops` or the end of the string.
+ *
+ * @return `std::size_t` - The offset of the stop character.
+ * @throw `std::runtime_error` - If a character is not allowed or a percent
+ * sign is not followed by two hexadecimal digits.
+ */
+static std::size_t
+__scan(
+    std::string_view uri, std::size_t offset, unsigned char cls,
+    std::string_view stops
+)
+{
+    std::size_t i = offset;
+
+    for (; i < uri.size(); i++)
+    {
+        char c = uri[i];
+
+        if (stops.find(c) != std::string_view::npos)
+            break;
+
+        if (!(__char_classes[(unsigned char)c] & cls))
+        {
+            throw std::runtime_error(
+                "Invalid URI: unexpected character at #" + std::to_string(i) +
+                " in " + std::string(uri)
+            );
+        }
+
+        if (c == '%' &&
+            (i + 2 >= uri.size() || !__is_hex(uri[i + 1]) ||
+             !__is_hex(uri[i + 2])))
+        {
+            throw std::runtime_error(
+                "Invalid URI: malformed percent-encoding at #" +
+                std::to_string(i) + " in " + std::string(uri)
+            );
+        }
+    }
+
+    return i;
+}
+
 http_uri::http_uri()
 {
 }
 
 http_uri::http_uri(std::string_view uri) : __uri(uri)
 {
-    UriUriA *uri_a = this->parse(uri);
+    if (uri.empty())
+    {
+        throw std::runtime_error("Invalid URI: empty");
+    }
 
-    if (uri_a == nullptr)
+    // origin-form, by far the most common
+    if (uri.front() == '/')
     {
-        throw std::runtime_error("Invalid URI: " + std::string(uri));
+        this->__parse_origin_form(0);
+        this->__normalize();
+        return;
     }
 
-    this->__scheme =
-        uri_a->scheme.first
-            ? std::string(uri_a->scheme.first, uri_a->scheme.afterLast)
-            : "";
+    // asterisk-form, only used by `OPTIONS`
+    if (uri == "*")
+    {
+        this->__path = {0, 1};
+        return;
+    }
+
+    this->__parse_absolute_form();
+    this->__normalize();
+}
 
-    this->__host =
-        uri_a->hostText.first
-            ? std::string(uri_a->hostText.first, uri_a->hostText.afterLast)
-            : "";
+http_uri::~http_uri()
+{
+}
 
-    this->__port =
-        uri_a->portText.first
-            ? std::string(uri_a->portText.first, uri_a->portText.afterLast)
-            : "";
+void
+http_uri::__parse_origin_form(std::size_t offset)
+{
+    std::size_t end = __scan(this->__uri, offset, __path_char, "?#");
+    this->__path    = {offset, end - offset};
 
-    UriPathSegmentA *segment;
-    for (segment = uri_a->pathHead; segment != nullptr; segment = segment->next)
+    if (end < this->__uri.size() && this->__uri[end] == '?')
     {
-        this->__path.push_back(
-            std::string(segment->text.first, segment->text.afterLast)
-        );
-    }
+        std::size_t start = end + 1;
 
-    std::string query =
-        uri_a->query.first
-            ? std::string(uri_a->query.first, uri_a->query.afterLast)
-            : "";
+        end           = __scan(this->__uri, start, __query_char, "#");
+        this->__query = {start, end - start};
+    }
 
-    // Parser the query string
-    std::istringstream query_stream(query);
-    for (std::string part; std::getline(query_stream, part, '&');)
+    if (end < this->__uri.size())
     {
-        std::istringstream part_stream(part);
-        std::string key, value;
+        std::size_t start = end + 1;
 
-        if (std::getline(part_stream, key, '='))
-        {
-            if (std::getline(part_stream, value))
-            {
-                this->__query[key] = value;
-            }
-        }
+        end = __scan(this->__uri, start, __query_char, "");
+        this->__fragment = {start, end - start};
     }
+}
 
-    this->__fragment =
-        uri_a->fragment.first
-            ? std::string(uri_a->fragment.first, uri_a->fragment.afterLast)
-            : "";
+void
+http_uri::__parse_absolute_form()
+{
+    UriUriA *uri_a = http_uri::parse(this->__uri);
+    const char *base = this->__uri.data();
+
+    auto to_component = [base](const UriTextRangeA &range)
+    {
+        return range.first ? component{(std::size_t)(range.first - base),
+                                        (std::size_t)(range.afterLast -
+                                                      range.first)}
+                           : component{};
+    };
+
+    this->__scheme = to_component(uri_a->scheme);
+    this->__host   = to_component(uri_a->hostText);
+    this->__port   = to_component(uri_a->portText);
 
     uriFreeUriMembersA(uri_a);
     delete uri_a;
+
+    if (this->__scheme.length == 0 || this->__host.length == 0)
+    {
+        throw std::runtime_error("Invalid URI: not absolute: " + this->__uri);
+    }
+
+    // The path starts right after the authority, which uriparser has
+    // validated already.
+    std::size_t authority =
+        this->__scheme.offset + this->__scheme.length + sizeof("://") - 1;
+
+    std::size_t path = this->__uri.find_first_of("/?#", authority);
+
+    this->__parse_origin_form(std::min(path, this->__uri.size()));
 }
 
-http_uri::~http_uri()
+std::string_view
+http_uri::__view(const component &c) const noexcept
 {
+    return std::string_view(this->__uri).substr(c.offset, c.length);
 }
 
 std::string_view
@@ -81,51 +187,204 @@ http_uri::uri() const noexcept
 std::string_view
 http_uri::path() const noexcept
 {
-    std::stringstream path_stream;
+    if (this->__normalized_path.has_value())
+        return *this->__normalized_path;
+
+    return this->raw_path();
+}
+
+std::string_view
+http_uri::raw_path() const noexcept
+{
+    if (this->__path.length == 0)
+        return "/";
+
+    return this->__view(this->__path);
+}
+
+/**
+ * @brief Check a block of 16 bytes for a `%`, or a `/` followed by `.` or
+ * `/`. `next` is the same block shifted by one byte.
+ */
+#ifdef __SSE2__
+static bool
+__has_special(__m128i block, __m128i next) noexcept
+{
+    const __m128i slash   = _mm_set1_epi8('/');
+    const __m128i dot     = _mm_set1_epi8('.');
+    const __m128i percent = _mm_set1_epi8('%');
+
+    __m128i after_slash =
+        _mm_or_si128(_mm_cmpeq_epi8(next, dot), _mm_cmpeq_epi8(next, slash));
+    __m128i special = _mm_or_si128(
+        _mm_and_si128(_mm_cmpeq_epi8(block, slash), after_slash),
+        _mm_cmpeq_epi8(block, percent)
+    );
+
+    return _mm_movemask_epi8(special) != 0;
+}
+#endif
+
+bool
+http_uri::is_normalized(std::string_view path) noexcept
+{
+    std::size_t i = 0;
 
-    for (const auto &part : this->__path)
+#ifdef __SSE2__
+    // 17 bytes are needed to look at the byte after each of the 16
+    for (; i + 17 <= path.size(); i += 16)
     {
-        path_stream << "/" << part;
+        __m128i block =
+            _mm_loadu_si128((const __m128i *)(path.data() + i));
+        __m128i next =
+            _mm_loadu_si128((const __m128i *)(path.data() + i + 1));
+
+        if (__has_special(block, next))
+            return false;
+    }
+#endif
+
+    for (; i < path.size(); i++)
+    {
+        if (path[i] == '%')
+            return false;
+
+        if (path[i] == '/' && i + 1 < path.size() &&
+            (path[i + 1] == '.' || path[i + 1] == '/'))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int
+__hex_value(char c) noexcept
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+
+    return c - 'A' + 10;
+}
+
+std::string
+http_uri::normalize_path(std::string_view path)
+{
+    std::string out = "/";
+    std::size_t segment = 1;
+
+    out.reserve(path.size());
+
+    // Resolve the segment that has just been written, from `segment` to the
+    // end of `out`, once its end is known.
+    auto end_segment = [&out, &segment](bool last)
+    {
+        std::string_view name = std::string_view(out).substr(segment);
+
+        if (name.empty())
+            return;
+
+        if (name == ".")
+        {
+            out.resize(segment);
+        }
+        else if (name == "..")
+        {
+            out.resize(segment);
+
+            if (segment > 1)
+                out.resize(out.rfind('/', segment - 2) + 1);
+
+            segment = out.size();
+        }
+        else if (!last)
+        {
+            out.push_back('/');
+            segment = out.size();
+        }
+    };
+
+    for (std::size_t i = 0; i < path.size(); i++)
+    {
+        char c = path[i];
+
+        if (c == '%' && i + 2 < path.size())
+        {
+            c = (char)((__hex_value(path[i + 1]) << 4) |
+                       __hex_value(path[i + 2]));
+            i += 2;
+
+            if (c == '\0')
+            {
+                throw std::runtime_error("Invalid URI: encoded NUL in path");
+            }
+        }
+
+        if (c == '/')
+            end_segment(false);
+        else
+            out.push_back(c);
     }
 
-    return path_stream.str();
+    end_segment(true);
+
+    return out;
+}
+
+void
+http_uri::__normalize()
+{
+    std::string_view raw = this->raw_path();
+
+    if (raw.front() != '/' || is_normalized(raw))
+        return;
+
+    this->__normalized_path = normalize_path(raw);
 }
 
 std::string_view
 http_uri::query(std::string_view key) const noexcept
 {
-    auto it = this->__query.find(std::string(key));
-
-    if (it == this->__query.end())
+    for (const auto &field : this->query())
     {
-        return "";
+        if (field.key == key)
+            return field.value;
     }
 
-    return it->second;
+    return "";
+}
+
+http_form
+http_uri::query() const noexcept
+{
+    return http_form(this->__view(this->__query));
 }
 
 std::string_view
 http_uri::fragment() const noexcept
 {
-    return this->__fragment;
+    return this->__view(this->__fragment);
 }
 
 std::string_view
 http_uri::scheme() const noexcept
 {
-    return this->__scheme;
+    return this->__view(this->__scheme);
 }
 
 std::string_view
 http_uri::host() const noexcept
 {
-    return this->__host;
+    return this->__view(this->__host);
 }
 
 std::string_view
 http_uri::port() const noexcept
 {
-    return this->__port;
+    return this->__view(this->__port);
 }
 
 UriUriA *
@@ -135,14 +394,16 @@ http_uri::parse(std::string_view uri)
     const char *uri_str = uri.data();
     const char *error_pos;
 
-    if (uriParseSingleUriA(uri_a, uri_str, &error_pos) != URI_SUCCESS)
+    if (uriParseSingleUriExA(
+            uri_a, uri_str, uri_str + uri.size(), &error_pos
+        ) != URI_SUCCESS)
     {
         uriFreeUriMembersA(uri_a);
         delete uri_a;
 
         throw std::runtime_error(
             "Invalid URI (liburiparser): syntax @ '" +
-            std::string(error_pos, 18) + "' (#" +
+            std::string(error_pos, uri_str + uri.size() - error_pos) + "' (#" +
             std::to_string(error_pos - uri.data()) + ")"
         );
     }
@@ -150,27 +411,34 @@ http_uri::parse(std::string_view uri)
     return uri_a;
 }
 
+bool
+http_uri::next_segment(
+    std::string_view &path, std::string_view &segment
+) noexcept
+{
+    while (!path.empty() && path.front() == '/')
+        path.remove_prefix(1);
+
+    if (path.empty())
+        return false;
+
+    std::size_t slash = path.find('/');
+
+    segment = path.substr(0, slash);
+    path    = slash == std::string_view::npos ? "" : path.substr(slash);
+
+    return true;
+}
+
 std::vector<std::string>
 http_uri::split_path(std::string_view path)
 {
-    UriUriA *uri_a = http_uri::parse(path);
-    if (uri_a == nullptr)
-    {
-        throw std::runtime_error("Invalid path: " + std::string(path));
-    }
-
+    http_uri uri(path);
     std::vector<std::string> segments;
-    UriPathSegmentA *segment;
-
-    for (segment = uri_a->pathHead; segment != nullptr; segment = segment->next)
-    {
-        segments.push_back(
-            std::string(segment->text.first, segment->text.afterLast)
-        );
-    }
+    std::string_view rest = uri.path(), segment;
 
-    uriFreeUriMembersA(uri_a);
-    delete uri_a;
+    while (next_segment(rest, segment))
+        segments.push_back(std::string(segment));
 
     return segments;
 }
@@ -2,6 +2,7 @@
 #define __HTTP_URI_H__ 1
 
 #include <http_core.h>
+#include <http_form.h>
 
 namespace hfs
 {
@@ -16,9 +17,16 @@ public:
     http_uri();
 
     /**
-     * @brief Construct a new http_uri object based on the given URI string.
+     * @brief Construct a new http_uri object based on the given request
+     * target, as defined in RFC 9112 Section 3.2.
+     *
+     * The origin-form (`/path?query`) and the asterisk-form (`*`) are split
+     * in a single pass without any allocation besides the copy of the target.
+     * Only the absolute-form (`http://host/path`), sent to proxies, goes
+     * through uriparser.
      *
      * @param uri - The raw URI string that suffices the RFC 3986 standard.
+     * @throw `std::runtime_error` - If the target is malformed.
      */
     explicit http_uri(std::string_view uri);
 
@@ -38,7 +46,8 @@ public:
 
     /**
      * @brief Static method to split and return the path segments of the URI
-     * for iteration.
+     * for iteration. Prefer `next_segment` on hot paths, which does not
+     * allocate.
      *
      * @param uri - The raw URI string that suffices the RFC 3986 standard.
      * @return std::vector<std::string>
@@ -46,6 +55,28 @@ public:
     static std::vector<std::string>
     split_path(std::string_view uri);
 
+    /**
+     * @brief Pop the first segment of a path. Empty segments, as in `a//b`
+     * or in a trailing slash, are skipped.
+     *
+     * For example:
+     *
+     * @code
+     * ```cpp
+     * std::string_view path = "/blogs/hello-world", segment;
+     *
+     * while (http_uri::next_segment(path, segment))
+     *     std::cout << segment << std::endl; // Output: blogs, hello-world
+     * ```
+     * @endcode
+     *
+     * @param path - The rest of the path, updated past the segment.
+     * @param segment - The segment, as a view over `path`.
+     * @return `false` if there is no segment left.
+     */
+    static bool
+    next_segment(std::string_view &path, std::string_view &segment) noexcept;
+
     /**
      * @brief Return the string representation of the raw URI.
      *
@@ -55,15 +86,14 @@ public:
     uri() const noexcept;
 
     /**
-     * @brief Return the string representation of the path segments of the URI.
-     * If the path is empty, then return `/`. If there are multiple segments,
-     * then return the segments separated by `/`.
+     * @brief Return the path of the URI, percent-decoded and normalized by
+     * `normalize_path`. If the path is empty, then return `/`.
      *
      * For example:
      *
      * @code
      * ```cpp
-     * http_uri uri("http://localhost:8080/index.html");
+     * http_uri uri("http://localhost:8080/css/../index%2Ehtml");
      *
      * std::cout << uri.path() << std::endl; // Output: /index.html
      * ```
@@ -75,9 +105,47 @@ public:
     std::string_view
     path() const noexcept;
 
+    /**
+     * @brief Return the path of the URI as sent, still percent-encoded.
+     *
+     * @return std::string_view
+     */
+    std::string_view
+    raw_path() const noexcept;
+
+    /**
+     * @brief Percent-decode an absolute path and remove its dot-segments, as
+     * defined in RFC 3986 Section 5.2.4, in a single pass. Empty segments are
+     * collapsed, and `..` never goes above the root, so that the result can
+     * be appended to a directory safely. `+` is not a space in a path.
+     *
+     * For example:
+     *
+     * @code
+     * ```cpp
+     * http_uri::normalize_path("//a/./b/../%63"); // "/a/c"
+     * ```
+     * @endcode
+     *
+     * @param path - A path starting with `/`, with valid percent-encoding.
+     * @return std::string
+     * @throw `std::runtime_error` - If the path contains an encoded NUL.
+     */
+    static std::string
+    normalize_path(std::string_view path);
+
+    /**
+     * @brief Check whether a path is normalized already, i.e. it has no
+     * percent-encoding, no empty segment and no dot-segment. Most paths are,
+     * which spares them a copy.
+     */
+    static bool
+    is_normalized(std::string_view path) noexcept;
+
     /**
      * @brief Retrieve the query parameter based on the given key. If the key
-     * does not exist, then return an empty string.
+     * does not exist, then return an empty string. The value is returned as
+     * sent, still percent-encoded; `query()` gives the decoded values.
      *
      * For example:
      *
@@ -97,6 +165,25 @@ public:
     std::string_view
     query(std::string_view key) const noexcept;
 
+    /**
+     * @brief Return a lazy view of the parameters of the query string. The
+     * view is valid as long as the URI object.
+     *
+     * For example:
+     *
+     * @code
+     * ```cpp
+     * http_uri uri("/search?q=hello+world&page=2");
+     *
+     * std::cout << *uri.query().get("q") << std::endl; // Output: hello world
+     * ```
+     * @endcode
+     *
+     * @return http_form
+     */
+    http_form
+    query() const noexcept;
+
     /**
      * @brief Return the fragment of the URI.
      *
@@ -116,7 +203,7 @@ public:
     fragment() const noexcept;
 
     /**
-     * @brief Return the scheme of the URI.current_date
+     * @brief Return the scheme of the URI.
      *
      * For example:
      *
@@ -170,13 +257,36 @@ public:
     port() const noexcept;
 
 private:
+    /**
+     * @brief A part of `__uri`. Offsets are stored rather than views, so that
+     * copies of the object stay valid.
+     */
+    struct component
+    {
+        std::size_t offset = 0;
+        std::size_t length = 0;
+    };
+
     std::string __uri;
-    std::vector<std::string> __path;
-    std::unordered_map<std::string, std::string> __query;
-    std::string __fragment;
-    std::string __scheme;
-    std::string __host;
-    std::string __port;
+    std::optional<std::string> __normalized_path;
+    component __path;
+    component __query;
+    component __fragment;
+    component __scheme;
+    component __host;
+    component __port;
+
+    std::string_view
+    __view(const component &c) const noexcept;
+
+    void
+    __parse_origin_form(std::size_t offset);
+
+    void
+    __parse_absolute_form();
+
+    void
+    __normalize();
 };
 } // namespace hfs
 
@@ -1,10 +1,13 @@
 #include "multi_thread_http_server.h"
 
 int
-main()
+main(int argc, char *argv[])
 {
+    // The port can be overridden, e.g. to run next to another instance
+    int port = argc > 1 ? std::atoi(argv[1]) : 7000;
+
     hfs::http_server_base *server = new hfs::multi_thread_http_server();
-    server->listen(7000);
+    server->listen(port);
     server->start();
 
     server->register_handler(
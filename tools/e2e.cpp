@@ -0,0 +1,557 @@
+#include <http_core.h>
+
+struct engine
+{
+    std::string name;
+    std::string executable;
+};
+
+struct scenario
+{
+    std::string name;
+    std::string method;
+    std::string target;
+    std::string body;
+    std::vector<std::string> headers;
+};
+
+/**
+ * @brief The server executables built by this tree. Those that do not accept
+ * connections are reported as skipped.
+ */
+static const std::vector<engine> engines = {
+    {"blocking",      "blocking-http-server"    },
+    {"multi-thread",  "multithread-http-server" },
+    {"multi-process", "multiprocess-http-server"},
+};
+
+/**
+ * @brief Requests covering the main paths of a server, against the routes
+ * and the assets of the demo servers.
+ */
+static const std::vector<scenario> scenarios = {
+    {"static-small", "GET", "/favicon.ico", "", {}},
+    {"static-large", "GET", "/css/bootstrap/bootstrap.css.map", "", {}},
+    {"rendered", "GET", "/about", "", {}},
+    {"param-route", "GET", "/blogs/hello-world", "", {}},
+    {"not-found", "GET", "/does/not/exist", "", {}},
+    {"post-body",
+     "POST",
+     "/login",
+     "email=john%40doe.com&password=1234",
+     {"Content-Type: application/x-www-form-urlencoded"}},
+};
+
+struct options
+{
+    std::filesystem::path bin_dir;
+    int port                 = 7100;
+    std::size_t connections  = 8;
+    double duration          = 5;
+    std::string engine_filter;
+    std::string scenario_filter;
+    std::string json;
+};
+
+/**
+ * @brief The resources used by a server, summed over its process and its
+ * direct children, so that pre-forked workers count.
+ */
+struct usage
+{
+    double cpu_seconds = 0;
+    std::size_t rss_kb = 0;
+};
+
+/**
+ * @brief Read the CPU time and the resident set of one process from
+ * `/proc`, and return its parent.
+ */
+static pid_t
+read_process(pid_t pid, usage &total)
+{
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+
+    if (!std::getline(stat, line))
+        return -1;
+
+    // The command name may contain spaces, the fields start after it
+    std::size_t paren = line.rfind(')');
+
+    if (paren == std::string::npos)
+        return -1;
+
+    std::istringstream fields(line.substr(paren + 2));
+    std::string state;
+    pid_t ppid;
+    unsigned long utime, stime;
+    std::string skip;
+
+    fields >> state >> ppid;
+
+    // Fields 5 to 13 of proc(5), then utime and stime
+    for (int i = 0; i < 9; i++)
+        fields >> skip;
+
+    fields >> utime >> stime;
+
+    if (!fields)
+        return -1;
+
+    total.cpu_seconds += (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 6, "VmRSS:") == 0)
+        {
+            total.rss_kb += std::strtoul(line.c_str() + 6, nullptr, 10);
+            break;
+        }
+    }
+
+    return ppid;
+}
+
+static usage
+measure_usage(pid_t server)
+{
+    usage total;
+    std::error_code ec;
+
+    read_process(server, total);
+
+    for (const auto &entry : std::filesystem::directory_iterator("/proc", ec))
+    {
+        std::string name = entry.path().filename().string();
+
+        if (name.find_first_not_of("0123456789") != std::string::npos ||
+            std::stoi(name) == server)
+        {
+            continue;
+        }
+
+        usage child;
+
+        if (read_process(std::stoi(name), child) == server)
+        {
+            total.cpu_seconds += child.cpu_seconds;
+            total.rss_kb += child.rss_kb;
+        }
+    }
+
+    return total;
+}
+
+/**
+ * @brief Start a server from the binary directory, so that it finds the
+ * assets at `../public` like when it is run by hand.
+ */
+static pid_t
+start_server(const options &opts, const engine &eng)
+{
+    std::string path = (opts.bin_dir / eng.executable).string();
+    std::string port = std::to_string(opts.port);
+    pid_t pid        = fork();
+
+    if (pid != 0)
+        return pid;
+
+    int null = open("/dev/null", O_WRONLY);
+
+    if (chdir(opts.bin_dir.c_str()) == -1 || null == -1)
+        _exit(127);
+
+    dup2(null, STDOUT_FILENO);
+    dup2(null, STDERR_FILENO);
+
+    execl(path.c_str(), path.c_str(), port.c_str(), (char *)nullptr);
+    _exit(127);
+}
+
+static bool
+alive(pid_t pid)
+{
+    int status;
+
+    return waitpid(pid, &status, WNOHANG) == 0;
+}
+
+/**
+ * @brief Wait until the server accepts connections on the loopback, or
+ * exits.
+ */
+static bool
+wait_listening(pid_t pid, int port)
+{
+    struct sockaddr_in addr;
+
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    for (int attempt = 0; attempt < 100 && alive(pid); attempt++)
+    {
+        int sock = socket(AF_INET, SOCK_STREAM, 0);
+        bool connected =
+            connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+
+        close(sock);
+
+        if (connected)
+            return true;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    return false;
+}
+
+static void
+stop_server(pid_t pid)
+{
+    kill(pid, SIGTERM);
+
+    for (int attempt = 0; attempt < 40; attempt++)
+    {
+        if (waitpid(pid, nullptr, WNOHANG) != 0)
+            return;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+}
+
+/**
+ * @brief Run `hfs-load --json` and parse what it prints.
+ */
+static std::optional<nlohmann::json>
+run_load(const options &opts, const std::vector<std::string> &args)
+{
+    std::string path = (opts.bin_dir / "hfs-load").string();
+    int fds[2];
+
+    if (pipe(fds) == -1)
+        return std::nullopt;
+
+    pid_t pid = fork();
+
+    if (pid == -1)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return std::nullopt;
+    }
+
+    if (pid == 0)
+    {
+        std::vector<char *> argv = {path.data()};
+
+        for (const auto &arg : args)
+            argv.push_back(const_cast<char *>(arg.c_str()));
+
+        argv.push_back(nullptr);
+
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+
+        execv(path.c_str(), argv.data());
+        _exit(127);
+    }
+
+    close(fds[1]);
+
+    std::string output;
+    char buf[hfs::HTTP_BUFSZ];
+    ssize_t n;
+
+    while ((n = read(fds[0], buf, sizeof(buf))) > 0 ||
+           (n == -1 && errno == EINTR))
+    {
+        if (n > 0)
+            output.append(buf, n);
+    }
+
+    close(fds[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return std::nullopt;
+
+    nlohmann::json result = nlohmann::json::parse(output, nullptr, false);
+
+    if (result.is_discarded())
+        return std::nullopt;
+
+    return result;
+}
+
+static std::vector<std::string>
+load_args(const options &opts, const scenario &scen, bool keep_alive)
+{
+    std::vector<std::string> args = {
+        "-c", std::to_string(opts.connections), "-d",
+        std::to_string(opts.duration), "-m", scen.method, "--json",
+    };
+
+    if (!keep_alive)
+        args.push_back("-K");
+
+    if (!scen.body.empty())
+    {
+        args.push_back("-b");
+        args.push_back(scen.body);
+    }
+
+    for (const auto &header : scen.headers)
+    {
+        args.push_back("-H");
+        args.push_back(header);
+    }
+
+    args.push_back(
+        "http://127.0.0.1:" + std::to_string(opts.port) + scen.target
+    );
+
+    return args;
+}
+
+static void
+print_header()
+{
+    std::printf(
+        "%-14s %-13s %-10s %10s %9s %9s %9s %7s %7s %6s %8s\n", "engine",
+        "scenario", "connection", "req/s", "p50", "p99", "p99.9", "errors",
+        "non-2xx", "cpu", "rss"
+    );
+}
+
+static void
+print_row(const nlohmann::ordered_json &row)
+{
+    if (row.contains("skipped"))
+    {
+        std::printf(
+            "%-14s %-13s %-10s %s\n", row["engine"].get<std::string>().c_str(),
+            row.value("scenario", "-").c_str(),
+            row.value("connection", "-").c_str(),
+            row["skipped"].get<std::string>().c_str()
+        );
+        return;
+    }
+
+    std::printf(
+        "%-14s %-13s %-10s %10.1f %7.3fms %7.3fms %7.3fms %7zu %7zu %5.0f%% "
+        "%6.1fMB\n",
+        row["engine"].get<std::string>().c_str(),
+        row["scenario"].get<std::string>().c_str(),
+        row["connection"].get<std::string>().c_str(), row["rps"].get<double>(),
+        row["p50_us"].get<double>() / 1e3, row["p99_us"].get<double>() / 1e3,
+        row["p99.9_us"].get<double>() / 1e3, row["errors"].get<std::size_t>(),
+        row["non_2xx"].get<std::size_t>(), row["cpu_percent"].get<double>(),
+        row["rss_kb"].get<std::size_t>() / 1024.0
+    );
+    std::fflush(stdout);
+}
+
+/**
+ * @brief Run every scenario against one engine, restarting the server if a
+ * scenario brings it down.
+ */
+static void
+bench_engine(
+    const options &opts, const engine &eng, nlohmann::ordered_json &rows
+)
+{
+    pid_t server = start_server(opts, eng);
+
+    if (!wait_listening(server, opts.port))
+    {
+        nlohmann::ordered_json row = {
+            {"engine",  eng.name                                },
+            {"skipped", "the server does not accept connections"},
+        };
+
+        print_row(row);
+        rows.push_back(row);
+
+        if (alive(server))
+            stop_server(server);
+
+        return;
+    }
+
+    for (const auto &scen : scenarios)
+    {
+        if (scen.name.find(opts.scenario_filter) == std::string::npos)
+            continue;
+
+        for (bool keep_alive : {true, false})
+        {
+            nlohmann::ordered_json row = {
+                {"engine",     eng.name                          },
+                {"scenario",   scen.name                         },
+                {"connection", keep_alive ? "keep-alive" : "close"},
+            };
+
+            if (!alive(server))
+            {
+                server = start_server(opts, eng);
+
+                if (!wait_listening(server, opts.port))
+                {
+                    row["skipped"] = "the server cannot be restarted";
+                    print_row(row);
+                    rows.push_back(row);
+                    continue;
+                }
+            }
+
+            usage before = measure_usage(server);
+            auto start   = std::chrono::steady_clock::now();
+            std::optional<nlohmann::json> result =
+                run_load(opts, load_args(opts, scen, keep_alive));
+            std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start;
+            usage after = measure_usage(server);
+
+            if (!result.has_value())
+            {
+                row["skipped"] = "hfs-load failed";
+                print_row(row);
+                rows.push_back(row);
+                continue;
+            }
+
+            const nlohmann::json &errors  = (*result)["errors"];
+            const nlohmann::json &status  = (*result)["status"];
+            const nlohmann::json &latency = (*result)["latency_us"];
+            std::size_t requests = (*result)["requests"].get<std::size_t>();
+
+            row["rps"]         = (*result)["rps"];
+            row["requests"]    = requests;
+            row["p50_us"]      = latency["p50"];
+            row["p99_us"]      = latency["p99"];
+            row["p99.9_us"]    = latency["p99.9"];
+            row["errors"]      = errors["connect"].get<std::size_t>() +
+                            errors["read"].get<std::size_t>();
+            row["non_2xx"]     = requests - status["2xx"].get<std::size_t>();
+            row["cpu_percent"] = (after.cpu_seconds - before.cpu_seconds) /
+                                 elapsed.count() * 100;
+            row["rss_kb"]      = after.rss_kb;
+
+            print_row(row);
+            rows.push_back(row);
+        }
+    }
+
+    if (alive(server))
+        stop_server(server);
+}
+
+static void
+usage_text()
+{
+    std::cerr
+        << "usage: hfs-e2e [options]\n"
+        << "  -e TEXT      run the engines whose name contains TEXT\n"
+        << "  -s TEXT      run the scenarios whose name contains TEXT\n"
+        << "  -c N         connections of the load generator (default 8)\n"
+        << "  -d SECONDS   duration of each scenario (default 5)\n"
+        << "  -p PORT      loopback port of the servers (default 7100)\n"
+        << "  --json FILE  write the results as JSON\n";
+}
+
+int
+main(int argc, char *argv[])
+{
+    options opts;
+    std::error_code ec;
+
+    // The servers and hfs-load are built next to this executable
+    opts.bin_dir = std::filesystem::read_symlink("/proc/self/exe", ec)
+                       .parent_path();
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value  = i + 1 < argc;
+
+        if (arg == "-e" && has_value)
+            opts.engine_filter = argv[++i];
+        else if (arg == "-s" && has_value)
+            opts.scenario_filter = argv[++i];
+        else if (arg == "-c" && has_value)
+            opts.connections = std::max(1l, std::atol(argv[++i]));
+        else if (arg == "-d" && has_value)
+            opts.duration = std::atof(argv[++i]);
+        else if (arg == "-p" && has_value)
+            opts.port = std::atoi(argv[++i]);
+        else if (arg == "--json" && has_value)
+            opts.json = argv[++i];
+        else if (arg == "-h" || arg == "--help")
+        {
+            usage_text();
+            return EXIT_SUCCESS;
+        }
+        else
+        {
+            usage_text();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (ec)
+    {
+        std::cerr << "hfs-e2e: cannot locate the binaries: " << ec.message()
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    nlohmann::ordered_json rows = nlohmann::ordered_json::array();
+
+    print_header();
+
+    for (const auto &eng : engines)
+    {
+        if (eng.name.find(opts.engine_filter) == std::string::npos)
+            continue;
+
+        if (!std::filesystem::exists(opts.bin_dir / eng.executable, ec))
+        {
+            std::cerr << "hfs-e2e: " << eng.executable << " is not built"
+                      << std::endl;
+            continue;
+        }
+
+        bench_engine(opts, eng, rows);
+    }
+
+    if (!opts.json.empty())
+    {
+        nlohmann::ordered_json out = {
+            {"context",
+             {{"date", hfs::format_date(std::time(nullptr))},
+              {"connections", opts.connections},
+              {"duration", opts.duration},
+              {"num_cpus", std::thread::hardware_concurrency()}}},
+            {"results", rows},
+        };
+
+        if (!(std::ofstream(opts.json) << out.dump(2) << std::endl))
+        {
+            std::cerr << "hfs-e2e: cannot write " << opts.json << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,859 @@
+#include <http_client.h>
+#include <http_histogram.h>
+
+using clock_type = std::chrono::steady_clock;
+
+struct options
+{
+    std::string host;
+    std::string port = "80";
+    std::string target = "/";
+    std::string method = "GET";
+    std::string body;
+    std::vector<std::pair<std::string, std::string>> headers;
+
+    std::size_t connections = 16;
+    std::optional<std::chrono::milliseconds> duration;
+    std::chrono::milliseconds timeout{5000};
+    std::size_t depth = 1;
+    bool keep_alive   = true;
+    bool json         = false;
+
+    /**
+     * @brief The total arrival rate in requests per second, or 0 for the
+     * closed loop.
+     */
+    double rate = 0;
+
+    /**
+     * @brief The traffic file to replay, if any.
+     */
+    std::filesystem::path replay;
+
+    /**
+     * @brief How much faster than recorded the traffic is replayed, or 0 to
+     * replay it as fast as possible.
+     */
+    double speed = 1;
+};
+
+/**
+ * @brief One request of a traffic file, serialized for the target server.
+ */
+struct replay_entry
+{
+    double timestamp;
+    std::string request;
+    std::size_t type;
+    bool head;
+};
+
+/**
+ * @brief A traffic file, with its requests in the order of their timestamps.
+ * Workers take the next request from the shared cursor.
+ */
+struct replay_plan
+{
+    std::vector<replay_entry> entries;
+    std::vector<std::string> types;
+    std::atomic<std::size_t> next{0};
+};
+
+/**
+ * @brief The latencies of one type of request in a replay.
+ */
+struct type_results
+{
+    std::size_t requests = 0;
+    std::size_t errors   = 0;
+    hfs::http_histogram latency;
+};
+
+/**
+ * @brief What one connection has measured. Each worker owns its own, they are
+ * merged once all workers are done.
+ */
+struct results
+{
+    std::size_t requests = 0;
+    std::size_t bytes    = 0;
+    std::size_t connects = 0;
+    std::size_t connect_errors = 0;
+    std::size_t read_errors    = 0;
+    std::array<std::size_t, 6> status{};
+
+    /**
+     * @brief In the open loop, measured from the time each request should
+     * have been sent, so that a stalled server is charged for the requests
+     * it has delayed (coordinated omission).
+     */
+    hfs::http_histogram latency;
+
+    /**
+     * @brief In the open loop, measured from the time each request was
+     * actually sent.
+     */
+    hfs::http_histogram uncorrected;
+
+    /**
+     * @brief In a replay, indexed like `replay_plan::types`.
+     */
+    std::vector<type_results> types;
+
+    void
+    merge(const results &other)
+    {
+        requests += other.requests;
+        bytes += other.bytes;
+        connects += other.connects;
+        connect_errors += other.connect_errors;
+        read_errors += other.read_errors;
+
+        for (std::size_t i = 0; i < status.size(); i++)
+            status[i] += other.status[i];
+
+        latency.merge(other.latency);
+        uncorrected.merge(other.uncorrected);
+
+        types.resize(std::max(types.size(), other.types.size()));
+
+        for (std::size_t i = 0; i < other.types.size(); i++)
+        {
+            types[i].requests += other.types[i].requests;
+            types[i].errors += other.types[i].errors;
+            types[i].latency.merge(other.types[i].latency);
+        }
+    }
+};
+
+static std::atomic<bool> stop{false};
+static std::atomic<std::size_t> finished{0};
+
+static std::uint64_t
+micros(clock_type::duration d)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+/**
+ * @brief Make sure the client is connected. Failures are counted and slowed
+ * down, so that a server that refuses connections is not hammered.
+ */
+static bool
+ensure_connected(hfs::http_client &client, results &res)
+{
+    if (client.connected())
+        return true;
+
+    try
+    {
+        client.connect();
+        res.connects++;
+        return true;
+    }
+    catch (const std::runtime_error &e)
+    {
+        res.connect_errors++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return false;
+    }
+}
+
+static void
+count_response(const hfs::http_client::response &response, results &res)
+{
+    res.requests++;
+    res.bytes += response.size;
+    res.status[std::min<std::size_t>(response.status / 100, 5)]++;
+}
+
+/**
+ * @brief Keep `depth` requests in flight on one connection, sending the next
+ * batch as soon as the previous one is answered.
+ */
+static void
+closed_loop(const options &opts, const std::string &request, results &res)
+{
+    hfs::http_client client(opts.host, opts.port);
+    std::string batch;
+    bool head = opts.method == "HEAD";
+
+    client.timeout(opts.timeout);
+
+    for (std::size_t i = 0; i < opts.depth; i++)
+        batch += request;
+
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        if (!ensure_connected(client, res))
+            continue;
+
+        auto sent = clock_type::now();
+
+        try
+        {
+            client.send(batch);
+
+            for (std::size_t i = 0; i < opts.depth; i++)
+            {
+                hfs::http_client::response response = client.receive(head);
+
+                res.latency.record(micros(clock_type::now() - sent));
+                count_response(response, res);
+
+                // The rest of the batch is lost with the connection
+                if (!response.keep_alive)
+                {
+                    res.read_errors += opts.depth - i - 1;
+                    break;
+                }
+            }
+        }
+        catch (const std::runtime_error &e)
+        {
+            if (!stop.load(std::memory_order_relaxed))
+                res.read_errors++;
+        }
+    }
+}
+
+/**
+ * @brief Send requests on one connection at a fixed rate, whether or not the
+ * server keeps up.
+ */
+static void
+open_loop(
+    const options &opts, const std::string &request, std::size_t index,
+    clock_type::time_point start, results &res
+)
+{
+    hfs::http_client client(opts.host, opts.port);
+    bool head = opts.method == "HEAD";
+
+    // Connections are staggered so that their requests do not arrive in
+    // bursts.
+    auto interval = std::chrono::duration_cast<clock_type::duration>(
+        std::chrono::duration<double>(opts.connections / opts.rate)
+    );
+    auto intended = start + interval * index / opts.connections;
+
+    client.timeout(opts.timeout);
+
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        std::this_thread::sleep_until(intended);
+
+        if (!ensure_connected(client, res))
+            continue;
+
+        auto sent = clock_type::now();
+
+        try
+        {
+            client.send(request);
+
+            hfs::http_client::response response = client.receive(head);
+            auto received                       = clock_type::now();
+
+            res.latency.record(micros(received - intended));
+            res.uncorrected.record(micros(received - sent));
+            count_response(response, res);
+        }
+        catch (const std::runtime_error &e)
+        {
+            if (!stop.load(std::memory_order_relaxed))
+                res.read_errors++;
+        }
+
+        intended += interval;
+    }
+}
+
+/**
+ * @brief Send the requests of a traffic file, each at its recorded time
+ * divided by the speed, or back to back at speed 0. A request that finds
+ * every connection busy waits, and that wait counts in its latency.
+ */
+static void
+replay_loop(
+    const options &opts, replay_plan &plan, clock_type::time_point start,
+    results &res
+)
+{
+    hfs::http_client client(opts.host, opts.port);
+    double origin = plan.entries.empty() ? 0 : plan.entries[0].timestamp;
+
+    client.timeout(opts.timeout);
+    res.types.resize(plan.types.size());
+
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        std::size_t i = plan.next.fetch_add(1, std::memory_order_relaxed);
+
+        if (i >= plan.entries.size())
+            break;
+
+        const replay_entry &entry = plan.entries[i];
+        type_results &type        = res.types[entry.type];
+        auto intended             = start;
+
+        if (opts.speed > 0)
+        {
+            intended += std::chrono::duration_cast<clock_type::duration>(
+                std::chrono::duration<double>(
+                    (entry.timestamp - origin) / opts.speed
+                )
+            );
+
+            std::this_thread::sleep_until(intended);
+        }
+
+        if (!ensure_connected(client, res))
+        {
+            type.errors++;
+            continue;
+        }
+
+        auto sent = clock_type::now();
+
+        if (opts.speed == 0)
+            intended = sent;
+
+        try
+        {
+            client.send(entry.request);
+
+            hfs::http_client::response response = client.receive(entry.head);
+            auto received                       = clock_type::now();
+
+            res.latency.record(micros(received - intended));
+            res.uncorrected.record(micros(received - sent));
+            type.latency.record(micros(received - intended));
+            type.requests++;
+            count_response(response, res);
+        }
+        catch (const std::runtime_error &e)
+        {
+            if (!stop.load(std::memory_order_relaxed))
+            {
+                res.read_errors++;
+                type.errors++;
+            }
+        }
+    }
+}
+
+static std::string
+mode_name(const options &opts)
+{
+    std::ostringstream name;
+
+    if (!opts.replay.empty())
+    {
+        name << "replay of " << opts.replay.string();
+
+        if (opts.speed > 0)
+            name << " at " << opts.speed << "x";
+        else
+            name << " at full speed";
+    }
+    else if (opts.rate > 0)
+        name << "open loop at " << opts.rate << " req/s";
+    else
+        name << "closed loop";
+
+    return name.str();
+}
+
+/**
+ * @brief Check whether requests have a schedule, and thus a latency
+ * corrected for coordinated omission.
+ */
+static bool
+scheduled(const options &opts)
+{
+    return opts.replay.empty() ? opts.rate > 0 : opts.speed > 0;
+}
+
+/**
+ * @brief List the types of a replay, the most frequent first.
+ */
+static std::vector<std::size_t>
+types_by_count(const results &res)
+{
+    std::vector<std::size_t> order(res.types.size());
+
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(
+        order.begin(), order.end(),
+        [&res](std::size_t a, std::size_t b)
+        {
+            return res.types[a].requests + res.types[a].errors >
+                   res.types[b].requests + res.types[b].errors;
+        }
+    );
+
+    return order;
+}
+
+static void
+print_text(
+    const options &opts, const results &res,
+    const std::vector<std::string> &types, double seconds
+)
+{
+    static constexpr std::array<double, 6> percentiles = {
+        50, 75, 90, 99, 99.9, 99.99,
+    };
+
+    auto print_latency = [](const char *label, const hfs::http_histogram &h)
+    {
+        std::printf(
+            "  %-12s mean %.3fms, max %.3fms\n", label, h.mean() / 1e3,
+            h.max() / 1e3
+        );
+        std::printf("  %-12s", "");
+
+        for (double p : percentiles)
+        {
+            std::printf(" p%g %.3fms", p, h.percentile(p) / 1e3);
+        }
+
+        std::printf("\n");
+    };
+
+    std::printf(
+        "hfs-load: %.2fs, %zu connections, %s, %s, depth %zu\n", seconds,
+        opts.connections, mode_name(opts).c_str(),
+        opts.keep_alive ? "keep-alive" : "close", opts.depth
+    );
+    std::printf(
+        "  %-12s %zu (%.1f/s)\n", "requests", res.requests,
+        res.requests / seconds
+    );
+    std::printf(
+        "  %-12s %.2f MB (%.2f MB/s)\n", "transfer", res.bytes / 1e6,
+        res.bytes / 1e6 / seconds
+    );
+    std::printf("  %-12s %zu\n", "connects", res.connects);
+    std::printf(
+        "  %-12s connect %zu, read %zu\n", "errors", res.connect_errors,
+        res.read_errors
+    );
+    std::printf(
+        "  %-12s 1xx %zu, 2xx %zu, 3xx %zu, 4xx %zu, 5xx %zu\n", "status",
+        res.status[1], res.status[2], res.status[3], res.status[4],
+        res.status[5]
+    );
+
+    print_latency("latency", res.latency);
+
+    if (scheduled(opts))
+        print_latency("uncorrected", res.uncorrected);
+
+    if (res.types.empty())
+        return;
+
+    std::printf(
+        "\n  %-32s %9s %7s %9s %9s %9s %9s %9s\n", "type", "requests",
+        "errors", "mean", "p50", "p99", "p99.9", "max"
+    );
+
+    for (std::size_t i : types_by_count(res))
+    {
+        const type_results &type = res.types[i];
+
+        std::printf(
+            "  %-32s %9zu %7zu %7.3fms %7.3fms %7.3fms %7.3fms %7.3fms\n",
+            types[i].c_str(), type.requests, type.errors,
+            type.latency.mean() / 1e3, type.latency.percentile(50) / 1e3,
+            type.latency.percentile(99) / 1e3,
+            type.latency.percentile(99.9) / 1e3, type.latency.max() / 1e3
+        );
+    }
+}
+
+static nlohmann::ordered_json
+latency_json(const hfs::http_histogram &h)
+{
+    return {
+        {"mean",   h.mean()           },
+        {"max",    h.max()            },
+        {"p50",    h.percentile(50)   },
+        {"p75",    h.percentile(75)   },
+        {"p90",    h.percentile(90)   },
+        {"p99",    h.percentile(99)   },
+        {"p99.9",  h.percentile(99.9) },
+        {"p99.99", h.percentile(99.99)},
+    };
+}
+
+static void
+print_json(
+    const options &opts, const results &res,
+    const std::vector<std::string> &types, double seconds
+)
+{
+    const char *mode = !opts.replay.empty() ? "replay"
+                       : opts.rate > 0      ? "open"
+                                            : "closed";
+
+    nlohmann::ordered_json out = {
+        {"mode",        mode                             },
+        {"rate",        opts.rate                        },
+        {"connections", opts.connections                 },
+        {"keep_alive",  opts.keep_alive                  },
+        {"depth",       opts.depth                       },
+        {"duration",    seconds                          },
+        {"requests",    res.requests                     },
+        {"rps",         res.requests / seconds           },
+        {"bytes",       res.bytes                        },
+        {"connects",    res.connects                     },
+        {"errors",
+         {{"connect", res.connect_errors}, {"read", res.read_errors}}},
+        {"status",
+         {{"1xx", res.status[1]},
+          {"2xx", res.status[2]},
+          {"3xx", res.status[3]},
+          {"4xx", res.status[4]},
+          {"5xx", res.status[5]}}},
+        {"latency_us",  latency_json(res.latency)        },
+    };
+
+    if (scheduled(opts))
+        out["uncorrected_latency_us"] = latency_json(res.uncorrected);
+
+    if (!opts.replay.empty())
+    {
+        out["speed"] = opts.speed;
+        out["types"] = nlohmann::ordered_json::array();
+
+        for (std::size_t i : types_by_count(res))
+        {
+            out["types"].push_back({
+                {"type",       types[i]                          },
+                {"requests",   res.types[i].requests             },
+                {"errors",     res.types[i].errors               },
+                {"latency_us", latency_json(res.types[i].latency)},
+            });
+        }
+    }
+
+    std::cout << out.dump() << std::endl;
+}
+
+/**
+ * @brief Read a traffic file in the format written by `http_capture`, one
+ * JSON object per line with `timestamp`, `method`, `path`, and optionally
+ * `headers`, `body` and `type`. The output of `hfs-logdump` qualifies too.
+ * Lines that do not describe a request are skipped.
+ */
+static bool
+load_replay(
+    const options &opts, const hfs::http_client &client, replay_plan &plan
+)
+{
+    // The framing and the connection are up to hfs-load
+    static constexpr std::array<std::string_view, 4> managed = {
+        "Host",
+        "Content-Length",
+        "Transfer-Encoding",
+        "Connection",
+    };
+
+    std::ifstream file(opts.replay);
+    std::unordered_map<std::string, std::size_t> type_ids;
+    std::string line;
+    std::size_t number = 0, skipped = 0;
+
+    if (!file)
+    {
+        std::cerr << "hfs-load: cannot open " << opts.replay << std::endl;
+        return false;
+    }
+
+    while (std::getline(file, line))
+    {
+        number++;
+
+        nlohmann::json json = nlohmann::json::parse(line, nullptr, false);
+
+        if (!json.is_object() || !json.contains("method") ||
+            !json.contains("path") || !json["method"].is_string() ||
+            !json["path"].is_string())
+        {
+            if (!line.empty())
+                skipped++;
+
+            continue;
+        }
+
+        std::string method = json["method"];
+        std::string path   = json["path"];
+        std::vector<std::pair<std::string, std::string>> headers = opts.headers;
+        std::string type;
+
+        if (json.contains("headers") && json["headers"].is_object())
+        {
+            for (const auto &[name, value] : json["headers"].items())
+            {
+                auto same = [&name](std::string_view other)
+                { return hfs::iequals(name, other); };
+
+                if (value.is_string() &&
+                    std::none_of(managed.begin(), managed.end(), same))
+                {
+                    headers.emplace_back(name, value);
+                }
+            }
+        }
+
+        if (json.contains("type") && json["type"].is_string())
+            type = json["type"];
+        else
+            type = method + " " + path.substr(0, path.find('?'));
+
+        auto [it, inserted] = type_ids.try_emplace(type, plan.types.size());
+
+        if (inserted)
+            plan.types.push_back(type);
+
+        plan.entries.push_back({
+            .timestamp = json.value("timestamp", 0.0),
+            .request   = client.request(
+                method, path, headers, json.value("body", std::string())
+            ),
+            .type = it->second,
+            .head = method == "HEAD",
+        });
+    }
+
+    if (skipped > 0)
+    {
+        std::cerr << "hfs-load: skipped " << skipped << " of " << number
+                  << " lines of " << opts.replay << std::endl;
+    }
+
+    std::stable_sort(
+        plan.entries.begin(), plan.entries.end(),
+        [](const replay_entry &a, const replay_entry &b)
+        { return a.timestamp < b.timestamp; }
+    );
+
+    return true;
+}
+
+/**
+ * @brief Split `http://host[:port][/target]`.
+ */
+static bool
+parse_url(const std::string &url, options &opts)
+{
+    static constexpr std::string_view scheme = "http://";
+
+    if (url.compare(0, scheme.size(), scheme) != 0)
+        return false;
+
+    std::string_view rest = std::string_view(url).substr(scheme.size());
+    std::size_t slash     = rest.find('/');
+    std::string_view authority = rest.substr(0, slash);
+
+    if (slash != std::string_view::npos)
+        opts.target = rest.substr(slash);
+
+    // [v6 address]:port, host:port or host
+    std::size_t colon = authority.rfind(':');
+
+    if (colon != std::string_view::npos &&
+        authority.find(']', colon) == std::string_view::npos)
+    {
+        opts.port = authority.substr(colon + 1);
+        authority = authority.substr(0, colon);
+    }
+
+    if (authority.size() >= 2 && authority.front() == '[' &&
+        authority.back() == ']')
+    {
+        authority = authority.substr(1, authority.size() - 2);
+    }
+
+    opts.host = authority;
+
+    return !opts.host.empty();
+}
+
+static void
+usage()
+{
+    std::cerr
+        << "usage: hfs-load [options] http://host[:port][/target]\n"
+        << "  -c N        connections, one thread each (default 16)\n"
+        << "  -d SECONDS  duration (default 10, or the whole replay)\n"
+        << "  -R RATE     open loop at RATE requests/s over all connections\n"
+        << "              (default: closed loop)\n"
+        << "  -p DEPTH    requests pipelined per connection in the closed\n"
+        << "              loop (default 1)\n"
+        << "  -K          close the connection after every request\n"
+        << "  -m METHOD   request method (default GET)\n"
+        << "  -H 'K: V'   add a header field, may be repeated\n"
+        << "  -b BODY     request body\n"
+        << "  -t MS       send and receive timeout (default 5000)\n"
+        << "  -r FILE     replay the requests of a traffic file instead\n"
+        << "  -s SPEED    replay SPEED times faster than recorded, or as\n"
+        << "              fast as possible with 0 (default 1)\n"
+        << "  --json      print the results as JSON\n";
+}
+
+int
+main(int argc, char *argv[])
+{
+    options opts;
+    std::string url;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value  = i + 1 < argc;
+
+        if (arg == "-c" && has_value)
+            opts.connections = std::max(1l, std::atol(argv[++i]));
+        else if (arg == "-d" && has_value)
+            opts.duration = std::chrono::milliseconds(
+                (long)(std::atof(argv[++i]) * 1000)
+            );
+        else if (arg == "-R" && has_value)
+            opts.rate = std::atof(argv[++i]);
+        else if (arg == "-p" && has_value)
+            opts.depth = std::max(1l, std::atol(argv[++i]));
+        else if (arg == "-K")
+            opts.keep_alive = false;
+        else if (arg == "-m" && has_value)
+            opts.method = argv[++i];
+        else if (arg == "-b" && has_value)
+            opts.body = argv[++i];
+        else if (arg == "-t" && has_value)
+            opts.timeout = std::chrono::milliseconds(std::atol(argv[++i]));
+        else if (arg == "-r" && has_value)
+            opts.replay = argv[++i];
+        else if (arg == "-s" && has_value)
+            opts.speed = std::max(0.0, std::atof(argv[++i]));
+        else if (arg == "-H" && has_value)
+        {
+            std::string_view field = argv[++i];
+            std::size_t colon      = field.find(':');
+
+            if (colon == std::string::npos)
+            {
+                usage();
+                return EXIT_FAILURE;
+            }
+
+            opts.headers.emplace_back(
+                field.substr(0, colon), hfs::trim(field.substr(colon + 1))
+            );
+        }
+        else if (arg == "--json")
+            opts.json = true;
+        else if (arg == "-h" || arg == "--help")
+        {
+            usage();
+            return EXIT_SUCCESS;
+        }
+        else if (url.empty() && arg[0] != '-')
+            url = arg;
+        else
+        {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (url.empty() || !parse_url(url, opts))
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    // Pipelining needs connections that stay open, and a fixed arrival rate
+    // or a replay sends requests one at a time by definition.
+    if (!opts.keep_alive || opts.rate > 0 || !opts.replay.empty())
+        opts.depth = 1;
+
+    if (!opts.keep_alive)
+        opts.headers.emplace_back("Connection", "close");
+
+    std::string request;
+    replay_plan plan;
+
+    try
+    {
+        hfs::http_client client(opts.host, opts.port);
+        request =
+            client.request(opts.method, opts.target, opts.headers, opts.body);
+
+        if (!opts.replay.empty() && !load_replay(opts, client, plan))
+            return EXIT_FAILURE;
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::cerr << "hfs-load: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // A replay lasts as long as its traffic, unless it is cut short
+    auto deadline = clock_type::time_point::max();
+
+    if (opts.duration.has_value() || opts.replay.empty())
+    {
+        deadline = clock_type::now() +
+                   opts.duration.value_or(std::chrono::seconds(10));
+    }
+
+    std::vector<results> per_connection(opts.connections);
+    std::vector<std::thread> workers;
+    auto start = clock_type::now();
+
+    for (std::size_t i = 0; i < opts.connections; i++)
+    {
+        workers.emplace_back(
+            [&, i]()
+            {
+                if (!opts.replay.empty())
+                    replay_loop(opts, plan, start, per_connection[i]);
+                else if (opts.rate > 0)
+                    open_loop(opts, request, i, start, per_connection[i]);
+                else
+                    closed_loop(opts, request, per_connection[i]);
+
+                finished.fetch_add(1, std::memory_order_release);
+            }
+        );
+    }
+
+    while (finished.load(std::memory_order_acquire) < opts.connections &&
+           clock_type::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    stop.store(true, std::memory_order_relaxed);
+
+    auto elapsed = clock_type::now() - start;
+
+    for (auto &worker : workers)
+        worker.join();
+
+    results total;
+
+    for (const auto &res : per_connection)
+        total.merge(res);
+
+    double seconds = std::chrono::duration<double>(elapsed).count();
+
+    if (opts.json)
+        print_json(opts, total, plan.types, seconds);
+    else
+        print_text(opts, total, plan.types, seconds);
+
+    return EXIT_SUCCESS;
+}
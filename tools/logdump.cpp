@@ -0,0 +1,144 @@
+#include <http_access_log.h>
+#include <http_binary_log.h>
+
+struct options
+{
+    bool absolute = false;
+};
+
+/**
+ * @brief Format a timestamp in microseconds as ISO 8601, in UTC.
+ */
+static std::string
+iso_time(std::int64_t timestamp)
+{
+    struct tm tm;
+    time_t t = timestamp / 1000000;
+    char date[32], line[48];
+
+    gmtime_r(&t, &tm);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &tm);
+    std::snprintf(
+        line, sizeof(line), "%s.%06lldZ", date,
+        (long long)(timestamp % 1000000)
+    );
+
+    return line;
+}
+
+/**
+ * @brief Print every record of a log as a line of JSON. The `timestamp` is
+ * in seconds since the first record of the whole dump, like the entries of
+ * `requests.jsonl`, unless `-a` is given.
+ */
+static bool
+dump(
+    std::istream &in, const std::string &name, const options &opts,
+    std::optional<std::int64_t> &origin
+)
+{
+    try
+    {
+        hfs::http_binary_log::decoder decoder(in);
+        hfs::http_access_record record;
+
+        while (decoder.next(record))
+        {
+            if (!origin.has_value())
+                origin = opts.absolute ? 0 : record.timestamp;
+
+            nlohmann::ordered_json line = {
+                {"request_id", record.request_id},
+                {"method", record.method},
+                {"path", record.path},
+                {"timestamp", (record.timestamp - *origin) / 1e6},
+                {"time", iso_time(record.timestamp)},
+                {"status", record.status},
+                {"bytes", record.bytes},
+                {"duration_us", record.duration},
+                {"client", record.client},
+            };
+
+            for (std::size_t i = 0; i < std::size(record.timing); i++)
+            {
+                std::string span(hfs::http_timing::SPANS[i].name);
+
+                if (record.timing[i] != hfs::http_access_record::UNTIMED)
+                    line["timing"][span] = record.timing[i];
+            }
+
+            // Paths are not guaranteed to be valid UTF-8
+            std::cout << line.dump(
+                             -1, ' ', false,
+                             nlohmann::ordered_json::error_handler_t::replace
+                         )
+                      << '\n';
+        }
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::cerr << "hfs-logdump: " << name << ": " << e.what() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static void
+usage()
+{
+    std::cerr << "usage: hfs-logdump [-a] [file...]\n"
+              << "  -a  print timestamps in seconds since the epoch\n"
+              << "Reads the standard input when no file or `-` is given.\n";
+}
+
+int
+main(int argc, char *argv[])
+{
+    options opts;
+    std::vector<std::string> files;
+    std::optional<std::int64_t> origin;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "-a")
+            opts.absolute = true;
+        else if (arg == "-h" || arg == "--help")
+        {
+            usage();
+            return EXIT_SUCCESS;
+        }
+        else
+            files.push_back(arg);
+    }
+
+    if (files.empty())
+        files.push_back("-");
+
+    bool ok = true;
+
+    for (const auto &file : files)
+    {
+        if (file == "-")
+        {
+            ok = dump(std::cin, "<stdin>", opts, origin) && ok;
+            continue;
+        }
+
+        std::ifstream in(file, std::ios::binary);
+
+        if (!in)
+        {
+            std::cerr << "hfs-logdump: cannot open " << file << ": "
+                      << std::strerror(errno) << std::endl;
+            ok = false;
+            continue;
+        }
+
+        ok = dump(in, file, opts, origin) && ok;
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
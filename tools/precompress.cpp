@@ -0,0 +1,282 @@
+#include <http_core.h>
+
+#ifdef HAVE_BROTLI_ENCODE_H
+#include <brotli/encode.h>
+#endif
+
+/**
+ * @brief Extensions of the static assets that are worth compressing. Images,
+ * archives and media are compressed already.
+ */
+static const std::vector<std::string> compressible = {
+    "html", "htm", "css", "js", "mjs", "json", "map",
+    "svg",  "txt", "xml", "ico", "wasm",
+};
+
+struct options
+{
+    bool force   = false;
+    bool verbose = false;
+};
+
+struct summary
+{
+    std::size_t files    = 0;
+    std::size_t written  = 0;
+    std::size_t original = 0;
+    std::size_t gzip     = 0;
+    std::size_t brotli   = 0;
+};
+
+static bool
+read_file(const std::filesystem::path &path, std::string &content)
+{
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file)
+        return false;
+
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    content = stream.str();
+
+    return file.good() || file.eof();
+}
+
+/**
+ * @brief Write the sibling next to a temporary name first, so that the server
+ * never opens a partially written file.
+ */
+static bool
+write_file(const std::filesystem::path &path, const std::string &content)
+{
+    std::filesystem::path temp = path;
+    temp += ".tmp";
+
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+
+        if (!file.write(content.data(), content.size()))
+            return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp, path, ec);
+
+    return !ec;
+}
+
+static bool
+compress_gzip(const std::string &input, std::string &output)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+
+    // 15 window bits + 16 selects the gzip wrapper instead of zlib's
+    if (deflateInit2(
+            &stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9,
+            Z_DEFAULT_STRATEGY
+        ) != Z_OK)
+    {
+        return false;
+    }
+
+    output.resize(deflateBound(&stream, input.size()));
+
+    stream.next_in   = (Bytef *)input.data();
+    stream.avail_in  = input.size();
+    stream.next_out  = (Bytef *)output.data();
+    stream.avail_out = output.size();
+
+    int ret = deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    return ret == Z_STREAM_END;
+}
+
+#ifdef HAVE_BROTLI_ENCODE_H
+static bool
+compress_brotli(const std::string &input, std::string &output)
+{
+    std::size_t size = BrotliEncoderMaxCompressedSize(input.size());
+    output.resize(size);
+
+    if (!BrotliEncoderCompress(
+            BROTLI_MAX_QUALITY, BROTLI_MAX_WINDOW_BITS, BROTLI_MODE_TEXT,
+            input.size(), (const uint8_t *)input.data(), &size,
+            (uint8_t *)output.data()
+        ))
+    {
+        return false;
+    }
+
+    output.resize(size);
+
+    return true;
+}
+#endif
+
+/**
+ * @brief Produce one sibling of `path`. Return the size of the sibling on disk
+ * after the call, or 0 if there is none.
+ */
+static std::size_t
+precompress(
+    const std::filesystem::path &path, const std::string &suffix,
+    const std::string &content,
+    const std::function<bool(const std::string &, std::string &)> &compress,
+    const options &opts, summary &sum
+)
+{
+    std::error_code ec;
+    std::filesystem::path sibling = path;
+    sibling += suffix;
+
+    if (!opts.force && std::filesystem::exists(sibling, ec) &&
+        std::filesystem::last_write_time(sibling, ec) >=
+            std::filesystem::last_write_time(path, ec))
+    {
+        return std::filesystem::file_size(sibling, ec);
+    }
+
+    std::string compressed;
+
+    if (!compress(content, compressed))
+    {
+        std::cerr << "hfs-precompress: failed to compress " << path
+                  << std::endl;
+        return 0;
+    }
+
+    // A sibling that does not save anything only costs a syscall per request
+    if (compressed.size() >= content.size())
+    {
+        std::filesystem::remove(sibling, ec);
+        return 0;
+    }
+
+    if (!write_file(sibling, compressed))
+    {
+        std::cerr << "hfs-precompress: failed to write " << sibling << ": "
+                  << std::strerror(errno) << std::endl;
+        return 0;
+    }
+
+    if (opts.verbose)
+    {
+        std::cout << sibling.string() << ": " << content.size() << " -> "
+                  << compressed.size() << std::endl;
+    }
+
+    sum.written++;
+
+    return compressed.size();
+}
+
+static void
+precompress_directory(
+    const std::filesystem::path &dir, const options &opts, summary &sum
+)
+{
+    for (const auto &entry :
+         std::filesystem::recursive_directory_iterator(dir))
+    {
+        if (!entry.is_regular_file())
+            continue;
+
+        std::string ext = entry.path().extension().string();
+
+        if (ext.empty() || std::find(
+                               compressible.begin(), compressible.end(),
+                               ext.substr(1)
+                           ) == compressible.end())
+        {
+            continue;
+        }
+
+        std::string content;
+
+        if (!read_file(entry.path(), content))
+        {
+            std::cerr << "hfs-precompress: failed to read " << entry.path()
+                      << std::endl;
+            continue;
+        }
+
+        sum.files++;
+        sum.original += content.size();
+
+        std::size_t gzip =
+            precompress(entry.path(), ".gz", content, compress_gzip, opts, sum);
+        sum.gzip += gzip ? gzip : content.size();
+
+#ifdef HAVE_BROTLI_ENCODE_H
+        std::size_t brotli = precompress(
+            entry.path(), ".br", content, compress_brotli, opts, sum
+        );
+        sum.brotli += brotli ? brotli : content.size();
+#endif
+    }
+}
+
+static void
+usage()
+{
+    std::cerr << "usage: hfs-precompress [-f] [-v] <directory>...\n"
+              << "  -f  rewrite siblings even if they are up to date\n"
+              << "  -v  print every sibling that is written\n";
+}
+
+int
+main(int argc, char *argv[])
+{
+    options opts;
+    summary sum;
+    std::vector<std::filesystem::path> dirs;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "-f")
+            opts.force = true;
+        else if (arg == "-v")
+            opts.verbose = true;
+        else if (arg == "-h" || arg == "--help")
+        {
+            usage();
+            return EXIT_SUCCESS;
+        }
+        else
+            dirs.push_back(arg);
+    }
+
+    if (dirs.empty())
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    for (const auto &dir : dirs)
+    {
+        if (!std::filesystem::is_directory(dir))
+        {
+            std::cerr << "hfs-precompress: not a directory: " << dir
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        precompress_directory(dir, opts, sum);
+    }
+
+    std::cout << "hfs-precompress: " << sum.files << " files, "
+              << sum.written << " siblings written, " << sum.original
+              << " bytes -> " << sum.gzip << " bytes (gzip)";
+#ifdef HAVE_BROTLI_ENCODE_H
+    std::cout << ", " << sum.brotli << " bytes (br)";
+#endif
+    std::cout << std::endl;
+
+    return EXIT_SUCCESS;
+}